@@ -26,6 +26,7 @@
 #define ANDI_H
 
 #include <asm/io.h>
+#include <asm/types.h>
 
 #ifndef BOOLEAN
 #define BOOLEAN int
@@ -68,6 +69,307 @@ struct LM629_Trajectory
 	long position;				/* Position, range: -MAXRANGE..MAXRANGE */
 };
 
+/*---------------------------------------------------------------------+
+ |    Packed wire format for filters and trajectories                  |
+ |                                                                     |
+ |    Fixed size and layout on every architecture, so 32 and 64 bit    |
+ |    processes can talk to the driver without a compat layer. The     |
+ |    version word is checked on every record; it can never match the  |
+ |    first word of the native structs above, which is how write()     |
+ |    tells the two formats apart. Fields are in host byte order.      |
+ +--------------------------------------------------------------------*/
+
+#define LM629_MAXRANGE			0x3fffffff
+
+#define LM629_PACKED_MAGIC		0x6290
+#define LM629_PACKED_VERSION	(LM629_PACKED_MAGIC | 1)
+
+/* Most records one write() or writev() to a filter or trajectory file takes */
+#define LM629_MAX_RECORDS		256
+
+/* Trajectory flags, bit-for-bit the LM629 trajectory control word */
+#define LM629_TRJ_FORWARD_DIR		0x1000
+#define LM629_TRJ_VELOCITY_MODE		0x0800
+#define LM629_TRJ_STOP_SMOOTH		0x0400
+#define LM629_TRJ_STOP_ABRUPT		0x0200
+#define LM629_TRJ_MOTOR_OFF			0x0100
+#define LM629_TRJ_LOAD_ACC			0x0020
+#define LM629_TRJ_ACC_RELATIVE		0x0010
+#define LM629_TRJ_LOAD_VEL			0x0008
+#define LM629_TRJ_VEL_RELATIVE		0x0004
+#define LM629_TRJ_LOAD_POS			0x0002
+#define LM629_TRJ_POS_RELATIVE		0x0001
+#define LM629_TRJ_ALL_FLAGS			0x1f3f
+
+struct LM629_Filter_packed
+{
+	__u16 version;				/* LM629_PACKED_VERSION                 */
+	__u16 dterm;				/* Derivative sampling interval factor  */
+	__u16 kp;					/* Proportional parameter               */
+	__u16 ki;					/* Integrating parameter                */
+	__u16 kd;					/* Derivating parameter                 */
+	__u16 il;					/* Integration limit                    */
+} __attribute__ ((packed));
+
+struct LM629_Trajectory_packed
+{
+	__u16 version;				/* LM629_PACKED_VERSION                 */
+	__u16 flags;				/* LM629_TRJ_* bits                     */
+	__s32 acc;					/* Acceleration, range: 0..MAXRANGE     */
+	__s32 velocity;				/* Velocity, range: -MAXRANGE..MAXRANGE */
+	__s32 position;				/* Position, range: -MAXRANGE..MAXRANGE */
+} __attribute__ ((packed));
+
+/*---------------------------------------------------------------------+
+ |    Encoder sample taken by the driver's periodic sampler            |
+ +--------------------------------------------------------------------*/
+
+struct LM629_Sample
+{
+	__s32 position;				/* Real position, counts                */
+	__s32 velocity;				/* Real velocity, counts/sample * 65536 */
+	__u32 tv_sec;				/* Time of sample                       */
+	__u32 tv_usec;
+};
+
+/*---------------------------------------------------------------------+
+ |    Gain schedule: filter table entries switched on automatically    |
+ |    when the sampled velocity or position enters a band.             |
+ +--------------------------------------------------------------------*/
+
+#define LM629_MAX_GAINS			8
+
+#define LM629_GAIN_VELOCITY		1	/* |real velocity| in [low, high)       */
+#define LM629_GAIN_POSITION		2	/* real position in [low, high)         */
+
+struct LM629_Gain
+{
+	__u16 trigger;				/* LM629_GAIN_VELOCITY|POSITION         */
+	__u16 filter;				/* Filter table entry to switch to      */
+	__s32 low;					/* Band, inclusive                      */
+	__s32 high;					/* Band, exclusive                      */
+} __attribute__ ((packed));
+
+struct LM629_Gain_Schedule
+{
+	__u32 count;				/* Entries in use, 0 disables           */
+	struct LM629_Gain gain[LM629_MAX_GAINS];	/* First match wins     */
+} __attribute__ ((packed));
+
+struct LM629_Gain_Status
+{
+	__s32 active;				/* Schedule entry in force, -1 if none  */
+	__u32 switches;				/* Number of gain switches              */
+	__u32 preloaded;			/* Switches that only needed UDF        */
+	__u32 tv_sec;				/* Time of last switch                  */
+	__u32 tv_usec;
+} __attribute__ ((packed));
+
+struct LM629_Position
+{
+	__s64 position;				/* Encoder counts, never wraps          */
+	__u32 wraps;				/* Wrap-around events seen              */
+	__u32 tv_sec;				/* Time of the encoder sample           */
+	__u32 tv_usec;
+} __attribute__ ((packed));
+
+struct ANDI_Home
+{
+	__u32 channels;				/* Bit 0 channel 0, bit 1 channel 1     */
+	__s32 velocity;				/* Search velocity, sign is direction   */
+	__u32 acc;					/* Search acceleration                  */
+	__u32 timeout_ms;			/* Give up after this long              */
+	__u32 homed;				/* Returned: channels that found index  */
+	__u32 elapsed_us;			/* Returned: time taken                 */
+	__s32 index[2];				/* Returned: raw index positions        */
+} __attribute__ ((packed));
+
+/*
+ * SERVO_SET_POSITION_ERROR_THRESHOLD takes the threshold (0..0x7fff),
+ * or'ed with LM629_PERR_STOP to have the LM629 turn the motor off too.
+ */
+#define LM629_PERR_THRESHOLD		0x7fff
+#define LM629_PERR_STOP				0x10000
+
+struct LM629_Thermal
+{
+	__u32 active;				/* Braked until SERVO_CLEAR_THERMAL     */
+	__u32 count;				/* Thermal events since loading         */
+	__u32 tv_sec;				/* Time of the last one                 */
+	__u32 tv_usec;
+	__u32 brake_ns;				/* Seen to brake on, last event         */
+} __attribute__ ((packed));
+
+struct LM629_Move
+{
+	__u32 start_sec;			/* SERVO_START_TRAJECTORY               */
+	__u32 start_usec;
+	__u32 done_sec;				/* Trajectory complete seen             */
+	__u32 done_usec;
+	__u32 duration_us;			/* From start to complete               */
+} __attribute__ ((packed));
+
+#define ANDI_WAIT_ANY		0		/* Return when one channel is complete  */
+#define ANDI_WAIT_ALL		1		/* Return when all channels are         */
+
+struct ANDI_Wait
+{
+	__u32 channels;				/* Bit 0 channel 0, bit 1 channel 1     */
+	__u32 mode;					/* ANDI_WAIT_*                          */
+	__u32 timeout_ms;			/* 0 waits for ever                     */
+	__u32 complete;				/* Returned: channels complete          */
+	struct LM629_Move move[2];	/* Returned: timing of the last moves   */
+} __attribute__ ((packed));
+
+/*
+ * read() on a channel file returns these, oldest first. seq counts the
+ * channel's events since loading, so a gap means the reader fell more
+ * than the ring behind. status is the LM629 status byte, the event bits
+ * being those of SERVO_GET_STATUS.
+ */
+struct LM629_Event
+{
+	__u32 seq;					/* Event number on this channel         */
+	__u8 channel;
+	__u8 status;				/* LM629 status byte                    */
+	__u8 source;				/* ANDI_FAULT_IRQ or ANDI_FAULT_POLLED  */
+	__u8 reserved;
+	__u32 tv_sec;				/* When the event was seen              */
+	__u32 tv_usec;
+	__s64 position;				/* 64 bit position just after the event */
+} __attribute__ ((packed));
+
+#define ANDI_FAULT_IRQ		1		/* Seen by the interrupt handler        */
+#define ANDI_FAULT_POLLED	2		/* Seen by the sampler or an ioctl()    */
+#define ANDI_EVENT_SAMPLE	3		/* Telemetry record, not an event       */
+
+/*
+ * What read() on a channel file returns to this open file: the events
+ * whose status bits are in events, and with decimation N every Nth
+ * encoder sample as an ANDI_EVENT_SAMPLE record (0 for none).
+ */
+struct ANDI_Subscription
+{
+	__u32 events;				/* LM629 status bits                    */
+	__u32 decimation;			/* Samples per telemetry record         */
+} __attribute__ ((packed));
+
+struct ANDI_Fault
+{
+	__u32 active;				/* Brakes on until SERVO_CLEAR_FAULT    */
+	__u32 channels;				/* Bit 0 channel 0, bit 1 channel 1     */
+	__u32 source;				/* ANDI_FAULT_*                         */
+	__u32 count;				/* Faults since the driver was loaded   */
+	__u32 tv_sec;				/* When the fault was seen              */
+	__u32 tv_usec;
+	__u32 brake_ns;				/* Seen to brakes and fault LED on      */
+	__u32 stop_ns;				/* Seen to both LM629s stopped          */
+} __attribute__ ((packed));
+
+/*---------------------------------------------------------------------+
+ |    Odometry. Channel 0 drives the left wheel, channel 1 the right.  |
+ +--------------------------------------------------------------------*/
+
+struct ANDI_Odometry
+{
+	__u32 wheel_base;			/* Distance between the wheels, um      */
+	__s32 counts_per_metre[2];	/* Encoder counts per metre forward,    */
+								/* negative if the encoder counts down  */
+} __attribute__ ((packed));
+
+struct ANDI_Pose
+{
+	__s32 x;					/* um from the origin                   */
+	__s32 y;					/* um from the origin                   */
+	__u32 heading;				/* 2^32 is a full turn, anticlockwise   */
+	__u32 tv_sec;				/* Time of the encoder sample           */
+	__u32 tv_usec;
+} __attribute__ ((packed));
+
+/*---------------------------------------------------------------------+
+ |    Timing of the LM629 operations, per operation and channel        |
+ +--------------------------------------------------------------------*/
+
+#define LM629_OP_SOFT_RESET				0
+#define LM629_OP_DEFINE_HOME			1
+#define LM629_OP_SET_POSITION_ERROR		2
+#define LM629_OP_LOAD_FILTER			3
+#define LM629_OP_UPDATE_FILTER			4
+#define LM629_OP_UPDATE_FILTERS			5
+#define LM629_OP_LOAD_TRAJECTORY		6
+#define LM629_OP_START_TRAJECTORY		7
+#define LM629_OP_GET_STATUS				8
+#define LM629_OP_GET_SIGNALS			9
+#define LM629_OP_GET_INDEX_POSITION		10
+#define LM629_OP_SET_INDEX_POSITION		11
+#define LM629_OP_GET_DESIRED_POSITION	12
+#define LM629_OP_GET_REAL_POSITION		13
+#define LM629_OP_GET_DESIRED_VELOCITY	14
+#define LM629_OP_GET_REAL_VELOCITY		15
+#define LM629_OP_SET_IRQ_MASK			16
+#define LM629_OP_RESET_INTERRUPTS		17
+#define LM629_OP_HARD_RESET				18
+#define LM629_OPS						19
+
+/* histogram[0] counts operations under 1 us, histogram[n] those of */
+/* 2^(n-1) us up to 2^n us, and the last bucket everything longer   */
+#define LM629_LATENCY_BUCKETS			24
+
+struct LM629_Op_Stats
+{
+	__u32 count;				/* Operations, failed ones included     */
+	__u32 errors;				/* Operations that returned an error    */
+	__u32 bytes_out;			/* Command and data bytes written       */
+	__u32 bytes_in;				/* Bytes read, busy polls excluded      */
+	__u64 total_us;				/* Time taken, all operations           */
+	__u32 max_us;				/* Longest operation                    */
+	__u32 histogram[LM629_LATENCY_BUCKETS];
+} __attribute__ ((packed));
+
+/*---------------------------------------------------------------------+
+ |    Port traffic, for SERVO_GET_BUS_COUNTS. The counts wrap.         |
+ +--------------------------------------------------------------------*/
+
+struct ANDI_Bus_Channel
+{
+	__u32 port_reads;			/* LM629 port reads, busy polls too     */
+	__u32 port_writes;			/* LM629 port writes                    */
+	__u32 busy_retries;			/* Busy bit found set                   */
+	__u32 busy_failures;		/* Handshakes given up with -EBUSY      */
+	__u32 resets;				/* Soft and hard resets                 */
+	__u32 command_errors;		/* Command error status seen            */
+} __attribute__ ((packed));
+
+struct ANDI_Bus
+{
+	struct ANDI_Bus_Channel channel[2];
+	__u32 board_reads;			/* Board register reads                 */
+	__u32 board_writes;			/* Board register writes                */
+} __attribute__ ((packed));
+
+/*---------------------------------------------------------------------+
+ |    Port capture, read from /proc/andi_servo/capture                 |
+ |                                                                     |
+ |    Every inb() and outb() the driver does, with an op record at the |
+ |    start of each LM629 operation. bin/replay runs a capture through |
+ |    the driver code against the LM629 emulator.                      |
+ +--------------------------------------------------------------------*/
+
+#define ANDI_CAPTURE_START	1		/* cycles holds cpu_khz                 */
+#define ANDI_CAPTURE_OP		2		/* port: channel, value: LM629_OP_*     */
+#define ANDI_CAPTURE_IN		3		/* port: offset from base, value read   */
+#define ANDI_CAPTURE_OUT	4		/* port: offset from base, value written*/
+#define ANDI_CAPTURE_LOST	5		/* cycles holds records lost before it  */
+
+struct ANDI_Capture
+{
+	__u32 cycles;				/* Since the last record, saturating    */
+	__u8 type;
+	__u8 port;
+	__u8 value;
+	__u8 pad;
+} __attribute__ ((packed));
+
 /*---------------------------------------------------------------------+
  |    Structure definition for Motion controller channel               |
  +--------------------------------------------------------------------*/
@@ -78,11 +380,40 @@ struct LM629
 	struct LM629_Filter *NewFilter;
 	struct LM629_Trajectory *Trajectory;
 	struct LM629_Trajectory *NewTrajectory;
+	struct LM629_Filter *FilterBank[2];
+	struct LM629_Trajectory *TrajectoryBank[2];
+	struct LM629_Filter *FilterTable;
+	struct LM629_Trajectory *TrajectoryTable;
+	int filter_count;
+	int trajectory_count;
+	int trajectory_next;
+	unsigned int filter_seq;
+	unsigned int trajectory_seq;
 	BOOLEAN filter_updated;
+	BOOLEAN filter_pending;
+	BOOLEAN filter_scheduled;	/* The pending filter is the gain       */
+								/* scheduler's preload, not the user's  */
 	BOOLEAN trajectory_started;
 	BOOLEAN trajectory_complete;
 	BOOLEAN pwm_brake;
 	int position_error;
+	BOOLEAN stop_on_error;
+	int irq_mask;
+	struct LM629_Sample Sample;
+	__s64 position64;
+	__s32 position_raw;
+	BOOLEAN position_primed;
+	unsigned int wraps;
+	BOOLEAN index_seen;
+	struct LM629_Thermal Thermal;
+	struct LM629_Move Move;
+	struct LM629_Event *Events;
+	unsigned int event_head;
+	struct LM629_Event Telemetry;
+	unsigned int model_seq;
+	struct LM629_Op_Stats Ops[LM629_OPS];
+	struct LM629_Gain_Schedule GainSchedule;
+	struct LM629_Gain_Status GainStatus;
 };
 
 /*---------------------------------------------------------------------+
@@ -94,6 +425,9 @@ struct andi_servo
 	struct LM629 *Channel0;
 	struct LM629 *Channel1;
 	BOOLEAN FaultLED;
+	int control;				/* LED/IRQENABLE register image         */
+	int brakes;					/* PWM brakes asked for, bit/channel    */
+	int BrakesForced;			/* PWM brakes forced on by a fault      */
 	int base_address;
 };
 
@@ -157,4 +491,65 @@ struct andi_servo
 #define SERVO_CHECK_TRAJECTORY_STARTED			_IOR(SERVO_MAJOR,31,int)
 #define SERVO_CHECK_TRAJECTORY_COMPLETE			_IOR(SERVO_MAJOR,32,int)
 
+/* packed format ioctls (filter and trajectory minors) */
+
+#define SERVO_LOAD_FILTER_PACKED				_IOW(SERVO_MAJOR,33,struct LM629_Filter_packed)
+#define SERVO_GET_FILTER_PACKED					_IOR(SERVO_MAJOR,34,struct LM629_Filter_packed)
+#define SERVO_LOAD_TRAJECTORY_PACKED			_IOW(SERVO_MAJOR,35,struct LM629_Trajectory_packed)
+#define SERVO_GET_TRAJECTORY_PACKED				_IOR(SERVO_MAJOR,36,struct LM629_Trajectory_packed)
+
+/* table ioctls (filter and trajectory minors) */
+
+#define SERVO_LOAD_FILTER						_IOW(SERVO_MAJOR,37,int)
+#define SERVO_LOAD_TRAJECTORY					_IOW(SERVO_MAJOR,38,int)
+
+/* two-stage filter commit */
+
+#define SERVO_UPDATE_FILTERS					_IO(SERVO_MAJOR,39)
+#define SERVO_CHECK_FILTER_PENDING				_IOR(SERVO_MAJOR,40,int)
+
+/* gain scheduling (filter minors) */
+
+#define SERVO_SET_GAIN_SCHEDULE					_IOW(SERVO_MAJOR,41,struct LM629_Gain_Schedule)
+#define SERVO_GET_GAIN_SCHEDULE					_IOR(SERVO_MAJOR,42,struct LM629_Gain_Schedule)
+#define SERVO_GET_GAIN_STATUS					_IOR(SERVO_MAJOR,43,struct LM629_Gain_Status)
+
+/* dead reckoning (board minor) */
+
+#define SERVO_GET_POSE							_IOR(SERVO_MAJOR,44,struct ANDI_Pose)
+#define SERVO_SET_POSE							_IOW(SERVO_MAJOR,45,struct ANDI_Pose)
+#define SERVO_SET_ODOMETRY						_IOW(SERVO_MAJOR,46,struct ANDI_Odometry)
+#define SERVO_GET_ODOMETRY						_IOR(SERVO_MAJOR,47,struct ANDI_Odometry)
+
+/* extended position (channel minors) */
+
+#define SERVO_GET_POSITION64					_IOR(SERVO_MAJOR,48,struct LM629_Position)
+
+/* homing (board minor) */
+
+#define SERVO_HOME								_IOWR(SERVO_MAJOR,49,struct ANDI_Home)
+
+/* position error faults (board minor) */
+
+#define SERVO_GET_FAULT							_IOR(SERVO_MAJOR,50,struct ANDI_Fault)
+#define SERVO_CLEAR_FAULT						_IO(SERVO_MAJOR,51)
+
+/* H-bridge thermal faults (channel minors) */
+
+#define SERVO_GET_THERMAL						_IOR(SERVO_MAJOR,52,struct LM629_Thermal)
+#define SERVO_CLEAR_THERMAL						_IO(SERVO_MAJOR,53)
+
+/* trajectory completion (board and trajectory minors) */
+
+#define SERVO_WAIT_TRAJECTORY					_IOWR(SERVO_MAJOR,54,struct ANDI_Wait)
+
+/* event subscriptions, per open file (channel minors) */
+
+#define SERVO_SET_SUBSCRIPTION					_IOW(SERVO_MAJOR,55,struct ANDI_Subscription)
+#define SERVO_GET_SUBSCRIPTION					_IOR(SERVO_MAJOR,56,struct ANDI_Subscription)
+
+/* port traffic (any minor) */
+
+#define SERVO_GET_BUS_COUNTS					_IOR(SERVO_MAJOR,57,struct ANDI_Bus)
+
 #endif
@@ -0,0 +1,135 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#ifndef ANDI_CLIENT_H
+#define ANDI_CLIENT_H
+
+/*---------------------------------------------------------------------+
+ |    Client library (libandi.a)                                       |
+ |                                                                     |
+ |    One way for programs to talk to the driver: every minor is       |
+ |    opened once by andi_open() and kept open, and each call is one   |
+ |    read(), write(), ioctl() or poll() on it, with no stdio between. |
+ |    Filters and trajectories go to the driver in its packed format,  |
+ |    as many as LM629_MAX_RECORDS to a write(). Every function        |
+ |    returns 0 (or a count) on success and a negative errno on        |
+ |    failure, as the driver's own functions do.                       |
+ +--------------------------------------------------------------------*/
+
+#include <sys/ioctl.h>
+#include <andi.h>
+
+#define ANDI_DEVICE_DIR		"/dev/andi_servo/"
+
+struct andi_client
+{
+	int board;
+	int channel[2];
+	int filter[2];
+	int trajectory[2];
+};
+
+/* Everything andi_snapshot() reads, taken back to back */
+struct andi_snapshot
+{
+	struct LM629_Position position[2];
+	int status[2];
+	struct ANDI_Pose pose;
+};
+
+/*---------------------------------------------------------------------+
+ |    Function prototypes                                              |
+ +--------------------------------------------------------------------*/
+
+/* Opening and closing; flags O_NONBLOCK makes event reads return -EAGAIN */
+int andi_open(struct andi_client *client, int flags);
+void andi_close(struct andi_client *client);
+
+/* Board */
+int andi_hard_reset(struct andi_client *client);
+int andi_set_brakes(struct andi_client *client, int brakes);
+int andi_get_brakes(struct andi_client *client, int *brakes);
+int andi_set_led(struct andi_client *client, BOOLEAN on);
+int andi_get_irq_cause(struct andi_client *client, int *cause);
+int andi_update_filters(struct andi_client *client);
+int andi_home(struct andi_client *client, struct ANDI_Home *home);
+int andi_get_fault(struct andi_client *client, struct ANDI_Fault *fault);
+int andi_clear_fault(struct andi_client *client);
+int andi_get_pose(struct andi_client *client, struct ANDI_Pose *pose);
+int andi_set_pose(struct andi_client *client, struct ANDI_Pose *pose);
+int andi_get_bus_counts(struct andi_client *client, struct ANDI_Bus *counts);
+int andi_wait_trajectories(struct andi_client *client, struct ANDI_Wait *wait);
+
+/* Channels */
+int andi_get_status(struct andi_client *client, int channel, int *status);
+int andi_get_signals(struct andi_client *client, int channel, int *signals);
+int andi_get_position(struct andi_client *client, int channel,
+					  struct LM629_Position *position);
+int andi_set_home_position(struct andi_client *client, int channel);
+int andi_smooth_stop(struct andi_client *client, int channel);
+int andi_abrupt_stop(struct andi_client *client, int channel);
+int andi_motor_off(struct andi_client *client, int channel);
+int andi_get_thermal(struct andi_client *client, int channel,
+					 struct LM629_Thermal *thermal);
+int andi_clear_thermal(struct andi_client *client, int channel);
+
+/* Events */
+int andi_subscribe(struct andi_client *client, int channel, int events,
+				   int decimation);
+int andi_wait_events(struct andi_client *client, int channels,
+					 int timeout_ms);
+int andi_read_events(struct andi_client *client, int channel,
+					 struct LM629_Event *events, int count);
+
+/* Filters */
+int andi_load_filters(struct andi_client *client, int channel,
+					  struct LM629_Filter *filters, int count);
+int andi_load_filter(struct andi_client *client, int channel,
+					 struct LM629_Filter *filter);
+int andi_select_filter(struct andi_client *client, int channel, int entry);
+int andi_update_filter(struct andi_client *client, int channel);
+int andi_get_filter(struct andi_client *client, int channel,
+					struct LM629_Filter *filter);
+int andi_set_gain_schedule(struct andi_client *client, int channel,
+						   struct LM629_Gain_Schedule *schedule);
+int andi_get_gain_schedule(struct andi_client *client, int channel,
+						   struct LM629_Gain_Schedule *schedule);
+
+/* Trajectories */
+int andi_load_trajectories(struct andi_client *client, int channel,
+						   struct LM629_Trajectory *trajectories, int count);
+int andi_load_trajectory(struct andi_client *client, int channel,
+						 struct LM629_Trajectory *trajectory);
+int andi_select_trajectory(struct andi_client *client, int channel,
+						   int entry);
+int andi_start_trajectory(struct andi_client *client, int channel);
+int andi_get_trajectory(struct andi_client *client, int channel,
+						struct LM629_Trajectory *trajectory);
+int andi_wait_trajectory(struct andi_client *client, int channel,
+						 int timeout_ms, struct LM629_Move *move);
+
+/* Snapshots */
+int andi_snapshot(struct andi_client *client, struct andi_snapshot *snapshot);
+
+#endif
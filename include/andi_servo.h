@@ -25,11 +25,23 @@
 #ifndef ANDISERVO_H
 #define ANDISERVO_H
 
+#ifdef ANDI_USERSPACE
+#include <andi.h>
+#include <userspace.h>
+#else
 #include <asm/io.h>
+#include <asm/system.h>
+#include <asm/timex.h>
+#include <asm/div64.h>
 #include <linux/delay.h>
 #include <linux/errno.h>
+#include <linux/cache.h>
+#include <linux/smp.h>
 #include <Lk.h>
 #include <andi.h>
+#endif
+#include <trace.h>
+#include <lm629_packed.h>
 
 /*---------------------------------------------------------------------+
  |    I/O Port offsets for ANDI-SERVO board                            |
@@ -161,14 +173,135 @@
  |    Macros			                                              |
  +--------------------------------------------------------------------*/
 
+/*
+ * Port traffic is counted per CPU, so that counting never moves a
+ * cache line between processors; get_bus_counts() adds the CPUs up.
+ * Each count is a single increment of the local CPU's copy, which the
+ * interrupt handler counting on the same CPU cannot tear.
+ */
+struct bus_counts_cpu
+{
+	struct ANDI_Bus counts;
+} ____cacheline_aligned;
+
+extern struct bus_counts_cpu bus_counts[NR_CPUS];
+
+#define BUS_CHANNEL(ch) \
+	(bus_counts[smp_processor_id()].counts.channel[ch])
+#define BUS_BOARD (bus_counts[smp_processor_id()].counts)
+
+/*
+ * All port access goes through bus_inb() and bus_outb(), so that it
+ * can be captured (see trace.c). Built with ANDI_USERSPACE, inb() and
+ * outb() are those of userspace.h, which go to the ports or to the
+ * LM629 emulator.
+ */
+static inline unsigned char bus_inb(int port)
+{
+	unsigned char value;
+
+	value = inb(port);
+	CAPTURE(ANDI_CAPTURE_IN, port, value);
+
+	return value;
+}
+
+static inline void bus_outb(unsigned char value, int port)
+{
+	outb(value, port);
+	CAPTURE(ANDI_CAPTURE_OUT, port, value);
+}
+
+/*
+ * Port and chip function tracing is for calls from process context. The
+ * sampler makes several chip calls a channel from its timer, and a
+ * printk() for each port access would outlast the sample period.
+ */
+#define BUS_TRACE (!in_interrupt())
+
+/* Board register writes; the LM629 ports are written with PUT */
 #define OUT(data,port) \
-	L("outb (%02x,%04x)\n",(int)data,(int)port); \
-	outb(data,port);
+	LG(BUS_TRACE, "outb (%02x,%04x)\n",(int)data,(int)port); \
+	bus_outb(data,port); \
+	BUS_BOARD.board_writes++;
+
+/* Status reads check_busy_bit() makes before giving up with -EBUSY */
+#define BUSY_RETRY_LIMIT 30
 
 #define CHECK_BUSY \
 	retval = check_busy_bit(board, channel); \
 	if (retval < 0) \
-		return retval;
+		goto done;
+
+/*
+ * Each chip function times itself with a struct lm629_op on the stack.
+ * OP_BEGIN starts the clock and traces the command (the channel is
+ * TP_BOARD for both LM629s), PUT and GET count the bytes moved through
+ * the LM629 ports, and CHECK_BUSY leaves through the function's done:
+ * label, where finish_op() adds the operation to the channel's stats.
+ */
+struct lm629_op
+{
+	int op;
+	cycles_t start;
+	unsigned int bytes_out;
+	unsigned int bytes_in;
+};
+
+#define OP_BEGIN(channel,code) \
+	op.op = (code); \
+	op.bytes_out = 0; \
+	op.bytes_in = 0; \
+	op.start = get_cycles(); \
+	CAPTURE(ANDI_CAPTURE_OP, channel, code); \
+	TRACE_POINT(TP_COMMAND, channel, code, 0, 0, 0);
+
+#define PUT(data,port) \
+	LG(BUS_TRACE, "outb (%02x,%04x)\n",(int)data,(int)port); \
+	bus_outb(data,port); \
+	op.bytes_out++; \
+	BUS_CHANNEL(channel).port_writes++;
+
+#define GET(port) \
+	(op.bytes_in++, BUS_CHANNEL(channel).port_reads++, bus_inb(port))
+
+/*
+ * Changes to the model that are read without the bus lock (the Filter
+ * and Trajectory pointers, the 64 bit position) are bracketed by
+ * model_write_begin() and model_write_end(), which keep model_seq odd
+ * for the duration. A reader copies what it wants between
+ * model_read_begin() and model_read_retry(), and copies again if the
+ * sequence moved, so neither side ever waits for the other.
+ */
+static inline void model_write_begin(struct LM629 *lm629)
+{
+	lm629->model_seq++;
+	wmb();
+}
+
+static inline void model_write_end(struct LM629 *lm629)
+{
+	wmb();
+	lm629->model_seq++;
+}
+
+static inline unsigned int model_read_begin(struct LM629 *lm629)
+{
+	unsigned int seq;
+
+	while ((seq = lm629->model_seq) & 1)
+		barrier();
+	rmb();
+
+	return seq;
+}
+
+static inline int model_read_retry(struct LM629 *lm629, unsigned int seq)
+{
+	rmb();
+
+	return lm629->model_seq != seq;
+}
 
 /*---------------------------------------------------------------------+
  |    Prototypes                                                       |
@@ -184,12 +317,13 @@ int set_position_error_threshold(struct andi_servo *board, int channel,
 int set_breakpoint(struct andi_servo *board, int channel, BOOLEAN relative);
 int load_filter(struct andi_servo *board, int channel);
 int update_filter(struct andi_servo *board, int channel);
+int update_filters(struct andi_servo *board);
 int load_trajectory(struct andi_servo *board, int channel);
 int start_trajectory(struct andi_servo *board, int channel);
 int get_status(struct andi_servo *board, int channel, int *status);
 int get_signals(struct andi_servo *board, int channel, int *signals);
 int get_index_position(struct andi_servo *board, int channel,
-					   int *index_position);
+					   long *index_position);
 int set_index_position(struct andi_servo *board, int channel);
 int get_desired_position(struct andi_servo *board, int channel,
 						 long *desired_position);
@@ -198,12 +332,16 @@ int get_real_position(struct andi_servo *board, int channel,
 int get_desired_velocity(struct andi_servo *board, int channel,
 						 long *desired_velocity);
 int get_real_velocity(struct andi_servo *board, int channel,
-					  int *real_velocity);
+					  long *real_velocity);
 int set_irq_mask(struct andi_servo *board, int channel, int *irq_mask);
+int reset_interrupts(struct andi_servo *board, int channel, int irq_mask);
 
 /* Board functions */
 int hard_reset(struct andi_servo *board, int channel);
 int set_PWM_brake(struct andi_servo *board, int channel, BOOLEAN brake);
+int set_PWM_brakes(struct andi_servo *board, int brakes);
+int set_board_irq(struct andi_servo *board, BOOLEAN enable);
+int set_fault_LED(struct andi_servo *board, BOOLEAN on);
 
 /* Chip state model functions */
 int get_position_error_threshold(struct andi_servo *board, int channel,
@@ -217,10 +355,21 @@ int get_PWM_brake(struct andi_servo *board, int channel, BOOLEAN * brake);
 
 /* Misc. functions */
 int init_board(struct andi_servo *board);
+int finish_op(struct andi_servo *board, int channel, struct lm629_op *op,
+			  int retval);
+int get_bus_counts(struct ANDI_Bus *total);
+
+int check_filter(struct LM629_Filter *filter);
+int check_trajectory(struct LM629_Trajectory *trajectory);
 
 int print_filter(struct LM629_Filter *filter, char *buffer);
 int print_trajectory(struct LM629_Trajectory *trajectory, char *buffer);
+int print_gain_status(struct LM629_Gain_Schedule *schedule,
+					  struct LM629_Gain_Status *status, char *buffer);
 int print_status(int status, char *buffer);
 int print_signals(int signals, char *buffer);
+int print_op_stats(int op, struct LM629_Op_Stats *stats, char *buffer);
+char *op_name(int op);
+int print_bus_counts(struct ANDI_Bus *counts, char *buffer);
 
 #endif
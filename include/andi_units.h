@@ -0,0 +1,96 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#ifndef ANDI_UNITS_H
+#define ANDI_UNITS_H
+
+/*---------------------------------------------------------------------+
+ |    Physical units to LM629 units (libandi.a)                        |
+ |                                                                     |
+ |    The LM629 takes positions in encoder counts, velocities in       |
+ |    counts per sample interval and accelerations in counts per       |
+ |    sample interval squared, both 16.16 fixed point. An andi_axis    |
+ |    holds, for one channel, the scale from mm (of wheel travel) or   |
+ |    rad (of the output shaft), per s and per s^2, to these, worked   |
+ |    out once by andi_axis_configure(). Each value is scaled and      |
+ |    rounded to the nearest on its own, never from the one before,    |
+ |    so a path converted point by point ends where it should.         |
+ +--------------------------------------------------------------------*/
+
+#include <andi.h>
+
+#define ANDI_UNIT_MM	0			/* mm, mm/s, mm/s^2 of wheel travel     */
+#define ANDI_UNIT_RAD	1			/* rad, rad/s, rad/s^2 of the output    */
+#define ANDI_UNITS		2
+
+/* The LM629 sample interval: 2048 clocks, 256us at 8MHz */
+#define ANDI_SAMPLE_S(clock_hz)	(2048.0 / (clock_hz))
+
+struct andi_axis_config
+{
+	double counts_per_rev;		/* Encoder counts per motor turn        */
+								/* (four per line), negative if the     */
+								/* encoder counts down going forward    */
+	double gear_ratio;			/* Motor turns per output turn          */
+	double wheel_diameter;		/* mm; 0 if the axis has no wheel       */
+	double sample_s;			/* ANDI_SAMPLE_S(LM629 clock)           */
+};
+
+struct andi_axis
+{
+	struct andi_axis_config config;
+	double position[ANDI_UNITS];	/* counts per unit                  */
+	double velocity[ANDI_UNITS];	/* 16.16 counts/sample per unit/s   */
+	double acc[ANDI_UNITS];		/* 16.16 counts/sample^2 per unit/s^2   */
+};
+
+/*---------------------------------------------------------------------+
+ |    Function prototypes                                              |
+ +--------------------------------------------------------------------*/
+
+int andi_axis_configure(struct andi_axis *axis,
+						struct andi_axis_config *config);
+
+/* One value; out of range values are clamped to +-LM629_MAXRANGE */
+long andi_position(struct andi_axis *axis, int unit, double position);
+long andi_velocity(struct andi_axis *axis, int unit, double velocity);
+long andi_acceleration(struct andi_axis *axis, int unit, double acc);
+
+double andi_position_units(struct andi_axis *axis, int unit, long counts);
+double andi_velocity_units(struct andi_axis *axis, int unit, long velocity);
+
+/* Many values, to 32 bits as in the packed records; -ERANGE if any clamped */
+int andi_positions(struct andi_axis *axis, int unit, const double *positions,
+				   __s32 *counts, int n);
+int andi_velocities(struct andi_axis *axis, int unit,
+					const double *velocities, __s32 *counts, int n);
+int andi_accelerations(struct andi_axis *axis, int unit, const double *accs,
+					   __s32 *counts, int n);
+
+/* A position mode move, absolute, to a trajectory for the driver */
+int andi_move(struct andi_axis *axis, int unit, double position,
+			  double velocity, double acc,
+			  struct LM629_Trajectory *trajectory);
+
+#endif
@@ -0,0 +1,335 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#ifndef LM629_HPP
+#define LM629_HPP
+
+/*---------------------------------------------------------------------+
+ |    C++ access to the LM629s from user space (C++14, header only)    |
+ |                                                                     |
+ |    The same port protocol as the chip functions in andi_servo.c,    |
+ |    with the channel and the board's address template parameters, so |
+ |    that the ports are constants and nothing is chosen at run time.  |
+ |    What a command sends is first encoded as a Sequence (the command |
+ |    byte, then 16 bit words, each written once the LM629 is no longer|
+ |    busy), which for fixed filters and trajectories the compiler     |
+ |    works out:                                                       |
+ |                                                                     |
+ |        constexpr andi::Sequence<7> move =                           |
+ |            andi::trajectory_sequence(LM629_Trajectory{...});        |
+ |        andi::Channel<andi::UserspaceBus, 0, 0x300> left;            |
+ |        left.send(move);                                             |
+ |        left.start_trajectory();                                     |
+ |                                                                     |
+ |    The Bus is UserspaceBus, which goes through userspacedriver.c to |
+ |    the board or the emulator, or IoportBus, straight to the ports   |
+ |    once ioperm() has been called. Nothing here keeps the driver's   |
+ |    model or statistics, so a channel driven from here must not be   |
+ |    driven by the chip functions, or the driver, at the same time.   |
+ |    Functions return 0 or a negative errno, as the chip functions    |
+ |    do.                                                              |
+ +--------------------------------------------------------------------*/
+
+#include <sys/io.h>
+
+/* The user space build of andi_servo.h, whatever the program says */
+#ifndef ANDI_USERSPACE
+#define ANDI_USERSPACE
+#endif
+
+extern "C"
+{
+#include <andi_servo.h>
+}
+
+namespace andi
+{
+
+/*---------------------------------------------------------------------+
+ |    Ports of a channel, relative to the board's base address         |
+ +--------------------------------------------------------------------*/
+template < int N > struct Ports
+{
+	static_assert(N == 0 || N == 1, "the board has channels 0 and 1");
+
+	static constexpr int command = N ? COMMAND_1 : COMMAND_0;
+	static constexpr int data = N ? DATA_1 : DATA_0;
+};
+
+/*---------------------------------------------------------------------+
+ |    A command and its data words                                     |
+ +--------------------------------------------------------------------*/
+template < int N > struct Sequence
+{
+	unsigned char command;
+	int words;
+	unsigned short word[N];
+};
+
+/*---------------------------------------------------------------------+
+ | constexpr Sequence<5> filter_sequence(const LM629_Filter &filter)   |
+ |                                                                     |
+ | LFIL as load_filter() sends it: dterm and the control word, then    |
+ | the coefficients that are not zero.                                 |
+ +--------------------------------------------------------------------*/
+constexpr Sequence < 5 > filter_sequence(const LM629_Filter & filter)
+{
+	Sequence < 5 > sequence = { LFIL, 1, {0, 0, 0, 0, 0} };
+	int control = 0;
+
+	if (filter.kp)
+	{
+		control |= LOAD_Kp;
+		sequence.word[sequence.words++] = filter.kp;
+	}
+	if (filter.ki)
+	{
+		control |= LOAD_Ki;
+		sequence.word[sequence.words++] = filter.ki;
+	}
+	if (filter.kd)
+	{
+		control |= LOAD_Kd;
+		sequence.word[sequence.words++] = filter.kd;
+	}
+	if (filter.il)
+	{
+		control |= LOAD_Il;
+		sequence.word[sequence.words++] = filter.il;
+	}
+
+	sequence.word[0] = ((filter.dterm - 1) & 0xFF) << 8 | control;
+
+	return sequence;
+}
+
+/*---------------------------------------------------------------------+
+ | constexpr Sequence<7>                                               |
+ | trajectory_sequence(const LM629_Trajectory &trajectory)             |
+ |                                                                     |
+ | LTRJ as load_trajectory() sends it: the control word, then each     |
+ | value loaded, high word first.                                      |
+ +--------------------------------------------------------------------*/
+constexpr Sequence < 7 > trajectory_sequence(const LM629_Trajectory &
+											 trajectory)
+{
+	Sequence < 7 > sequence = { LTRJ, 1, {0, 0, 0, 0, 0, 0, 0} };
+	int control = 0;
+
+	if (trajectory.forward_dir)
+		control |= FORWARD_DIRECTION;
+	if (trajectory.velocity_mode)
+		control |= VELOCITY_MODE;
+	if (trajectory.stop_smooth)
+		control |= SMOOTH_STOP;
+	if (trajectory.stop_abrupt)
+		control |= ABRUPT_STOP;
+	if (trajectory.motor_off)
+		control |= TURN_MOTOR_OFF;
+	if (trajectory.load_acc)
+		control |= LOAD_ACCELERATION;
+	if (trajectory.load_vel)
+		control |= LOAD_VELOCITY;
+	if (trajectory.load_pos)
+		control |= LOAD_POSITION;
+	if (trajectory.acc_relative)
+		control |= ACCELERATION_RELATIVE;
+	if (trajectory.vel_relative)
+		control |= VELOCITY_RELATIVE;
+	if (trajectory.pos_relative)
+		control |= POSITION_RELATIVE;
+
+	sequence.word[0] = control;
+
+	if (trajectory.load_acc)
+	{
+		sequence.word[sequence.words++] = (trajectory.acc >> 16) & 0xFFFF;
+		sequence.word[sequence.words++] = trajectory.acc & 0xFFFF;
+	}
+	if (trajectory.load_vel)
+	{
+		sequence.word[sequence.words++] = (trajectory.velocity >> 16) & 0xFFFF;
+		sequence.word[sequence.words++] = trajectory.velocity & 0xFFFF;
+	}
+	if (trajectory.load_pos)
+	{
+		sequence.word[sequence.words++] = (trajectory.position >> 16) & 0xFFFF;
+		sequence.word[sequence.words++] = trajectory.position & 0xFFFF;
+	}
+
+	return sequence;
+}
+
+/*---------------------------------------------------------------------+
+ |    Buses                                                            |
+ +--------------------------------------------------------------------*/
+
+/* userspacedriver.c: the board, through ioperm(), or the emulator */
+struct UserspaceBus
+{
+	static unsigned char in(int port)
+	{
+		return userspace_inb(port);
+	}
+
+	static void out(unsigned char value, int port)
+	{
+		userspace_outb(value, port);
+	}
+};
+
+/* The ports themselves, after ioperm() */
+struct IoportBus
+{
+	static unsigned char in(int port)
+	{
+		return ::inb_p(port);
+	}
+
+	static void out(unsigned char value, int port)
+	{
+		::outb_p(value, port);
+	}
+};
+
+/*---------------------------------------------------------------------+
+ |    One LM629                                                        |
+ +--------------------------------------------------------------------*/
+template < class Bus, int N, int Base = 0x300 > class Channel
+{
+  public:
+	static constexpr int channel = N;
+	static constexpr int command_port = Base + Ports < N >::command;
+	static constexpr int data_port = Base + Ports < N >::data;
+
+	/* As check_busy_bit() */
+	int wait_ready() const
+	{
+		int i;
+
+		for (i = 0; i < BUSY_RETRY_LIMIT; i++)
+			if (!(Bus::in(command_port) & BUSY_BIT))
+				return 0;
+
+		return -EBUSY;
+	}
+
+	/* The command, then each word once the LM629 will take it */
+	template < int W > int send(const Sequence < W > &sequence) const
+	{
+		int i, retval;
+
+		Bus::out(sequence.command, command_port);
+
+		for (i = 0; i < sequence.words; i++)
+		{
+			retval = wait_ready();
+			if (retval < 0)
+				return retval;
+
+			Bus::out(sequence.word[i] >> 8, data_port);
+			Bus::out(sequence.word[i] & 0xFF, data_port);
+		}
+
+		return wait_ready();
+	}
+
+	/* A command with no data */
+	int command(unsigned char code) const
+	{
+		Bus::out(code, command_port);
+
+		return wait_ready();
+	}
+
+	int load_filter(const LM629_Filter & filter) const
+	{
+		return send(filter_sequence(filter));
+	}
+
+	/* A fixed filter, encoded when the program is compiled */
+	template < int Dterm, int Kp, int Ki, int Kd, int Il >
+		int load_filter() const
+	{
+		static constexpr Sequence < 5 > sequence =
+			filter_sequence(LM629_Filter { Dterm, Kp, Ki, Kd, Il });
+
+		return send(sequence);
+	}
+
+	int update_filter() const
+	{
+		return command(UDF);
+	}
+
+	int load_trajectory(const LM629_Trajectory & trajectory) const
+	{
+		return send(trajectory_sequence(trajectory));
+	}
+
+	int start_trajectory() const
+	{
+		return command(STT);
+	}
+
+	int get_status(int &status) const
+	{
+		status = Bus::in(command_port);
+
+		return 0;
+	}
+
+	/* RDRP, as get_real_position() */
+	int get_real_position(long &position) const
+	{
+		unsigned long value;
+		int retval;
+
+		retval = wait_ready();
+		if (retval < 0)
+			return retval;
+
+		retval = command(RDRP);
+		if (retval < 0)
+			return retval;
+
+		value = (unsigned long) Bus::in(data_port) << 24;
+		value |= (unsigned long) Bus::in(data_port) << 16;
+
+		retval = wait_ready();
+		if (retval < 0)
+			return retval;
+
+		value |= (unsigned long) Bus::in(data_port) << 8;
+		value |= Bus::in(data_port);
+
+		position = (long) (__s32) value;
+
+		return wait_ready();
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#ifndef LM629_EMU_H
+#define LM629_EMU_H
+
+#include <andi.h>
+
+/*---------------------------------------------------------------------+
+ |    LM629 emulator                                                   |
+ |                                                                     |
+ |    The ANDI-SERVO board as seen from its eight ports: two LM629s    |
+ |    with their command protocol, busy handshake, filter, trajectory  |
+ |    generator and interrupt flags, and the board registers. The      |
+ |    motors follow the trajectory exactly. The caller gives the time  |
+ |    of each access, in ns, and the emulator keeps no clock of its    |
+ |    own. Anything the driver does that a real LM629 would not take   |
+ |    is counted as a violation.                                       |
+ +--------------------------------------------------------------------*/
+
+/* Timing of the emulated board, in ns */
+#define EMU_PORT_NS			1000		/* One ISA port access                  */
+#define EMU_COMMAND_NS		1500		/* Busy after a command byte            */
+#define EMU_WORD_NS			1500		/* Busy after each data word            */
+#define EMU_RESET_NS		1500000		/* Busy after a reset                   */
+#define EMU_SAMPLE_NS		256000		/* Sample interval, 2048 clocks at 8MHz */
+
+#define EMU_INDEX_COUNTS	2000		/* Encoder counts between index pulses  */
+
+struct lm629_emu_chip
+{
+	int status;					/* Status byte, busy bit excluded       */
+	int irq_mask;
+	unsigned long long busy_until;
+
+	/* The command being given its data or giving its result */
+	int command;				/* -1 when there is none                */
+	BOOLEAN reading;
+	int bytes;					/* Data bytes moved so far              */
+	int expect;					/* Data bytes the command moves         */
+	unsigned char data[16];
+	__u32 result;
+
+	struct LM629_Filter filter;
+	struct LM629_Filter new_filter;
+	int position_error;
+	BOOLEAN stop_on_error;
+	BOOLEAN acquire_index;
+	__s32 index_position;
+
+	/* Trajectory loaded by LTRJ and not yet started */
+	int load_control;
+	__s32 load_acc;
+	__s32 load_velocity;
+	__s32 load_position;
+
+	/* Trajectory being run */
+	BOOLEAN velocity_mode;
+	BOOLEAN forward;
+	BOOLEAN stopping;
+	long long acc;				/* counts/sample^2 * 65536              */
+	long long max_velocity;		/* counts/sample * 65536                */
+	long long target;			/* counts                               */
+
+	/* Where the motor is, counts * 65536 and counts/sample * 65536 */
+	long long position;
+	long long velocity;
+	unsigned long long next_sample;
+};
+
+struct lm629_emu
+{
+	struct lm629_emu_chip chip[2];
+	int control;				/* LED/IRQENABLE register               */
+	int brakes;
+	int reset_lines;
+	unsigned long commands;		/* Command bytes taken                  */
+	unsigned long violations;	/* Accesses a real LM629 would not take */
+};
+
+/*---------------------------------------------------------------------+
+ |    Function prototypes                                              |
+ +--------------------------------------------------------------------*/
+
+void lm629_emu_init(struct lm629_emu *emu, unsigned long long now);
+unsigned char lm629_emu_inb(struct lm629_emu *emu, int port,
+							unsigned long long now);
+void lm629_emu_outb(struct lm629_emu *emu, int port, unsigned char value,
+					unsigned long long now);
+void lm629_emu_run(struct lm629_emu *emu, unsigned long long now);
+long lm629_emu_position(struct lm629_emu *emu, int channel);
+
+#endif
@@ -0,0 +1,154 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#ifndef LM629_PACKED_H
+#define LM629_PACKED_H
+
+/*---------------------------------------------------------------------+
+ |    The packed filter and trajectory records (andi.h)                |
+ |                                                                     |
+ |    The one encoder and decoder of the format, used by the driver    |
+ |    and by libandi.a. The includer provides the errno values, from   |
+ |    linux/errno.h or errno.h.                                        |
+ +--------------------------------------------------------------------*/
+
+#include <andi.h>
+
+/*---------------------------------------------------------------------+
+ |    static inline int pack_filter(struct LM629_Filter *filter,       |
+ |                                  struct LM629_Filter_packed *packed)|
+ +--------------------------------------------------------------------*/
+static inline int pack_filter(struct LM629_Filter *filter,
+							  struct LM629_Filter_packed *packed)
+{
+	packed->version = LM629_PACKED_VERSION;
+	packed->dterm = filter->dterm;
+	packed->kp = filter->kp;
+	packed->ki = filter->ki;
+	packed->kd = filter->kd;
+	packed->il = filter->il;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static inline int                                                |
+ |    unpack_filter(struct LM629_Filter_packed *packed,                |
+ |                  struct LM629_Filter *filter)                       |
+ |                                                                     |
+ |    Returns -EINVAL if the record is not a version we understand.    |
+ +--------------------------------------------------------------------*/
+static inline int unpack_filter(struct LM629_Filter_packed *packed,
+								struct LM629_Filter *filter)
+{
+	if (packed->version != LM629_PACKED_VERSION)
+		return -EINVAL;
+
+	filter->dterm = packed->dterm;
+	filter->kp = packed->kp;
+	filter->ki = packed->ki;
+	filter->kd = packed->kd;
+	filter->il = packed->il;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static inline int                                                |
+ |    pack_trajectory(struct LM629_Trajectory *trajectory,             |
+ |                    struct LM629_Trajectory_packed *packed)          |
+ +--------------------------------------------------------------------*/
+static inline int pack_trajectory(struct LM629_Trajectory *trajectory,
+								  struct LM629_Trajectory_packed *packed)
+{
+	packed->version = LM629_PACKED_VERSION;
+	packed->flags = 0;
+
+	if (trajectory->forward_dir)
+		packed->flags |= LM629_TRJ_FORWARD_DIR;
+	if (trajectory->velocity_mode)
+		packed->flags |= LM629_TRJ_VELOCITY_MODE;
+	if (trajectory->stop_smooth)
+		packed->flags |= LM629_TRJ_STOP_SMOOTH;
+	if (trajectory->stop_abrupt)
+		packed->flags |= LM629_TRJ_STOP_ABRUPT;
+	if (trajectory->motor_off)
+		packed->flags |= LM629_TRJ_MOTOR_OFF;
+	if (trajectory->load_acc)
+		packed->flags |= LM629_TRJ_LOAD_ACC;
+	if (trajectory->load_vel)
+		packed->flags |= LM629_TRJ_LOAD_VEL;
+	if (trajectory->load_pos)
+		packed->flags |= LM629_TRJ_LOAD_POS;
+	if (trajectory->acc_relative)
+		packed->flags |= LM629_TRJ_ACC_RELATIVE;
+	if (trajectory->vel_relative)
+		packed->flags |= LM629_TRJ_VEL_RELATIVE;
+	if (trajectory->pos_relative)
+		packed->flags |= LM629_TRJ_POS_RELATIVE;
+
+	packed->acc = trajectory->acc;
+	packed->velocity = trajectory->velocity;
+	packed->position = trajectory->position;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static inline int                                                |
+ |    unpack_trajectory(struct LM629_Trajectory_packed *packed,        |
+ |                      struct LM629_Trajectory *trajectory)           |
+ |                                                                     |
+ |    Returns -EINVAL if the record is not a version we understand or  |
+ |    has flags set that the LM629 control word doesn't have.          |
+ +--------------------------------------------------------------------*/
+static inline int unpack_trajectory(struct LM629_Trajectory_packed *packed,
+									struct LM629_Trajectory *trajectory)
+{
+	if (packed->version != LM629_PACKED_VERSION)
+		return -EINVAL;
+
+	if (packed->flags & ~LM629_TRJ_ALL_FLAGS)
+		return -EINVAL;
+
+	trajectory->forward_dir = (packed->flags & LM629_TRJ_FORWARD_DIR) != 0;
+	trajectory->velocity_mode = (packed->flags & LM629_TRJ_VELOCITY_MODE) != 0;
+	trajectory->stop_smooth = (packed->flags & LM629_TRJ_STOP_SMOOTH) != 0;
+	trajectory->stop_abrupt = (packed->flags & LM629_TRJ_STOP_ABRUPT) != 0;
+	trajectory->motor_off = (packed->flags & LM629_TRJ_MOTOR_OFF) != 0;
+	trajectory->load_acc = (packed->flags & LM629_TRJ_LOAD_ACC) != 0;
+	trajectory->load_vel = (packed->flags & LM629_TRJ_LOAD_VEL) != 0;
+	trajectory->load_pos = (packed->flags & LM629_TRJ_LOAD_POS) != 0;
+	trajectory->acc_relative = (packed->flags & LM629_TRJ_ACC_RELATIVE) != 0;
+	trajectory->vel_relative = (packed->flags & LM629_TRJ_VEL_RELATIVE) != 0;
+	trajectory->pos_relative = (packed->flags & LM629_TRJ_POS_RELATIVE) != 0;
+
+	trajectory->acc = packed->acc;
+	trajectory->velocity = packed->velocity;
+	trajectory->position = packed->position;
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include <linux/types.h>
+#include <linux/time.h>
+#include <linux/errno.h>
+#include <asm/div64.h>
+#include <Lk.h>
+#include <andi.h>
+
+/*---------------------------------------------------------------------+
+ |    Fixed point formats                                              |
+ |                                                                     |
+ |    Distances are um << ODOMETRY_SHIFT. Headings are binary angles,  |
+ |    2^32 to the turn, so they wrap for free. Sines are Q16.          |
+ +--------------------------------------------------------------------*/
+
+#define ODOMETRY_SHIFT	16
+#define ODOMETRY_ONE	(1 << ODOMETRY_SHIFT)
+
+/* Turn factor is binary angle per um of wheel difference, Q8 */
+#define ODOMETRY_TURN_SHIFT	8
+
+/*---------------------------------------------------------------------+
+ |    Dead reckoning state                                             |
+ +--------------------------------------------------------------------*/
+
+struct andi_odometry
+{
+	struct ANDI_Odometry config;
+	s64 scale[2];				/* um per count, Q16, signed            */
+	s64 turn;					/* binary angle per um, Q8              */
+	s64 x;						/* um, Q16                              */
+	s64 y;						/* um, Q16                              */
+	u32 heading;				/* binary angle                         */
+	s32 last[2];				/* Encoder counts at the last update    */
+	int primed;					/* last[] is valid                      */
+	struct ANDI_Pose pose;		/* Published copy                       */
+};
+
+/*---------------------------------------------------------------------+
+ |    Function prototypes                                              |
+ +--------------------------------------------------------------------*/
+
+int odometry_configure(struct andi_odometry *odometry,
+					   struct ANDI_Odometry *config);
+void odometry_set_pose(struct andi_odometry *odometry, struct ANDI_Pose *pose);
+void odometry_restart(struct andi_odometry *odometry);
+void odometry_update(struct andi_odometry *odometry, long left, long right,
+					 struct timeval *tv);
+int odometry_sin(u32 angle);
+int odometry_cos(u32 angle);
+int print_pose(struct andi_odometry *odometry, char *buffer);
+
+#endif
@@ -32,12 +32,25 @@
 #include <linux/errno.h>
 #include <linux/version.h>
 #include <linux/proc_fs.h>
+#include <linux/fs.h>
+#include <linux/uio.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/list.h>
+#include <linux/sched.h>
+#include <linux/timer.h>
+#include <linux/interrupt.h>
+#include <linux/tqueue.h>
+#include <asm/semaphore.h>
+#include <asm/timex.h>
 #include <asm/system.h>
 #include <asm/io.h>
 #include <asm/delay.h>
 #include <asm/uaccess.h>
 
 #include <andi_servo.h>
+#include <odometry.h>
+#include <trace.h>
 #include <andi.h>
 #include <Lk.h>
 
@@ -54,6 +67,52 @@
 #define SERVO_NAME "andi_servo"
 #define SERVO_NAME_LENGTH 10
 
+/* Filter and trajectory tables written with one write() or writev() */
+#define SERVO_MAX_RECORDS LM629_MAX_RECORDS
+#define SERVO_WRITE_BUFFER_SIZE \
+	(SERVO_MAX_RECORDS * sizeof (struct LM629_Trajectory_packed))
+
+/* Does a model pointer point into a table bank ? */
+#define IN_BANK(ptr, bank) \
+	((ptr) >= (bank) && (ptr) < (bank) + SERVO_MAX_RECORDS)
+
+/* Events kept per channel for read() on the channel files */
+#define SERVO_EVENTS 256
+
+/* Status bits that are logged as events */
+#define SERVO_EVENT_BITS \
+	(BREAKPOINT_REACHED | POSITION_ERROR | WRAP_AROUND | INDEX_PULSE | \
+	 TRAJECTORY_COMPLETE | COMMAND_ERROR)
+
+/*
+ * Per open file state, in file->private_data. Clients of a channel
+ * file are woken only for what they subscribed to.
+ */
+struct servo_client
+{
+	struct list_head list;
+	int channel;				/* -1 unless a channel file */
+	int events;					/* Status bits returned by read() */
+	unsigned int decimation;	/* Samples per telemetry record, 0 = none */
+	unsigned int cursor;		/* seq of the next event to read */
+	unsigned int sample_seen;	/* seq of the last telemetry record read */
+	wait_queue_head_t wait;
+};
+
+/*
+ * Use of a bus lock, counted with the lock held. Times are in CPU
+ * cycles.
+ */
+struct servo_lock_stats
+{
+	unsigned long acquired;		/* Times taken */
+	unsigned long contended;	/* Times it had to be waited for */
+	unsigned long skipped;		/* Samples skipped because it was held */
+	cycles_t held;				/* Total time held */
+	cycles_t held_max;			/* Longest time held */
+	cycles_t since;				/* When it was last taken */
+};
+
 /* Minor device numbers */
 #define BOARD 0
 #define CHANNEL_0 1
@@ -86,19 +145,52 @@ int procfile_filter0_read(char *buffer, char **buffer_location, off_t offset,
 						  int buffer_length, int *eof, void *data);
 int procfile_filter1_read(char *buffer, char **buffer_location, off_t offset,
 						  int buffer_length, int *eof, void *data);
+int procfile_locks_read(char *buffer, char **buffer_location, off_t offset,
+						int buffer_length, int *eof, void *data);
+int procfile_pose_read(char *buffer, char **buffer_location, off_t offset,
+					   int buffer_length, int *eof, void *data);
+int procfile_latency0_read(char *buffer, char **buffer_location, off_t offset,
+						   int buffer_length, int *eof, void *data);
+int procfile_latency1_read(char *buffer, char **buffer_location, off_t offset,
+						   int buffer_length, int *eof, void *data);
+int procfile_bus_read(char *buffer, char **buffer_location, off_t offset,
+					  int buffer_length, int *eof, void *data);
+int procfile_trace_read(char *buffer, char **buffer_location, off_t offset,
+						int buffer_length, int *eof, void *data);
+int procfile_trace_write(struct file *file, const char *buffer,
+						 unsigned long count, void *data);
+int procfile_capture_read(char *buffer, char **buffer_location, off_t offset,
+						  int buffer_length, int *eof, void *data);
+int procfile_capture_write(struct file *file, const char *buffer,
+						   unsigned long count, void *data);
+int procfile_latency0_write(struct file *file, const char *buffer,
+							unsigned long count, void *data);
+int procfile_latency1_write(struct file *file, const char *buffer,
+							unsigned long count, void *data);
 
 int servo_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num,
 				unsigned long ioctl_param);
+static int servo_do_ioctl(struct inode *inode, struct file *file,
+						  unsigned int ioctl_num, unsigned long ioctl_param);
 static int servo_open(struct inode *inode, struct file *file);
 static int servo_close(struct inode *inode, struct file *file);
+static int servo_fasync(int fd, struct file *file, int on);
+static unsigned int servo_poll(struct file *file, poll_table * wait);
 static ssize_t servo_read(struct file *file, char *buffer, size_t length,
 						  loff_t * offset);
 static ssize_t servo_write(struct file *file, const char *buffer, size_t length,
 						   loff_t * offset);
+static ssize_t servo_do_write(struct file *file, const char *buffer,
+							  size_t length, loff_t * offset);
 
+static int servo_print_board(char *buffer);
+static int servo_print_latency(int channel, char *buffer);
+static int servo_reset_latency(int channel);
 static int servo_read_board(char *buffer, size_t length, loff_t * offset);
-static int servo_read_channel0(char *buffer, size_t length, loff_t * offset);
-static int servo_read_channel1(char *buffer, size_t length, loff_t * offset);
+static int servo_read_channel0(struct file *file, char *buffer, size_t length,
+							   loff_t * offset);
+static int servo_read_channel1(struct file *file, char *buffer, size_t length,
+							   loff_t * offset);
 static int servo_read_filter0(char *buffer, size_t length, loff_t * offset);
 static int servo_read_filter1(char *buffer, size_t length, loff_t * offset);
 static int servo_read_trajectory0(char *buffer, size_t length, loff_t * offset);
@@ -117,4 +209,107 @@ static int servo_write_trajectory0(const char *buffer, size_t length,
 								   loff_t * offset);
 static int servo_write_trajectory1(const char *buffer, size_t length,
 								   loff_t * offset);
+
+static ssize_t servo_writev(struct file *file, const struct iovec *iov,
+							unsigned long count, loff_t * offset);
+static int servo_gather(char *dest, size_t size, const struct iovec *iov,
+						unsigned long count);
+static int servo_is_packed(const struct iovec *iov, unsigned long count);
+static int servo_fill_filters(int channel, struct LM629_Filter *bank,
+							  const struct iovec *iov, unsigned long count);
+static int servo_fill_trajectories(int channel,
+								   struct LM629_Trajectory *bank,
+								   const struct iovec *iov,
+								   unsigned long count);
+static int servo_write_filter_table(int channel, const struct iovec *iov,
+									unsigned long count);
+static int servo_write_trajectory_table(int channel, const struct iovec *iov,
+										unsigned long count);
+static int servo_load_filter_entry(int channel, int index);
+static int servo_load_trajectory_entry(int channel, int index);
+static int servo_start_trajectory(int channel);
+
+static void servo_sample(unsigned long data);
+static int servo_sample_channel(int channel);
+static long servo_gain_value(struct LM629_Gain *gain,
+							 struct LM629_Sample *sample);
+static int servo_gain_matches(struct LM629_Gain *gain,
+							  struct LM629_Sample *sample);
+static void servo_gain_schedule(int channel, struct LM629_Sample *previous);
+static int servo_set_gain_schedule(int channel,
+								   struct LM629_Gain_Schedule *arg);
+
+static int servo_minor_channels(int minor);
+static int servo_ioctl_channels(int minor, unsigned int ioctl_num);
+static void servo_locked(int channel, int contended);
+static int servo_lock(int channels);
+static void servo_lock_wait(int channels);
+static int servo_trylock(int channel);
+static void servo_unlock(int channels);
+static unsigned long servo_cycles_to_us(cycles_t cycles);
+static void servo_copy_filter(int channel, struct LM629_Filter *filter);
+static void servo_copy_trajectory(int channel,
+								  struct LM629_Trajectory *trajectory);
+static void servo_copy_position(int channel, __s64 * position,
+								unsigned int *wraps);
+
+static void servo_extend_position(struct LM629 *lm629, long position);
+static void servo_handle_status(int channel, int status,
+								struct timeval *seen);
+static int servo_get_position64(int channel, struct LM629_Position *arg);
+static void servo_interrupt(int irq, void *dev_id, struct pt_regs *regs);
+static void servo_irq_bh(void *data);
+
+static int servo_define_home(int channel, long offset);
+static int servo_home_start(int channel, struct ANDI_Home *home);
+static int servo_home_stop(int channel);
+static int servo_home_finish(int channel, struct ANDI_Home *home);
+static int servo_home(struct ANDI_Home *arg);
+
+static void servo_trajectory_done(int channel, struct timeval *seen);
+static int servo_trajectory_mask(void);
+static int servo_wait_trajectory(int channels, struct ANDI_Wait *arg);
+
+static void servo_log_event(int channel, int status, struct timeval *seen);
+static void servo_log_sample(int channel, int status, struct timeval *now);
+static int servo_wake_clients(int channel, int status);
+static int servo_client_next(struct servo_client *client,
+							 struct LM629_Event *event);
+static int servo_client_ready(struct servo_client *client);
+static int servo_read_events(struct servo_client *client, struct file *file,
+							 char *buffer, size_t length);
+static int servo_set_subscription(struct servo_client *client,
+								  struct ANDI_Subscription *arg);
+static int servo_get_subscription(struct servo_client *client,
+								  struct ANDI_Subscription *arg);
+
+static __u32 servo_cycles_to_ns(cycles_t cycles);
+static void servo_fault_brake(int channel, int source, cycles_t seen);
+static void servo_fault_stop(void);
+static int servo_get_fault(struct ANDI_Fault *arg);
+static int servo_clear_fault(void);
+
+static int servo_brake_image(void);
+static int servo_thermal_brakes(void);
+static void servo_notify(void);
+static void servo_thermal(int channel, cycles_t seen);
+static void servo_poll_thermal(void);
+static int servo_get_thermal(int channel, struct LM629_Thermal *arg);
+static int servo_clear_thermal(int channel);
+
+static int servo_set_board(int (*set) (int value), int value);
+static int servo_set_brakes(int brakes);
+static int servo_set_brake0(int brake);
+static int servo_set_brake1(int brake);
+static int servo_set_led(int on);
+static int servo_set_irq_enable(int enable);
+static int servo_hard_reset(void);
+static int servo_load_filter_packed(int channel,
+									struct LM629_Filter_packed *arg);
+static int servo_get_filter_packed(int channel,
+								   struct LM629_Filter_packed *arg);
+static int servo_load_trajectory_packed(int channel,
+										struct LM629_Trajectory_packed *arg);
+static int servo_get_trajectory_packed(int channel,
+									   struct LM629_Trajectory_packed *arg);
 #endif
@@ -0,0 +1,51 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#ifndef TOOLS_H
+#define TOOLS_H
+
+/*---------------------------------------------------------------------+
+ |    Helpers shared by the user space tools                           |
+ |                                                                     |
+ |    Host time, the repeatable random numbers the tools draw their    |
+ |    inputs from, and latency percentiles. Built with the user space  |
+ |    objects and linked into bench, stress, jitter and replay.        |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |    Function prototypes                                              |
+ +--------------------------------------------------------------------*/
+
+/* CLOCK_MONOTONIC, in ns */
+unsigned long long clock_ns(void);
+
+/* The same numbers on every run from the same seed, 0..0x7fff */
+unsigned long next_random(unsigned long *seed);
+
+/* Latencies in ns; percentile() wants them sorted and returns us */
+void sort_latency(unsigned long long *latency, unsigned long n);
+double percentile(unsigned long long *latency, unsigned long n,
+				  int per_mille);
+
+#endif
@@ -0,0 +1,122 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#ifndef SERVO_TRACE_H
+#define SERVO_TRACE_H
+
+#ifndef ANDI_USERSPACE
+#include <linux/types.h>
+#include <linux/time.h>
+#include <linux/sched.h>
+#include <linux/smp.h>
+#include <linux/spinlock.h>
+#include <linux/interrupt.h>
+#include <asm/timex.h>
+#include <asm/div64.h>
+#include <Lk.h>
+#endif
+#include <andi.h>
+
+/*---------------------------------------------------------------------+
+ |    Trace points                                                     |
+ |                                                                     |
+ |    A ring of the last TRACE_RECORDS things the driver did, timed    |
+ |    with the cycle counter and shown in /proc/andi_servo/trace.      |
+ |    Off until started, and then one test of trace_enabled a point.   |
+ +--------------------------------------------------------------------*/
+
+#define TRACE_RECORDS	1024		/* A power of two */
+
+/* What happened, and what a, b, c and d hold */
+#define TP_COMMAND	1	/* LM629 operation started: a LM629_OP_*            */
+#define TP_DONE		2	/* Finished: a op, b return value, c/d bytes out/in */
+#define TP_BUSY		3	/* Handshake waited: a busy polls, b 0 or -EBUSY    */
+#define TP_IRQ		4	/* Interrupt: a IRQ cause register                  */
+#define TP_EVENT	5	/* Event logged: a status, b seq, c clients woken   */
+
+#define TP_BOARD	2	/* Channel of a record for both LM629s */
+
+struct trace_record
+{
+	cycles_t when;
+	unsigned char type;
+	unsigned char channel;
+	unsigned char cpu;
+	unsigned char irq;			/* Recorded in interrupt context        */
+	int pid;
+	int a, b, c, d;
+};
+
+/*---------------------------------------------------------------------+
+ |    Port capture                                                     |
+ |                                                                     |
+ |    Every port access as a struct ANDI_Capture (see andi.h), binary  |
+ |    in /proc/andi_servo/capture. Also off until started.             |
+ +--------------------------------------------------------------------*/
+
+#define CAPTURE_RECORDS	8192		/* A power of two */
+
+#ifdef ANDI_USERSPACE
+
+/* The user space build has no trace, and counts ports itself */
+#define TRACE_POINT(type, channel, a, b, c, d) do { } while (0)
+#define CAPTURE(type, port, value) do { } while (0)
+
+#else
+
+extern int trace_enabled;
+extern int capture_enabled;
+
+#define TRACE_POINT(type, channel, a, b, c, d) \
+	do { \
+		if (trace_enabled) \
+			trace_point(type, channel, a, b, c, d); \
+	} while (0)
+
+#define CAPTURE(type, port, value) \
+	do { \
+		if (capture_enabled) \
+			capture_point(type, port, value); \
+	} while (0)
+
+/*---------------------------------------------------------------------+
+ |    Function prototypes                                              |
+ +--------------------------------------------------------------------*/
+
+void trace_point(int type, int channel, int a, int b, int c, int d);
+void trace_start(void);
+void trace_stop(void);
+int trace_read(char *buffer, char **buffer_location, off_t offset,
+			   int buffer_length);
+int print_trace_record(struct trace_record *record, char *buffer);
+
+void capture_point(int type, int port, int value);
+void capture_start(int base_address);
+void capture_stop(void);
+int capture_read(char *buffer, char **buffer_location, off_t offset,
+				 int buffer_length);
+
+#endif
+
+#endif
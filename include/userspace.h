@@ -0,0 +1,98 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#ifndef USERSPACE_H
+#define USERSPACE_H
+
+/*---------------------------------------------------------------------+
+ |    User space build of the chip functions                           |
+ |                                                                     |
+ |    andi_servo.c compiled with -DANDI_USERSPACE gets what it uses of |
+ |    the kernel from here, and its port I/O goes to the board through |
+ |    ioperm() or to the LM629 emulator (see userspacedriver.c).       |
+ |    Cycle counts are nanoseconds; with the emulator they are those   |
+ |    of a clock that only the port accesses and delays move on.       |
+ +--------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <andi.h>
+#include <lm629_emu.h>
+
+#define USERSPACE_PORTS		1		/* The board, through ioperm()          */
+#define USERSPACE_EMULATOR	2		/* lm629_emu.c                          */
+
+typedef __u8 u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef __u64 u64;
+typedef __s32 s32;
+typedef __s64 s64;
+typedef unsigned long long cycles_t;
+
+#define NR_CPUS					1
+#define ____cacheline_aligned
+#define smp_processor_id()		0
+
+#define barrier()	__asm__ __volatile__("": : :"memory")
+#define wmb()		barrier()
+#define rmb()		barrier()
+
+#define do_div(n,base) ({ \
+	unsigned long __rem = (n) % (base); \
+	(n) /= (base); \
+	__rem; })
+
+extern unsigned long cpu_khz;
+extern struct lm629_emu userspace_emu;
+
+#define get_cycles()		userspace_clock()
+#define mdelay(ms)			userspace_delay((unsigned long long) (ms) * 1000000)
+#define udelay(us)			userspace_delay((unsigned long long) (us) * 1000)
+
+#undef inb
+#undef outb
+#define inb(port)			userspace_inb(port)
+#define outb(value,port)	userspace_outb(value, port)
+
+/* No logging */
+#define L_LEVEL 0
+#include <Lk.h>
+
+/*---------------------------------------------------------------------+
+ |    Function prototypes                                              |
+ +--------------------------------------------------------------------*/
+
+int userspace_open(int backend, int base_address);
+void userspace_close(void);
+void userspace_board(struct andi_servo *board, struct LM629 *channel0,
+					 struct LM629 *channel1);
+struct LM629 *userspace_channel(struct andi_servo *board, int channel);
+unsigned char userspace_inb(int port);
+void userspace_outb(unsigned char value, int port);
+cycles_t userspace_clock(void);
+void userspace_delay(unsigned long long ns);
+
+#endif
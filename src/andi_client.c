@@ -0,0 +1,557 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/poll.h>
+#include <andi_client.h>
+#include <lm629_packed.h>
+
+/*---------------------------------------------------------------------+
+ |    static int client_ioctl(int fd, unsigned int request, void *arg) |
+ |                                                                     |
+ |    ioctl(), with the errno as the return value.                     |
+ +--------------------------------------------------------------------*/
+static int client_ioctl(int fd, unsigned int request, void *arg)
+{
+	int retval;
+
+	do
+		retval = ioctl(fd, request, arg);
+	while (retval < 0 && errno == EINTR);
+
+	return retval < 0 ? -errno : retval;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int client_write(int fd, void *buffer, size_t length)     |
+ |                                                                     |
+ |    The driver takes a table whole or not at all, so a short write   |
+ |    is an error too.                                                 |
+ +--------------------------------------------------------------------*/
+static int client_write(int fd, void *buffer, size_t length)
+{
+	ssize_t written;
+
+	do
+		written = write(fd, buffer, length);
+	while (written < 0 && errno == EINTR);
+
+	if (written < 0)
+		return -errno;
+	if (written != length)
+		return -EIO;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int check_channel(int channel)                            |
+ +--------------------------------------------------------------------*/
+static int check_channel(int channel)
+{
+	return channel == 0 || channel == 1 ? 0 : -EINVAL;
+}
+
+/*---------------------------------------------------------------------+
+ |    int andi_open(struct andi_client *client, int flags)             |
+ |                                                                     |
+ |    Opens every minor. flags goes to the channel files, which are    |
+ |    the ones that block; O_NONBLOCK is the one worth giving.         |
+ +--------------------------------------------------------------------*/
+int andi_open(struct andi_client *client, int flags)
+{
+	int retval;
+
+	client->board = open(ANDI_DEVICE_DIR "board", O_RDWR);
+	client->channel[0] = open(ANDI_DEVICE_DIR "channel0", O_RDWR | flags);
+	client->channel[1] = open(ANDI_DEVICE_DIR "channel1", O_RDWR | flags);
+	client->filter[0] = open(ANDI_DEVICE_DIR "filter0", O_RDWR);
+	client->filter[1] = open(ANDI_DEVICE_DIR "filter1", O_RDWR);
+	client->trajectory[0] = open(ANDI_DEVICE_DIR "trajectory0", O_RDWR);
+	client->trajectory[1] = open(ANDI_DEVICE_DIR "trajectory1", O_RDWR);
+
+	if (client->board < 0 || client->channel[0] < 0 ||
+		client->channel[1] < 0 || client->filter[0] < 0 ||
+		client->filter[1] < 0 || client->trajectory[0] < 0 ||
+		client->trajectory[1] < 0)
+	{
+		retval = -errno;
+		andi_close(client);
+		return retval;
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    void andi_close(struct andi_client *client)                      |
+ +--------------------------------------------------------------------*/
+void andi_close(struct andi_client *client)
+{
+	int channel;
+
+	if (client->board >= 0)
+		close(client->board);
+	client->board = -1;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		if (client->channel[channel] >= 0)
+			close(client->channel[channel]);
+		if (client->filter[channel] >= 0)
+			close(client->filter[channel]);
+		if (client->trajectory[channel] >= 0)
+			close(client->trajectory[channel]);
+
+		client->channel[channel] = -1;
+		client->filter[channel] = -1;
+		client->trajectory[channel] = -1;
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |    Board                                                            |
+ +--------------------------------------------------------------------*/
+int andi_hard_reset(struct andi_client *client)
+{
+	return client_ioctl(client->board, SERVO_HARD_RESET, NULL);
+}
+
+int andi_set_brakes(struct andi_client *client, int brakes)
+{
+	return client_ioctl(client->board, SERVO_SET_BRAKES, (void *) (long) brakes);
+}
+
+int andi_get_brakes(struct andi_client *client, int *brakes)
+{
+	return client_ioctl(client->board, SERVO_GET_BRAKES, brakes);
+}
+
+int andi_set_led(struct andi_client *client, BOOLEAN on)
+{
+	return client_ioctl(client->board, SERVO_SET_LED, (void *) (long) on);
+}
+
+int andi_get_irq_cause(struct andi_client *client, int *cause)
+{
+	return client_ioctl(client->board, SERVO_GET_IRQ_CAUSE, cause);
+}
+
+/* Commits the filters loaded on both channels together */
+int andi_update_filters(struct andi_client *client)
+{
+	return client_ioctl(client->board, SERVO_UPDATE_FILTERS, NULL);
+}
+
+int andi_home(struct andi_client *client, struct ANDI_Home *home)
+{
+	return client_ioctl(client->board, SERVO_HOME, home);
+}
+
+int andi_get_fault(struct andi_client *client, struct ANDI_Fault *fault)
+{
+	return client_ioctl(client->board, SERVO_GET_FAULT, fault);
+}
+
+int andi_clear_fault(struct andi_client *client)
+{
+	return client_ioctl(client->board, SERVO_CLEAR_FAULT, NULL);
+}
+
+int andi_get_pose(struct andi_client *client, struct ANDI_Pose *pose)
+{
+	return client_ioctl(client->board, SERVO_GET_POSE, pose);
+}
+
+int andi_set_pose(struct andi_client *client, struct ANDI_Pose *pose)
+{
+	return client_ioctl(client->board, SERVO_SET_POSE, pose);
+}
+
+int andi_get_bus_counts(struct andi_client *client, struct ANDI_Bus *counts)
+{
+	return client_ioctl(client->board, SERVO_GET_BUS_COUNTS, counts);
+}
+
+/* Waits for the trajectories of wait->channels, any or all of them */
+int andi_wait_trajectories(struct andi_client *client, struct ANDI_Wait *wait)
+{
+	return client_ioctl(client->board, SERVO_WAIT_TRAJECTORY, wait);
+}
+
+/*---------------------------------------------------------------------+
+ |    Channels                                                         |
+ +--------------------------------------------------------------------*/
+static int channel_ioctl(struct andi_client *client, int channel,
+						 unsigned int request, void *arg)
+{
+	if (check_channel(channel) < 0)
+		return -EINVAL;
+
+	return client_ioctl(client->channel[channel], request, arg);
+}
+
+int andi_get_status(struct andi_client *client, int channel, int *status)
+{
+	return channel_ioctl(client, channel, SERVO_GET_STATUS, status);
+}
+
+int andi_get_signals(struct andi_client *client, int channel, int *signals)
+{
+	return channel_ioctl(client, channel, SERVO_GET_SIGNALS, signals);
+}
+
+int andi_get_position(struct andi_client *client, int channel,
+					  struct LM629_Position *position)
+{
+	return channel_ioctl(client, channel, SERVO_GET_POSITION64, position);
+}
+
+int andi_set_home_position(struct andi_client *client, int channel)
+{
+	return channel_ioctl(client, channel, SERVO_SET_HOME_POSITION, NULL);
+}
+
+int andi_smooth_stop(struct andi_client *client, int channel)
+{
+	return channel_ioctl(client, channel, SERVO_SMOOTH_STOP, NULL);
+}
+
+int andi_abrupt_stop(struct andi_client *client, int channel)
+{
+	return channel_ioctl(client, channel, SERVO_ABRUPT_STOP, NULL);
+}
+
+int andi_motor_off(struct andi_client *client, int channel)
+{
+	return channel_ioctl(client, channel, SERVO_MOTOR_OFF, NULL);
+}
+
+int andi_get_thermal(struct andi_client *client, int channel,
+					 struct LM629_Thermal *thermal)
+{
+	return channel_ioctl(client, channel, SERVO_GET_THERMAL, thermal);
+}
+
+int andi_clear_thermal(struct andi_client *client, int channel)
+{
+	return channel_ioctl(client, channel, SERVO_CLEAR_THERMAL, NULL);
+}
+
+/*---------------------------------------------------------------------+
+ |    Events                                                           |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ | int andi_subscribe(struct andi_client *client, int channel,         |
+ |                    int events, int decimation)                      |
+ |                                                                     |
+ | What andi_read_events() returns on this channel: the events with a  |
+ | status bit in events, and every decimation'th encoder sample.       |
+ +--------------------------------------------------------------------*/
+int andi_subscribe(struct andi_client *client, int channel, int events,
+				   int decimation)
+{
+	struct ANDI_Subscription subscription;
+
+	subscription.events = events;
+	subscription.decimation = decimation;
+
+	return channel_ioctl(client, channel, SERVO_SET_SUBSCRIPTION,
+						 &subscription);
+}
+
+/*---------------------------------------------------------------------+
+ | int andi_wait_events(struct andi_client *client, int channels,      |
+ |                      int timeout_ms)                                |
+ |                                                                     |
+ | One poll() on the channel files in channels (bit 0 channel 0, bit 1 |
+ | channel 1). Returns the channels with events to read, 0 on timeout. |
+ | A negative timeout_ms waits for ever.                               |
+ +--------------------------------------------------------------------*/
+int andi_wait_events(struct andi_client *client, int channels,
+					 int timeout_ms)
+{
+	struct pollfd fds[2];
+	int n, ready, channel, retval;
+
+	if (!channels || (channels & ~3))
+		return -EINVAL;
+
+	n = 0;
+	for (channel = 0; channel < 2; channel++)
+		if (channels & (1 << channel))
+		{
+			fds[n].fd = client->channel[channel];
+			fds[n].events = POLLIN;
+			n++;
+		}
+
+	retval = poll(fds, n, timeout_ms);
+	if (retval < 0)
+		return -errno;
+
+	ready = 0;
+	n = 0;
+	for (channel = 0; channel < 2; channel++)
+		if (channels & (1 << channel))
+		{
+			if (fds[n].revents & POLLIN)
+				ready |= 1 << channel;
+			n++;
+		}
+
+	return ready;
+}
+
+/*---------------------------------------------------------------------+
+ | int andi_read_events(struct andi_client *client, int channel,       |
+ |                      struct LM629_Event *events, int count)         |
+ |                                                                     |
+ | As many of the waiting events as fit, in one read(). Returns how    |
+ | many; blocks for the first unless the client was opened O_NONBLOCK. |
+ +--------------------------------------------------------------------*/
+int andi_read_events(struct andi_client *client, int channel,
+					 struct LM629_Event *events, int count)
+{
+	ssize_t length;
+
+	if (check_channel(channel) < 0 || count < 1)
+		return -EINVAL;
+
+	do
+		length = read(client->channel[channel], events,
+					  count * sizeof (struct LM629_Event));
+	while (length < 0 && errno == EINTR);
+
+	if (length < 0)
+		return -errno;
+
+	return length / sizeof (struct LM629_Event);
+}
+
+/*---------------------------------------------------------------------+
+ |    Filters                                                          |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ | int andi_load_filters(struct andi_client *client, int channel,      |
+ |                       struct LM629_Filter *filters, int count)      |
+ |                                                                     |
+ | Replaces the channel's filter table with count filters, in one      |
+ | write(), and loads the first into the LM629. andi_select_filter()   |
+ | loads another; andi_update_filter() puts the loaded one in use.     |
+ +--------------------------------------------------------------------*/
+int andi_load_filters(struct andi_client *client, int channel,
+					  struct LM629_Filter *filters, int count)
+{
+	struct LM629_Filter_packed packed[LM629_MAX_RECORDS];
+	int i;
+
+	if (check_channel(channel) < 0 || count < 1 || count > LM629_MAX_RECORDS)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++)
+		pack_filter(&filters[i], &packed[i]);
+
+	return client_write(client->filter[channel], packed,
+						count * sizeof (struct LM629_Filter_packed));
+}
+
+int andi_load_filter(struct andi_client *client, int channel,
+					 struct LM629_Filter *filter)
+{
+	return andi_load_filters(client, channel, filter, 1);
+}
+
+static int filter_ioctl(struct andi_client *client, int channel,
+						unsigned int request, void *arg)
+{
+	if (check_channel(channel) < 0)
+		return -EINVAL;
+
+	return client_ioctl(client->filter[channel], request, arg);
+}
+
+int andi_select_filter(struct andi_client *client, int channel, int entry)
+{
+	return filter_ioctl(client, channel, SERVO_LOAD_FILTER,
+						(void *) (long) entry);
+}
+
+int andi_update_filter(struct andi_client *client, int channel)
+{
+	return filter_ioctl(client, channel, SERVO_UPDATE_FILTER, NULL);
+}
+
+/* The filter in use */
+int andi_get_filter(struct andi_client *client, int channel,
+					struct LM629_Filter *filter)
+{
+	struct LM629_Filter_packed packed;
+	int retval;
+
+	retval = filter_ioctl(client, channel, SERVO_GET_FILTER_PACKED, &packed);
+	if (retval < 0)
+		return retval;
+
+	return unpack_filter(&packed, filter);
+}
+
+int andi_set_gain_schedule(struct andi_client *client, int channel,
+						   struct LM629_Gain_Schedule *schedule)
+{
+	return filter_ioctl(client, channel, SERVO_SET_GAIN_SCHEDULE, schedule);
+}
+
+int andi_get_gain_schedule(struct andi_client *client, int channel,
+						   struct LM629_Gain_Schedule *schedule)
+{
+	return filter_ioctl(client, channel, SERVO_GET_GAIN_SCHEDULE, schedule);
+}
+
+/*---------------------------------------------------------------------+
+ |    Trajectories                                                     |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ | int andi_load_trajectories(struct andi_client *client, int channel, |
+ |             struct LM629_Trajectory *trajectories, int count)       |
+ |                                                                     |
+ | As andi_load_filters(). Each andi_start_trajectory() starts the     |
+ | loaded entry and loads the next, so a path goes in one write().     |
+ +--------------------------------------------------------------------*/
+int andi_load_trajectories(struct andi_client *client, int channel,
+						   struct LM629_Trajectory *trajectories, int count)
+{
+	struct LM629_Trajectory_packed packed[LM629_MAX_RECORDS];
+	int i;
+
+	if (check_channel(channel) < 0 || count < 1 || count > LM629_MAX_RECORDS)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++)
+		pack_trajectory(&trajectories[i], &packed[i]);
+
+	return client_write(client->trajectory[channel], packed,
+						count * sizeof (struct LM629_Trajectory_packed));
+}
+
+int andi_load_trajectory(struct andi_client *client, int channel,
+						 struct LM629_Trajectory *trajectory)
+{
+	return andi_load_trajectories(client, channel, trajectory, 1);
+}
+
+static int trajectory_ioctl(struct andi_client *client, int channel,
+							unsigned int request, void *arg)
+{
+	if (check_channel(channel) < 0)
+		return -EINVAL;
+
+	return client_ioctl(client->trajectory[channel], request, arg);
+}
+
+int andi_select_trajectory(struct andi_client *client, int channel,
+						   int entry)
+{
+	return trajectory_ioctl(client, channel, SERVO_LOAD_TRAJECTORY,
+							(void *) (long) entry);
+}
+
+int andi_start_trajectory(struct andi_client *client, int channel)
+{
+	return trajectory_ioctl(client, channel, SERVO_START_TRAJECTORY, NULL);
+}
+
+/* The trajectory last started */
+int andi_get_trajectory(struct andi_client *client, int channel,
+						struct LM629_Trajectory *trajectory)
+{
+	struct LM629_Trajectory_packed packed;
+	int retval;
+
+	retval = trajectory_ioctl(client, channel, SERVO_GET_TRAJECTORY_PACKED,
+							  &packed);
+	if (retval < 0)
+		return retval;
+
+	return unpack_trajectory(&packed, trajectory);
+}
+
+/*---------------------------------------------------------------------+
+ | int andi_wait_trajectory(struct andi_client *client, int channel,   |
+ |                          int timeout_ms, struct LM629_Move *move)   |
+ |                                                                     |
+ | Until the channel's trajectory is complete, or for timeout_ms (0    |
+ | for ever). move, if not NULL, gets its timing.                      |
+ +--------------------------------------------------------------------*/
+int andi_wait_trajectory(struct andi_client *client, int channel,
+						 int timeout_ms, struct LM629_Move *move)
+{
+	struct ANDI_Wait wait;
+	int retval;
+
+	memset(&wait, 0, sizeof (wait));
+	wait.mode = ANDI_WAIT_ALL;
+	wait.timeout_ms = timeout_ms;
+
+	retval = trajectory_ioctl(client, channel, SERVO_WAIT_TRAJECTORY, &wait);
+	if (retval < 0)
+		return retval;
+
+	if (move)
+		*move = wait.move[channel];
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ | int andi_snapshot(struct andi_client *client,                       |
+ |                   struct andi_snapshot *snapshot)                   |
+ |                                                                     |
+ | What an outer loop reads each period: both 64 bit positions, each   |
+ | with the time it was read, both status bytes and the pose.          |
+ +--------------------------------------------------------------------*/
+int andi_snapshot(struct andi_client *client, struct andi_snapshot *snapshot)
+{
+	int channel, retval;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		retval = andi_get_position(client, channel,
+								   &snapshot->position[channel]);
+		if (retval < 0)
+			return retval;
+
+		retval = andi_get_status(client, channel, &snapshot->status[channel]);
+		if (retval < 0)
+			return retval;
+	}
+
+	return andi_get_pose(client, &snapshot->pose);
+}
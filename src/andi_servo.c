@@ -24,8 +24,7 @@
 
 #include <andi_servo.h>
 
-#define TRACE TRUE
-#define BUSY_RETRY_LIMIT 30
+#define TRACE BUS_TRACE
 
 #ifndef __KERNEL__
 #	define __KERNEL__
@@ -38,8 +37,14 @@
 
 #define __NO_VERSION__
 
-static int command, data;
-static char buffer[512];
+/*
+ * The chip functions keep no state between calls, so the two LM629s
+ * can be driven at the same time. The caller holds the bus lock of the
+ * channel, or of both channels for the board functions (see servo.c).
+ * All they leave behind are statistics.
+ */
+
+struct bus_counts_cpu bus_counts[NR_CPUS];
 
 /*---------------------------------------------------------------------+
  | int check_busy_bit(struct andi_servo *board, int channel)           |
@@ -49,6 +54,7 @@ static char buffer[512];
  +--------------------------------------------------------------------*/
 int check_busy_bit(struct andi_servo *board, int channel)
 {
+	int command;
 	int i;
 
 	LG(TRACE, "check_busy_bit(struct andi_servo *board, int channel)\n");
@@ -61,16 +67,26 @@ int check_busy_bit(struct andi_servo *board, int channel)
 	LG(TRACE, "check_busy_bit: Channel selected, attempting inb()\n");
 
 	for (i = 0; i < BUSY_RETRY_LIMIT; i++)
-		if (!(inb(command) & BUSY_BIT))
+	{
+		BUS_CHANNEL(channel).port_reads++;
+		if (!(bus_inb(command) & BUSY_BIT))
 		{
 			LG(TRACE, "check_busy_bit: success\n");
+			if (i)
+				TRACE_POINT(TP_BUSY, channel, i + 1, 0, 0, 0);
 			return 0;
 		}
 		else
+		{
+			BUS_CHANNEL(channel).busy_retries++;
 			LG(TRACE, "check_busy_bit: failure, retrying\n");
+		}
+	}
 
 	LG(TRACE, "check_busy_bit: failure, aborting\n");
 
+	BUS_CHANNEL(channel).busy_failures++;
+	TRACE_POINT(TP_BUSY, channel, BUSY_RETRY_LIMIT, -EBUSY, 0, 0);
 	return -EBUSY;
 }
 
@@ -82,7 +98,8 @@ int check_busy_bit(struct andi_servo *board, int channel)
  +--------------------------------------------------------------------*/
 int soft_reset(struct andi_servo *board, int channel)
 {
-	int retval;
+	struct lm629_op op;
+	int command, data, retval;
 	LG(TRACE, "int soft_reset(struct andi_servo *board, int channel)\n");
 
 	if (channel)
@@ -96,22 +113,26 @@ int soft_reset(struct andi_servo *board, int channel)
 		data = board->base_address + DATA_0;
 	}
 
-	OUT(RESET, command);
+	OP_BEGIN(channel, LM629_OP_SOFT_RESET);
+	BUS_CHANNEL(channel).resets++;
+
+	PUT(RESET, command);
 
 	mdelay(2);
 
 	CHECK_BUSY;
 
-	OUT(RSTI, command);
+	PUT(RSTI, command);
 
 	CHECK_BUSY;
 
-	OUT(0x00, data);
-	OUT(0x00, data);
+	PUT(0x00, data);
+	PUT(0x00, data);
 
 	CHECK_BUSY;
 
-	return 0;
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
@@ -119,46 +140,88 @@ int soft_reset(struct andi_servo *board, int channel)
  +--------------------------------------------------------------------*/
 int define_home(struct andi_servo *board, int channel)
 {
+	struct lm629_op op;
+	int command, retval;
 	LG(TRACE, "int define_home(struct andi_servo *board, int channel)\n");
 
 	if (channel)
-	{
 		command = board->base_address + COMMAND_1;
-		data = board->base_address + DATA_1;
-	}
 	else
-	{
 		command = board->base_address + COMMAND_0;
-		data = board->base_address + DATA_0;
-	}
 
-	return 0;
+	OP_BEGIN(channel, LM629_OP_DEFINE_HOME);
+
+	CHECK_BUSY;
+
+	PUT(DFH, command);
+
+	CHECK_BUSY;
+
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*-----------------------------------------------------------------------+
  |int set_position_error_threshold(struct andi_servo *board, int channel,|
  |                             int position_error_threshold,             |
  |                             BOOLEAN stop_on_error)                    |
+ |                                                                       |
+ | LPEI flags (and can interrupt on) a position error above the          |
+ | threshold; LPES also has the LM629 turn the motor off.                |
  +----------------------------------------------------------------------*/
 int set_position_error_threshold(struct andi_servo *board, int channel,
 								 int position_error_threshold,
 								 BOOLEAN stop_on_error)
 {
+	struct lm629_op op;
+	int command, data;
+	struct LM629 *lm629;
+	int retval;
+
 	LG(TRACE,
 	   "int set_position_error_threshold(struct andi_servo *board, int channel, int position_error_threshold, BOOLEAN stop_on_error)\n");
 
+	if (position_error_threshold < 0 || position_error_threshold > 0x7FFF)
+		return -EINVAL;
+
 	if (channel)
 	{
 		command = board->base_address + COMMAND_1;
 		data = board->base_address + DATA_1;
+		lm629 = board->Channel1;
 	}
 	else
 	{
 		command = board->base_address + COMMAND_0;
 		data = board->base_address + DATA_0;
+		lm629 = board->Channel0;
 	}
 
-	return 0;
+	OP_BEGIN(channel, LM629_OP_SET_POSITION_ERROR);
+
+	CHECK_BUSY;
+
+	if (stop_on_error)
+	{
+		PUT(LPES, command);
+	}
+	else
+	{
+		PUT(LPEI, command);
+	}
+
+	CHECK_BUSY;
+
+	PUT(((position_error_threshold & 0xFF00) >> 8), data);
+	PUT((position_error_threshold & 0x00FF), data);
+
+	CHECK_BUSY;
+
+	lm629->position_error = position_error_threshold;
+	lm629->stop_on_error = stop_on_error;
+
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------------+
@@ -169,17 +232,6 @@ int set_breakpoint(struct andi_servo *board, int channel, BOOLEAN relative)
 	LG(TRACE,
 	   "int set_breakpoint(struct andi_servo *board, int channel, BOOLEAN relative)\n");
 
-	if (channel)
-	{
-		command = board->base_address + COMMAND_1;
-		data = board->base_address + DATA_1;
-	}
-	else
-	{
-		command = board->base_address + COMMAND_0;
-		data = board->base_address + DATA_0;
-	}
-
 	return 0;
 }
 
@@ -189,7 +241,10 @@ int set_breakpoint(struct andi_servo *board, int channel, BOOLEAN relative)
  +--------------------------------------------------------------------*/
 int load_filter(struct andi_servo *board, int channel)
 {
+	struct lm629_op op;
 	struct LM629_Filter *filter;
+	char buffer[512];
+	int command, data;
 	int commandword;
 	int retval;
 
@@ -200,24 +255,32 @@ int load_filter(struct andi_servo *board, int channel)
 		command = board->base_address + COMMAND_1;
 		data = board->base_address + DATA_1;
 		filter = board->Channel1->NewFilter;
-		board->Channel1->filter_updated = FALSE;
 	}
 	else
 	{
 		command = board->base_address + COMMAND_0;
 		data = board->base_address + DATA_0;
 		filter = board->Channel0->NewFilter;
-		board->Channel0->filter_updated = FALSE;
 	}
 
+	if (!filter)
+		return -ENODATA;
+
+	if (channel)
+		board->Channel1->filter_updated = FALSE;
+	else
+		board->Channel0->filter_updated = FALSE;
+
 	print_filter(filter, buffer);
-	L("Load this filter :\n%s\n", buffer);
+	LG(TRACE, "Load this filter :\n%s\n", buffer);
 
-	OUT(LFIL, command);
+	OP_BEGIN(channel, LM629_OP_LOAD_FILTER);
+
+	PUT(LFIL, command);
 
 	CHECK_BUSY;
 
-	OUT(((filter->dterm - 1) && 0x00FF), data);
+	PUT(((filter->dterm - 1) & 0x00FF), data);
 
 	commandword = 0;
 	if (filter->kp)
@@ -229,77 +292,162 @@ int load_filter(struct andi_servo *board, int channel)
 	if (filter->il)
 		commandword |= LOAD_Il;
 
-	OUT(commandword, data);
+	PUT(commandword, data);
 
 	if (filter->kp)
 	{
 		CHECK_BUSY;
-		OUT(((filter->kp & 0xFF00) >> 8), data);
-		OUT((filter->kp & 0x00FF), data);
+		PUT(((filter->kp & 0xFF00) >> 8), data);
+		PUT((filter->kp & 0x00FF), data);
 	}
 
 	if (filter->ki)
 	{
 		CHECK_BUSY;
-		OUT(((filter->ki & 0xFF00) >> 8), data);
-		OUT((filter->ki & 0x00FF), data);
+		PUT(((filter->ki & 0xFF00) >> 8), data);
+		PUT((filter->ki & 0x00FF), data);
 	}
 
 	if (filter->kd)
 	{
 		CHECK_BUSY;
-		OUT(((filter->kd & 0xFF00) >> 8), data);
-		OUT((filter->kd & 0x00FF), data);
+		PUT(((filter->kd & 0xFF00) >> 8), data);
+		PUT((filter->kd & 0x00FF), data);
 	}
 
 	if (filter->il)
 	{
 		CHECK_BUSY;
-		OUT(((filter->il & 0xFF00) >> 8), data);
-		OUT((filter->il & 0x00FF), data);
+		PUT(((filter->il & 0xFF00) >> 8), data);
+		PUT((filter->il & 0x00FF), data);
 	}
 
 	CHECK_BUSY;
 
-	return 0;
+	/* Whoever called, the scheduler marks its own preloads */
+	if (channel)
+	{
+		board->Channel1->filter_pending = TRUE;
+		board->Channel1->filter_scheduled = FALSE;
+	}
+	else
+	{
+		board->Channel0->filter_pending = TRUE;
+		board->Channel0->filter_scheduled = FALSE;
+	}
+
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
  |    int update_filter(struct andi_servo *board, int channel)         |
+ |                                                                     |
+ |    Commits the filter preloaded by load_filter(). This is a single  |
+ |    UDF command byte; the coefficients are already in the LM629.     |
  +--------------------------------------------------------------------*/
 int update_filter(struct andi_servo *board, int channel)
 {
-	int retval;
+	struct lm629_op op;
+	int command, retval;
 
 	LG(TRACE, "int update_filter(struct andi_servo *board, int channel)\n");
 
 	if (channel)
 	{
 		command = board->base_address + COMMAND_1;
-		data = board->base_address + DATA_1;
+		if (!board->Channel1->NewFilter)
+			return -ENODATA;
 	}
 	else
 	{
 		command = board->base_address + COMMAND_0;
-		data = board->base_address + DATA_0;
+		if (!board->Channel0->NewFilter)
+			return -ENODATA;
 	}
 
-	OUT(UDF, command);
+	OP_BEGIN(channel, LM629_OP_UPDATE_FILTER);
+
+	PUT(UDF, command);
 
 	CHECK_BUSY;
 
 	if (channel)
 	{
+		model_write_begin(board->Channel1);
 		board->Channel1->Filter = board->Channel1->NewFilter;
+		model_write_end(board->Channel1);
 		board->Channel1->filter_updated = TRUE;
+		board->Channel1->filter_pending = FALSE;
 	}
 	else
 	{
+		model_write_begin(board->Channel0);
 		board->Channel0->Filter = board->Channel0->NewFilter;
+		model_write_end(board->Channel0);
 		board->Channel0->filter_updated = TRUE;
+		board->Channel0->filter_pending = FALSE;
 	}
 
-	return 0;
+  done:
+	return finish_op(board, channel, &op, retval);
+}
+
+/*---------------------------------------------------------------------+
+ |    int update_filters(struct andi_servo *board)                     |
+ |                                                                     |
+ |    Board-level commit. Sends UDF to both LM629s back to back, so    |
+ |    both channels change gains within a couple of bus cycles of each |
+ |    other. Both channels must have a filter preloaded. Each channel's|
+ |    handshake decides whether its own model moves to the new filter; |
+ |    the error of either is returned.                                 |
+ +--------------------------------------------------------------------*/
+int update_filters(struct andi_servo *board)
+{
+	struct lm629_op op;
+	struct LM629 *lm629;
+	int channel;
+	int retval, result;
+
+	LG(TRACE, "int update_filters(struct andi_servo *board)\n");
+
+	if (!board->Channel0->filter_pending || !board->Channel1->filter_pending)
+		return -ENODATA;
+
+	OP_BEGIN(TP_BOARD, LM629_OP_UPDATE_FILTERS);
+
+	LG(TRACE, "outb (%02x,%04x) (%02x,%04x)\n", UDF,
+	   board->base_address + COMMAND_0, UDF, board->base_address + COMMAND_1);
+
+	bus_outb(UDF, board->base_address + COMMAND_0);
+	bus_outb(UDF, board->base_address + COMMAND_1);
+	BUS_CHANNEL(0).port_writes++;
+	BUS_CHANNEL(1).port_writes++;
+
+	/* One UDF byte to each LM629, counted once on each channel */
+	op.bytes_out = 1;
+
+	retval = 0;
+	for (channel = 0; channel < 2; channel++)
+	{
+		lm629 = channel ? board->Channel1 : board->Channel0;
+
+		result = check_busy_bit(board, channel);
+		if (result == 0)
+		{
+			model_write_begin(lm629);
+			lm629->Filter = lm629->NewFilter;
+			model_write_end(lm629);
+			lm629->filter_updated = TRUE;
+			lm629->filter_pending = FALSE;
+		}
+		else if (retval == 0)
+			retval = result;
+
+		finish_op(board, channel, &op, result);
+	}
+
+	return retval;
 }
 
 /*---------------------------------------------------------------------+
@@ -308,9 +456,12 @@ int update_filter(struct andi_servo *board, int channel)
  +--------------------------------------------------------------------*/
 int load_trajectory(struct andi_servo *board, int channel)
 {
+	struct lm629_op op;
+	int command, data;
 	int commandword;
 	int retval;
 	struct LM629_Trajectory *trajectory;
+	char buffer[512];
 
 	LG(TRACE,
 	   "int load_trajectory(struct andi_servo *board, int channel, struct LM629_Trajectory *trajectory)\n");
@@ -320,21 +471,29 @@ int load_trajectory(struct andi_servo *board, int channel)
 		command = board->base_address + COMMAND_1;
 		data = board->base_address + DATA_1;
 		trajectory = board->Channel1->NewTrajectory;
-		board->Channel1->trajectory_started = FALSE;
 	}
 	else
 	{
 		command = board->base_address + COMMAND_0;
 		data = board->base_address + DATA_0;
 		trajectory = board->Channel0->NewTrajectory;
-		board->Channel0->trajectory_started = FALSE;
 	}
 
+	if (!trajectory)
+		return -ENODATA;
+
+	if (channel)
+		board->Channel1->trajectory_started = FALSE;
+	else
+		board->Channel0->trajectory_started = FALSE;
+
 	print_trajectory(trajectory, buffer);
 
-	L("Load this trajectory :\n%s\n", buffer);
+	LG(TRACE, "Load this trajectory :\n%s\n", buffer);
 
-	OUT(LFIL, command);
+	OP_BEGIN(channel, LM629_OP_LOAD_TRAJECTORY);
+
+	PUT(LTRJ, command);
 
 	CHECK_BUSY;
 
@@ -363,53 +522,54 @@ int load_trajectory(struct andi_servo *board, int channel)
 	if (trajectory->pos_relative)
 		commandword |= POSITION_RELATIVE;
 
-	OUT(((commandword & 0xFF00) >> 8), data);
-	OUT((commandword & 0x00FF), data);
+	PUT(((commandword & 0xFF00) >> 8), data);
+	PUT((commandword & 0x00FF), data);
 
 	CHECK_BUSY;
 
 	if (trajectory->load_acc)
 	{
-		OUT(((trajectory->acc & 0xFF000000) >> 24), data);
-		OUT(((trajectory->acc & 0x00FF0000) >> 16), data);
+		PUT(((trajectory->acc & 0xFF000000) >> 24), data);
+		PUT(((trajectory->acc & 0x00FF0000) >> 16), data);
 
 		CHECK_BUSY;
 
-		OUT(((trajectory->acc & 0x0000FF00) >> 8), data);
-		OUT((trajectory->acc & 0x000000FF), data);
+		PUT(((trajectory->acc & 0x0000FF00) >> 8), data);
+		PUT((trajectory->acc & 0x000000FF), data);
 
 		CHECK_BUSY;
 	}
 
 	if (trajectory->load_vel)
 	{
-		OUT(((trajectory->velocity & 0xFF000000) >> 24), data);
-		OUT(((trajectory->velocity & 0x00FF0000) >> 16), data);
+		PUT(((trajectory->velocity & 0xFF000000) >> 24), data);
+		PUT(((trajectory->velocity & 0x00FF0000) >> 16), data);
 
 		CHECK_BUSY;
 
-		OUT(((trajectory->velocity & 0x0000FF00) >> 8), data);
-		OUT((trajectory->velocity & 0x000000FF), data);
+		PUT(((trajectory->velocity & 0x0000FF00) >> 8), data);
+		PUT((trajectory->velocity & 0x000000FF), data);
 
 		CHECK_BUSY;
 	}
 
 	if (trajectory->load_pos)
 	{
-		OUT(((trajectory->position & 0xFF000000) >> 24), data);
-		OUT(((trajectory->position & 0x00FF0000) >> 16), data);
+		PUT(((trajectory->position & 0xFF000000) >> 24), data);
+		PUT(((trajectory->position & 0x00FF0000) >> 16), data);
 
 		CHECK_BUSY;
 
-		OUT(((trajectory->position & 0x0000FF00) >> 8), data);
-		OUT((trajectory->position & 0x000000FF), data);
+		PUT(((trajectory->position & 0x0000FF00) >> 8), data);
+		PUT((trajectory->position & 0x000000FF), data);
 
 		CHECK_BUSY;
 	}
 
 	CHECK_BUSY;
 
-	return 0;
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
@@ -417,36 +577,46 @@ int load_trajectory(struct andi_servo *board, int channel)
  +--------------------------------------------------------------------*/
 int start_trajectory(struct andi_servo *board, int channel)
 {
-	int retval;
+	struct lm629_op op;
+	int command, retval;
 	LG(TRACE, "int start_trajectory(struct andi_servo *board, int channel)\n");
 
 	if (channel)
 	{
 		command = board->base_address + COMMAND_1;
-		data = board->base_address + DATA_1;
+		if (!board->Channel1->NewTrajectory)
+			return -ENODATA;
 	}
 	else
 	{
 		command = board->base_address + COMMAND_0;
-		data = board->base_address + DATA_0;
+		if (!board->Channel0->NewTrajectory)
+			return -ENODATA;
 	}
 
-	OUT(STT, command);
+	OP_BEGIN(channel, LM629_OP_START_TRAJECTORY);
+
+	PUT(STT, command);
 
 	CHECK_BUSY;
 
 	if (channel)
 	{
+		model_write_begin(board->Channel1);
 		board->Channel1->Trajectory = board->Channel1->NewTrajectory;
+		model_write_end(board->Channel1);
 		board->Channel1->trajectory_started = TRUE;
 	}
 	else
 	{
+		model_write_begin(board->Channel0);
 		board->Channel0->Trajectory = board->Channel0->NewTrajectory;
+		model_write_end(board->Channel0);
 		board->Channel0->trajectory_started = TRUE;
 	}
 
-	return 0;
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
@@ -454,17 +624,20 @@ int start_trajectory(struct andi_servo *board, int channel)
  +--------------------------------------------------------------------*/
 int get_status(struct andi_servo *board, int channel, int *status)
 {
+	struct lm629_op op;
 	LG(TRACE,
 	   "int get_status(struct andi_servo *board, int channel, int *status)\n");
 
+	OP_BEGIN(channel, LM629_OP_GET_STATUS);
+
 	if (channel)
-		*status = inb(board->base_address + COMMAND_1);
+		*status = GET(board->base_address + COMMAND_1);
 	else
-		*status = inb(board->base_address + COMMAND_0);
+		*status = GET(board->base_address + COMMAND_0);
 
-	L("status : %02x\n", *status);
+	LG(TRACE, "status : %02x\n", *status);
 
-	return 0;
+	return finish_op(board, channel, &op, 0);
 }
 
 /*---------------------------------------------------------------------+
@@ -472,6 +645,8 @@ int get_status(struct andi_servo *board, int channel, int *status)
  +--------------------------------------------------------------------*/
 int get_signals(struct andi_servo *board, int channel, int *signals)
 {
+	struct lm629_op op;
+	int command, data;
 
 	int retval;
 	LG(TRACE,
@@ -488,32 +663,37 @@ int get_signals(struct andi_servo *board, int channel, int *signals)
 		data = board->base_address + DATA_0;
 	}
 
+	OP_BEGIN(channel, LM629_OP_GET_SIGNALS);
+
 	CHECK_BUSY;
 
-	OUT(RDSIGS, command);
+	PUT(RDSIGS, command);
 
 	CHECK_BUSY;
 
-	*signals = inb(data);
+	*signals = GET(data);
 	*signals <<= 8;
-	*signals |= inb(data);
+	*signals |= GET(data);
 
-	L("signals = %04x\n", *signals);
+	LG(TRACE, "signals = %04x\n", *signals);
 
 	CHECK_BUSY;
 
-	return 0;
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
  |    int get_index_position(struct andi_servo *board, int channel,    |
- |                           int *index_position)                      |
+ |                           long *index_position)                     |
  +--------------------------------------------------------------------*/
 int get_index_position(struct andi_servo *board, int channel,
-					   int *index_position)
+					   long *index_position)
 {
+	struct lm629_op op;
+	int command, data, retval;
 	LG(TRACE,
-	   "int get_index_position(struct andi_servo *board, int channel, int *index_position)\n");
+	   "int get_index_position(struct andi_servo *board, int channel, long *index_position)\n");
 
 	if (channel)
 	{
@@ -526,7 +706,31 @@ int get_index_position(struct andi_servo *board, int channel,
 		data = board->base_address + DATA_0;
 	}
 
-	return 0;
+	OP_BEGIN(channel, LM629_OP_GET_INDEX_POSITION);
+
+	CHECK_BUSY;
+
+	PUT(RDIP, command);
+
+	CHECK_BUSY;
+
+	*index_position = (long) GET(data);
+	*index_position <<= 8;
+	*index_position |= (long) GET(data);
+	*index_position <<= 8;
+
+	CHECK_BUSY;
+
+	*index_position |= (long) GET(data);
+	*index_position <<= 8;
+	*index_position |= (long) GET(data);
+
+	LG(TRACE, "index position = %08lx\n", *index_position);
+
+	CHECK_BUSY;
+
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
@@ -534,21 +738,26 @@ int get_index_position(struct andi_servo *board, int channel,
  +--------------------------------------------------------------------*/
 int set_index_position(struct andi_servo *board, int channel)
 {
+	struct lm629_op op;
+	int command, retval;
 	LG(TRACE,
 	   "int set_index_position(struct andi_servo *board, int channel)\n");
 
 	if (channel)
-	{
 		command = board->base_address + COMMAND_1;
-		data = board->base_address + DATA_1;
-	}
 	else
-	{
 		command = board->base_address + COMMAND_0;
-		data = board->base_address + DATA_0;
-	}
 
-	return 0;
+	OP_BEGIN(channel, LM629_OP_SET_INDEX_POSITION);
+
+	CHECK_BUSY;
+
+	PUT(SIP, command);
+
+	CHECK_BUSY;
+
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
@@ -558,6 +767,8 @@ int set_index_position(struct andi_servo *board, int channel)
 int get_desired_position(struct andi_servo *board, int channel,
 						 long *desired_position)
 {
+	struct lm629_op op;
+	int command, data, retval;
 	LG(TRACE,
 	   "int get_desired_position(struct andi_servo *board, int channel, int *desired_position)\n");
 
@@ -572,7 +783,31 @@ int get_desired_position(struct andi_servo *board, int channel,
 		data = board->base_address + DATA_0;
 	}
 
-	return 0;
+	OP_BEGIN(channel, LM629_OP_GET_DESIRED_POSITION);
+
+	CHECK_BUSY;
+
+	PUT(RDDP, command);
+
+	CHECK_BUSY;
+
+	*desired_position = (long) GET(data);
+	*desired_position <<= 8;
+	*desired_position |= (long) GET(data);
+	*desired_position <<= 8;
+
+	CHECK_BUSY;
+
+	*desired_position |= (long) GET(data);
+	*desired_position <<= 8;
+	*desired_position |= (long) GET(data);
+
+	LG(TRACE, "desired position = %08lx\n", *desired_position);
+
+	CHECK_BUSY;
+
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
@@ -582,7 +817,8 @@ int get_desired_position(struct andi_servo *board, int channel,
 int get_real_position(struct andi_servo *board, int channel,
 					  long *real_position)
 {
-	int retval;
+	struct lm629_op op;
+	int command, data, retval;
 	LG(TRACE,
 	   "int get_real_position(struct andi_servo *board, int channel, int *real_position)\n");
 
@@ -597,28 +833,31 @@ int get_real_position(struct andi_servo *board, int channel,
 		data = board->base_address + DATA_0;
 	}
 
+	OP_BEGIN(channel, LM629_OP_GET_REAL_POSITION);
+
 	CHECK_BUSY;
 
-	OUT(RDRP, command);
+	PUT(RDRP, command);
 
 	CHECK_BUSY;
 
-	*real_position = (long) inb(data);
+	*real_position = (long) GET(data);
 	*real_position <<= 8;
-	*real_position |= (long) inb(data);
+	*real_position |= (long) GET(data);
 	*real_position <<= 8;
 
 	CHECK_BUSY;
 
-	*real_position |= (long) inb(data);
+	*real_position |= (long) GET(data);
 	*real_position <<= 8;
-	*real_position |= (long) inb(data);
+	*real_position |= (long) GET(data);
 
-	L("real position = %08lx\n", *real_position);
+	LG(TRACE, "real position = %08lx\n", *real_position);
 
 	CHECK_BUSY;
 
-	return 0;
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
@@ -628,8 +867,11 @@ int get_real_position(struct andi_servo *board, int channel,
 int get_desired_velocity(struct andi_servo *board, int channel,
 						 long *desired_velocity)
 {
+	struct lm629_op op;
+	int command, data, retval;
 	LG(TRACE,
 	   "int get_desired_velocity(struct andi_servo *board, int channel, int *desired_velocity)\n");
+
 	if (channel)
 	{
 		command = board->base_address + COMMAND_1;
@@ -640,17 +882,48 @@ int get_desired_velocity(struct andi_servo *board, int channel,
 		command = board->base_address + COMMAND_0;
 		data = board->base_address + DATA_0;
 	}
-	return 0;
+
+	OP_BEGIN(channel, LM629_OP_GET_DESIRED_VELOCITY);
+
+	CHECK_BUSY;
+
+	PUT(RDDV, command);
+
+	CHECK_BUSY;
+
+	*desired_velocity = (long) GET(data);
+	*desired_velocity <<= 8;
+	*desired_velocity |= (long) GET(data);
+	*desired_velocity <<= 8;
+
+	CHECK_BUSY;
+
+	*desired_velocity |= (long) GET(data);
+	*desired_velocity <<= 8;
+	*desired_velocity |= (long) GET(data);
+
+	LG(TRACE, "desired velocity = %08lx\n", *desired_velocity);
+
+	CHECK_BUSY;
+
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*---------------------------------------------------------------------+
  |    int get_real_velocity(struct andi_servo *board, int channel,     |
- |                          int *real_velocity)                        |
+ |                          long *real_velocity)                       |
+ |                                                                     |
+ |    Same units as the trajectory velocity, counts/sample * 65536.    |
  +--------------------------------------------------------------------*/
-int get_real_velocity(struct andi_servo *board, int channel, int *real_velocity)
+int get_real_velocity(struct andi_servo *board, int channel,
+					  long *real_velocity)
 {
+	struct lm629_op op;
+	int command, data, retval;
 	LG(TRACE,
-	   "int get_real_velocity(struct andi_servo *board, int channel, int *real_velocity)\n");
+	   "int get_real_velocity(struct andi_servo *board, int channel, long *real_velocity)\n");
+
 	if (channel)
 	{
 		command = board->base_address + COMMAND_1;
@@ -662,7 +935,31 @@ int get_real_velocity(struct andi_servo *board, int channel, int *real_velocity)
 		data = board->base_address + DATA_0;
 	}
 
-	return 0;
+	OP_BEGIN(channel, LM629_OP_GET_REAL_VELOCITY);
+
+	CHECK_BUSY;
+
+	PUT(RDRV, command);
+
+	CHECK_BUSY;
+
+	*real_velocity = (long) GET(data);
+	*real_velocity <<= 8;
+	*real_velocity |= (long) GET(data);
+	*real_velocity <<= 8;
+
+	CHECK_BUSY;
+
+	*real_velocity |= (long) GET(data);
+	*real_velocity <<= 8;
+	*real_velocity |= (long) GET(data);
+
+	LG(TRACE, "real velocity = %08lx\n", *real_velocity);
+
+	CHECK_BUSY;
+
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*----------------------------------------------------------------------+
@@ -670,6 +967,8 @@ int get_real_velocity(struct andi_servo *board, int channel, int *real_velocity)
  +---------------------------------------------------------------------*/
 int set_irq_mask(struct andi_servo *board, int channel, int *irq_mask)
 {
+	struct lm629_op op;
+	int command, data, retval;
 	LG(TRACE,
 	   "int set_irq_mask(struct andi_servo *board, int channel, int *irq_mask)\n");
 
@@ -684,6 +983,87 @@ int set_irq_mask(struct andi_servo *board, int channel, int *irq_mask)
 		data = board->base_address + DATA_0;
 	}
 
+	OP_BEGIN(channel, LM629_OP_SET_IRQ_MASK);
+
+	CHECK_BUSY;
+
+	PUT(MSKI, command);
+
+	CHECK_BUSY;
+
+	PUT(0x00, data);
+	PUT(*irq_mask & I_ENA_ALL, data);
+
+	CHECK_BUSY;
+
+	if (channel)
+		board->Channel1->irq_mask = *irq_mask & I_ENA_ALL;
+	else
+		board->Channel0->irq_mask = *irq_mask & I_ENA_ALL;
+
+  done:
+	return finish_op(board, channel, &op, retval);
+}
+
+/*---------------------------------------------------------------------+
+ |  int reset_interrupts(struct andi_servo *board, int channel,        |
+ |                       int irq_mask)                                 |
+ |                                                                     |
+ |  Clears the interrupt flags set in irq_mask. RSTI clears the flags  |
+ |  written as 0 and leaves those written as 1.                        |
+ +--------------------------------------------------------------------*/
+int reset_interrupts(struct andi_servo *board, int channel, int irq_mask)
+{
+	struct lm629_op op;
+	int command, data, retval;
+	LG(TRACE,
+	   "int reset_interrupts(struct andi_servo *board, int channel, int irq_mask)\n");
+
+	if (channel)
+	{
+		command = board->base_address + COMMAND_1;
+		data = board->base_address + DATA_1;
+	}
+	else
+	{
+		command = board->base_address + COMMAND_0;
+		data = board->base_address + DATA_0;
+	}
+
+	OP_BEGIN(channel, LM629_OP_RESET_INTERRUPTS);
+
+	CHECK_BUSY;
+
+	PUT(RSTI, command);
+
+	CHECK_BUSY;
+
+	PUT(0x00, data);
+	PUT(~irq_mask & 0xff, data);
+
+	CHECK_BUSY;
+
+  done:
+	return finish_op(board, channel, &op, retval);
+}
+
+/*---------------------------------------------------------------------+
+ | int set_board_irq(struct andi_servo *board, BOOLEAN enable)         |
+ |                                                                     |
+ | The IRQ enable shares its register with the fault LED, so both are  |
+ | written from the image in board->control and never read back.       |
+ +--------------------------------------------------------------------*/
+int set_board_irq(struct andi_servo *board, BOOLEAN enable)
+{
+	LG(TRACE, "int set_board_irq(struct andi_servo *board, BOOLEAN enable)\n");
+
+	if (enable)
+		board->control |= IRQ_MASK;
+	else
+		board->control &= ~IRQ_MASK;
+
+	OUT(board->control, board->base_address + IRQENABLE);
+
 	return 0;
 }
 
@@ -692,11 +1072,18 @@ int set_irq_mask(struct andi_servo *board, int channel, int *irq_mask)
  +--------------------------------------------------------------------*/
 int hard_reset(struct andi_servo *board, int channel)
 {
-	int retval;
+	struct lm629_op op;
+	int command, data, retval;
 	LG(TRACE, "int hard_reset(struct andi_servo *board, int channel)\n");
 
-	OUT(0x00, board->base_address + IRQENABLE);
-	inb(board->base_address + CLEARIRQ);
+	OP_BEGIN(channel, LM629_OP_HARD_RESET);
+	BUS_CHANNEL(channel).resets++;
+
+	board->control = 0;
+	board->FaultLED = FALSE;
+	OUT(board->control, board->base_address + IRQENABLE);
+	bus_inb(board->base_address + CLEARIRQ);
+	BUS_BOARD.board_reads++;
 
 	if (channel)
 	{
@@ -717,7 +1104,8 @@ int hard_reset(struct andi_servo *board, int channel)
 		mdelay(200);
 	}
 
-	retval = inb(command);
+	retval = bus_inb(command);
+	BUS_CHANNEL(channel).port_reads++;
 
 	if ((retval != 0xC4) && (retval != 0x84))
 	{
@@ -726,16 +1114,17 @@ int hard_reset(struct andi_servo *board, int channel)
 		/*return -retval; */
 	}
 
-	OUT(RSTI, command);
+	PUT(RSTI, command);
 
 	CHECK_BUSY;
 
-	OUT(0x00, data);
-	OUT(0x00, data);
+	PUT(0x00, data);
+	PUT(0x00, data);
 
 	CHECK_BUSY;
 
-	retval = inb(command);
+	retval = bus_inb(command);
+	BUS_CHANNEL(channel).port_reads++;
 
 	if ((retval != 0xC0) && (retval != 0x80))
 	{
@@ -746,7 +1135,8 @@ int hard_reset(struct andi_servo *board, int channel)
 
 	CHECK_BUSY;
 
-	return 0;
+  done:
+	return finish_op(board, channel, &op, retval);
 }
 
 /*-----------------------------------------------------------------------+
@@ -757,16 +1147,48 @@ int set_PWM_brake(struct andi_servo *board, int channel, BOOLEAN brake)
 	LG(TRACE,
 	   "int set_PWM_brake(struct andi_servo *board, int channel, BOOLEAN brake)\n");
 
-	if (channel)
-	{
-		command = board->base_address + COMMAND_1;
-		data = board->base_address + DATA_1;
-	}
+	if (brake)
+		return set_PWM_brakes(board, board->brakes | (1 << channel));
 	else
-	{
-		command = board->base_address + COMMAND_0;
-		data = board->base_address + DATA_0;
-	}
+		return set_PWM_brakes(board, board->brakes & ~(1 << channel));
+}
+
+/*---------------------------------------------------------------------+
+ |    int set_PWM_brakes(struct andi_servo *board, int brakes)         |
+ |                                                                     |
+ |    Both brakes in one write, bit 0 channel 0 and bit 1 channel 1.   |
+ |    Brakes forced on by the driver after a fault stay on regardless. |
+ +--------------------------------------------------------------------*/
+int set_PWM_brakes(struct andi_servo *board, int brakes)
+{
+	LG(TRACE, "int set_PWM_brakes(struct andi_servo *board, int brakes)\n");
+
+	board->brakes = brakes & 0x03;
+	board->Channel0->pwm_brake = (brakes & 0x01) != 0;
+	board->Channel1->pwm_brake = (brakes & 0x02) != 0;
+
+	OUT(board->brakes | board->BrakesForced, board->base_address + PWM_BRAKES);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ | int set_fault_LED(struct andi_servo *board, BOOLEAN on)             |
+ |                                                                     |
+ | The fault LED shares its register with the IRQ enable.             |
+ +--------------------------------------------------------------------*/
+int set_fault_LED(struct andi_servo *board, BOOLEAN on)
+{
+	LG(TRACE, "int set_fault_LED(struct andi_servo *board, BOOLEAN on)\n");
+
+	board->FaultLED = on;
+
+	if (on)
+		board->control |= LED_MASK;
+	else
+		board->control &= ~LED_MASK;
+
+	OUT(board->control, board->base_address + LED);
 
 	return 0;
 }
@@ -780,6 +1202,12 @@ int get_position_error_threshold(struct andi_servo *board, int channel,
 {
 	LG(TRACE,
 	   "int get_position_error_threshold(struct andi_servo *board, int channel, int *position_error_threshold)\n");
+
+	if (channel)
+		*position_error_threshold = board->Channel1->position_error;
+	else
+		*position_error_threshold = board->Channel0->position_error;
+
 	return 0;
 }
 
@@ -814,6 +1242,12 @@ int get_irq_mask(struct andi_servo *board, int channel, int *irq_mask)
 {
 	LG(TRACE,
 	   "int get_irq_mask(struct andi_servo *board, int channel, int *irq_mask)\n");
+
+	if (channel)
+		*irq_mask = board->Channel1->irq_mask;
+	else
+		*irq_mask = board->Channel0->irq_mask;
+
 	return 0;
 }
 
@@ -824,6 +1258,12 @@ int get_PWM_brake(struct andi_servo *board, int channel, BOOLEAN * brake)
 {
 	LG(TRACE,
 	   "int get_PWM_brake(struct andi_servo *board, int channel, BOOLEAN * brake)\n");
+
+	if (channel)
+		*brake = board->Channel1->pwm_brake;
+	else
+		*brake = board->Channel0->pwm_brake;
+
 	return 0;
 }
 
@@ -876,6 +1316,147 @@ int init_board(struct andi_servo *board)
 	return 0;
 }
 
+/*---------------------------------------------------------------------+
+ |    int finish_op(struct andi_servo *board, int channel,             |
+ |                  struct lm629_op *op, int retval)                   |
+ |                                                                     |
+ |    Adds an operation to the channel's stats and passes its return   |
+ |    value on. The caller holds the channel's bus lock, so the stats  |
+ |    need no lock of their own.                                       |
+ +--------------------------------------------------------------------*/
+int finish_op(struct andi_servo *board, int channel, struct lm629_op *op,
+			  int retval)
+{
+	struct LM629_Op_Stats *stats;
+	u64 us;
+	int bucket;
+
+	us = (u64) (get_cycles() - op->start) * 1000;
+	if (cpu_khz)
+		do_div(us, cpu_khz);
+	else
+		us = 0;
+
+	if (channel)
+		stats = &board->Channel1->Ops[op->op];
+	else
+		stats = &board->Channel0->Ops[op->op];
+
+	stats->count++;
+	if (retval < 0)
+		stats->errors++;
+	stats->bytes_out += op->bytes_out;
+	stats->bytes_in += op->bytes_in;
+	stats->total_us += us;
+	if (us > stats->max_us)
+		stats->max_us = us;
+
+	for (bucket = 0; us && bucket < LM629_LATENCY_BUCKETS - 1; bucket++)
+		us >>= 1;
+	stats->histogram[bucket]++;
+
+	TRACE_POINT(TP_DONE, channel, op->op, retval, op->bytes_out,
+				op->bytes_in);
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------+
+ |    int get_bus_counts(struct ANDI_Bus *total)                       |
+ |                                                                     |
+ |    Adds up the port traffic counts of all the CPUs.                 |
+ +--------------------------------------------------------------------*/
+int get_bus_counts(struct ANDI_Bus *total)
+{
+	struct ANDI_Bus *counts;
+	int cpu, channel;
+
+	LG(TRACE, "int get_bus_counts(struct ANDI_Bus *total)\n");
+
+	memset(total, 0, sizeof (struct ANDI_Bus));
+
+	for (cpu = 0; cpu < NR_CPUS; cpu++)
+	{
+		counts = &bus_counts[cpu].counts;
+
+		for (channel = 0; channel < 2; channel++)
+		{
+			total->channel[channel].port_reads +=
+				counts->channel[channel].port_reads;
+			total->channel[channel].port_writes +=
+				counts->channel[channel].port_writes;
+			total->channel[channel].busy_retries +=
+				counts->channel[channel].busy_retries;
+			total->channel[channel].busy_failures +=
+				counts->channel[channel].busy_failures;
+			total->channel[channel].resets += counts->channel[channel].resets;
+			total->channel[channel].command_errors +=
+				counts->channel[channel].command_errors;
+		}
+
+		total->board_reads += counts->board_reads;
+		total->board_writes += counts->board_writes;
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    int check_filter(struct LM629_Filter *filter)                    |
+ |                                                                     |
+ |    Range checks a filter before it goes anywhere near the LM629.    |
+ |    The derivative sampling interval is sent as one byte less one,   |
+ |    and the gains and integration limit are 15 bit values.           |
+ +--------------------------------------------------------------------*/
+int check_filter(struct LM629_Filter *filter)
+{
+	LG(TRACE, "int check_filter(struct LM629_Filter *filter)\n");
+
+	if (filter->dterm < 1 || filter->dterm > 256)
+		return -EINVAL;
+
+	if (filter->kp < 0 || filter->kp > 0x7FFF)
+		return -EINVAL;
+	if (filter->ki < 0 || filter->ki > 0x7FFF)
+		return -EINVAL;
+	if (filter->kd < 0 || filter->kd > 0x7FFF)
+		return -EINVAL;
+	if (filter->il < 0 || filter->il > 0x7FFF)
+		return -EINVAL;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    int check_trajectory(struct LM629_Trajectory *trajectory)        |
+ |                                                                     |
+ |    Range checks a trajectory against the 30 bit LM629 registers,    |
+ |    and refuses to ask for a smooth and an abrupt stop at once.      |
+ +--------------------------------------------------------------------*/
+int check_trajectory(struct LM629_Trajectory *trajectory)
+{
+	LG(TRACE, "int check_trajectory(struct LM629_Trajectory *trajectory)\n");
+
+	if (trajectory->stop_smooth && trajectory->stop_abrupt)
+		return -EINVAL;
+
+	if (trajectory->load_acc &&
+		(trajectory->acc < 0 || trajectory->acc > LM629_MAXRANGE))
+		return -EINVAL;
+
+	if (trajectory->load_vel &&
+		(trajectory->velocity < -LM629_MAXRANGE
+		 || trajectory->velocity > LM629_MAXRANGE))
+		return -EINVAL;
+
+	if (trajectory->load_pos &&
+		(trajectory->position < -LM629_MAXRANGE - 1
+		 || trajectory->position > LM629_MAXRANGE))
+		return -EINVAL;
+
+	return 0;
+}
+
 /*---------------------------------------------------------------------+
  |    char * print_filter(struct LM629_Filter *filter)                 |
  +--------------------------------------------------------------------*/
@@ -941,6 +1522,37 @@ int print_trajectory(struct LM629_Trajectory *trajectory, char *buffer)
 	return len;
 }
 
+/*---------------------------------------------------------------------+
+ |int print_gain_status(struct LM629_Gain_Schedule *schedule,          |
+ |                      struct LM629_Gain_Status *status, char *buffer)|
+ +--------------------------------------------------------------------*/
+int print_gain_status(struct LM629_Gain_Schedule *schedule,
+					  struct LM629_Gain_Status *status, char *buffer)
+{
+	int len, i;
+
+	LG(TRACE,
+	   "int print_gain_status(struct LM629_Gain_Schedule *schedule, struct LM629_Gain_Status *status, char *buffer) ");
+
+	len = sprintf(buffer, "LM629 Gain Schedule\n");
+
+	for (i = 0; i < schedule->count; i++)
+		len += sprintf(buffer + len, "\t%c %s [%d, %d) : filter %d\n",
+					   i == status->active ? '*' : ' ',
+					   schedule->gain[i].trigger == LM629_GAIN_POSITION ?
+					   "position" : "velocity", schedule->gain[i].low,
+					   schedule->gain[i].high, schedule->gain[i].filter);
+
+	len += sprintf(buffer + len, "\tSwitches  : %u\n", status->switches);
+	len += sprintf(buffer + len, "\tPreloaded : %u\n", status->preloaded);
+	len += sprintf(buffer + len, "\tLast      : %u.%06u\n", status->tv_sec,
+				   status->tv_usec);
+
+	LG(TRACE, "%i characters stored in buffer\n", len);
+
+	return len;
+}
+
 /*---------------------------------------------------------------------+
  |    int print_status(int status, char *buffer)                       |
  +--------------------------------------------------------------------*/
@@ -1020,3 +1632,121 @@ int print_signals(int signals, char *buffer)
 	LG(TRACE, "%i characters stored in buffer\n", len);
 	return len;
 }
+
+static char *op_names[LM629_OPS] = {
+	"soft_reset",
+	"define_home",
+	"set_position_error",
+	"load_filter",
+	"update_filter",
+	"update_filters",
+	"load_trajectory",
+	"start_trajectory",
+	"get_status",
+	"get_signals",
+	"get_index_position",
+	"set_index_position",
+	"get_desired_position",
+	"get_real_position",
+	"get_desired_velocity",
+	"get_real_velocity",
+	"set_irq_mask",
+	"reset_interrupts",
+	"hard_reset"
+};
+
+/*---------------------------------------------------------------------+
+ |    char *op_name(int op)                                            |
+ +--------------------------------------------------------------------*/
+char *op_name(int op)
+{
+	if (op < 0 || op >= LM629_OPS)
+		return "?";
+
+	return op_names[op];
+}
+
+/*---------------------------------------------------------------------+
+ | int print_op_stats(int op, struct LM629_Op_Stats *stats,            |
+ |                    char *buffer)                                    |
+ |                                                                     |
+ | Prints nothing for an operation that has not been done. Only the    |
+ | histogram buckets with something in them are printed, each with its |
+ | upper bound.                                                        |
+ +--------------------------------------------------------------------*/
+int print_op_stats(int op, struct LM629_Op_Stats *stats, char *buffer)
+{
+	u64 mean;
+	int len, bucket;
+
+	LG(TRACE,
+	   "int print_op_stats(int op, struct LM629_Op_Stats *stats, char *buffer) ");
+
+	if (!stats->count)
+		return 0;
+
+	mean = stats->total_us;
+	do_div(mean, stats->count);
+
+	len = sprintf(buffer, "%-20s : %u calls, %u failed, %u bytes out, %u in\n",
+				  op_names[op], stats->count, stats->errors, stats->bytes_out,
+				  stats->bytes_in);
+	len += sprintf(buffer + len, "\tmean %lu us, max %u us\n",
+				   (unsigned long) mean, stats->max_us);
+
+	len += sprintf(buffer + len, "\t");
+	for (bucket = 0; bucket < LM629_LATENCY_BUCKETS; bucket++)
+	{
+		if (!stats->histogram[bucket])
+			continue;
+
+		if (bucket == LM629_LATENCY_BUCKETS - 1)
+			len += sprintf(buffer + len, " >=%luus:%u",
+						   1UL << (bucket - 1), stats->histogram[bucket]);
+		else
+			len += sprintf(buffer + len, " <%luus:%u", 1UL << bucket,
+						   stats->histogram[bucket]);
+	}
+	len += sprintf(buffer + len, "\n");
+
+	LG(TRACE, "%i characters stored in buffer\n", len);
+	return len;
+}
+
+/*---------------------------------------------------------------------+
+ |    int print_bus_counts(struct ANDI_Bus *counts, char *buffer)      |
+ +--------------------------------------------------------------------*/
+int print_bus_counts(struct ANDI_Bus *counts, char *buffer)
+{
+	int len, channel;
+
+	LG(TRACE, "int print_bus_counts(struct ANDI_Bus *counts, char *buffer) ");
+
+	len = sprintf(buffer, "ANDI-SERVO Port Traffic\n");
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		len += sprintf(buffer + len, "\tChannel %d\n", channel);
+		len += sprintf(buffer + len, "\t\tReads          : %u\n",
+					   counts->channel[channel].port_reads);
+		len += sprintf(buffer + len, "\t\tWrites         : %u\n",
+					   counts->channel[channel].port_writes);
+		len += sprintf(buffer + len, "\t\tBusy retries   : %u\n",
+					   counts->channel[channel].busy_retries);
+		len += sprintf(buffer + len, "\t\tBusy failures  : %u\n",
+					   counts->channel[channel].busy_failures);
+		len += sprintf(buffer + len, "\t\tResets         : %u\n",
+					   counts->channel[channel].resets);
+		len += sprintf(buffer + len, "\t\tCommand errors : %u\n",
+					   counts->channel[channel].command_errors);
+	}
+
+	len += sprintf(buffer + len, "\tBoard\n");
+	len += sprintf(buffer + len, "\t\tReads          : %u\n",
+				   counts->board_reads);
+	len += sprintf(buffer + len, "\t\tWrites         : %u\n",
+				   counts->board_writes);
+
+	LG(TRACE, "%i characters stored in buffer\n", len);
+	return len;
+}
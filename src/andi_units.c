@@ -0,0 +1,240 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <string.h>
+#include <andi_units.h>
+
+#define PI			3.14159265358979323846
+#define FIXED_ONE	65536.0			/* 1.0 in 16.16                         */
+
+/*---------------------------------------------------------------------+
+ | static int scale(const double *values, __s32 *counts, int n,        |
+ |                  double factor)                                     |
+ |                                                                     |
+ | values * factor, rounded to the nearest (halves away from zero) and |
+ | clamped to the LM629's range; -ERANGE if any was clamped. Every     |
+ | conversion goes through here, so one value and the same value in a  |
+ | batch come out the same. The loop has no calls and no branches,     |
+ | and works in 32 bits once rounded, so that with -ftree-vectorize    |
+ | -fno-trapping-math the compiler runs it a vector at a time.         |
+ +--------------------------------------------------------------------*/
+static int scale(const double *__restrict__ values,
+				 __s32 *__restrict__ counts, int n, double factor)
+{
+	double x;
+	int i, count, clamped;
+
+	clamped = 0;
+	for (i = 0; i < n; i++)
+	{
+		/* One past the range either way, so the cast is defined */
+		x = values[i] * factor;
+		x = x > LM629_MAXRANGE + 1.0 ? LM629_MAXRANGE + 1.0 : x;
+		x = x < -LM629_MAXRANGE - 1.0 ? -LM629_MAXRANGE - 1.0 : x;
+		count = (int) (x + __builtin_copysign(0.5, x));
+
+		clamped |= (count > LM629_MAXRANGE) | (count < -LM629_MAXRANGE);
+		count = count > LM629_MAXRANGE ? LM629_MAXRANGE : count;
+		counts[i] = count < -LM629_MAXRANGE ? -LM629_MAXRANGE : count;
+	}
+
+	return clamped ? -ERANGE : 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static long scale_one(double value, double factor)               |
+ +--------------------------------------------------------------------*/
+static long scale_one(double value, double factor)
+{
+	__s32 count;
+
+	scale(&value, &count, 1, factor);
+
+	return count;
+}
+
+/*---------------------------------------------------------------------+
+ | int andi_axis_configure(struct andi_axis *axis,                     |
+ |                         struct andi_axis_config *config)            |
+ +--------------------------------------------------------------------*/
+int andi_axis_configure(struct andi_axis *axis,
+						struct andi_axis_config *config)
+{
+	double counts_per_turn;
+
+	if (config->counts_per_rev == 0 || config->gear_ratio <= 0 ||
+		config->wheel_diameter < 0 || config->sample_s <= 0)
+		return -EINVAL;
+
+	memset(axis, 0, sizeof (struct andi_axis));
+	axis->config = *config;
+
+	counts_per_turn = config->counts_per_rev * config->gear_ratio;
+
+	axis->position[ANDI_UNIT_RAD] = counts_per_turn / (2 * PI);
+	if (config->wheel_diameter > 0)
+		axis->position[ANDI_UNIT_MM] =
+			counts_per_turn / (PI * config->wheel_diameter);
+
+	/* Per second to per sample interval, and to 16.16 */
+	axis->velocity[ANDI_UNIT_RAD] =
+		axis->position[ANDI_UNIT_RAD] * config->sample_s * FIXED_ONE;
+	axis->velocity[ANDI_UNIT_MM] =
+		axis->position[ANDI_UNIT_MM] * config->sample_s * FIXED_ONE;
+	axis->acc[ANDI_UNIT_RAD] =
+		axis->velocity[ANDI_UNIT_RAD] * config->sample_s;
+	axis->acc[ANDI_UNIT_MM] = axis->velocity[ANDI_UNIT_MM] * config->sample_s;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int check_unit(struct andi_axis *axis, int unit)          |
+ |                                                                     |
+ |    mm make no sense on an axis without a wheel.                     |
+ +--------------------------------------------------------------------*/
+static int check_unit(struct andi_axis *axis, int unit)
+{
+	if (unit < 0 || unit >= ANDI_UNITS || axis->position[unit] == 0)
+		return -EINVAL;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    Single values. An axis and unit that were not configured give 0. |
+ +--------------------------------------------------------------------*/
+long andi_position(struct andi_axis *axis, int unit, double position)
+{
+	if (check_unit(axis, unit) < 0)
+		return 0;
+
+	return scale_one(position, axis->position[unit]);
+}
+
+/* The LM629 takes the direction apart from the velocity */
+long andi_velocity(struct andi_axis *axis, int unit, double velocity)
+{
+	if (check_unit(axis, unit) < 0)
+		return 0;
+
+	return scale_one(velocity, axis->velocity[unit]);
+}
+
+long andi_acceleration(struct andi_axis *axis, int unit, double acc)
+{
+	if (check_unit(axis, unit) < 0)
+		return 0;
+
+	return scale_one(acc, axis->acc[unit]);
+}
+
+double andi_position_units(struct andi_axis *axis, int unit, long counts)
+{
+	if (check_unit(axis, unit) < 0)
+		return 0;
+
+	return counts / axis->position[unit];
+}
+
+double andi_velocity_units(struct andi_axis *axis, int unit, long velocity)
+{
+	if (check_unit(axis, unit) < 0)
+		return 0;
+
+	return velocity / axis->velocity[unit];
+}
+
+/*---------------------------------------------------------------------+
+ |    Batches                                                          |
+ +--------------------------------------------------------------------*/
+int andi_positions(struct andi_axis *axis, int unit, const double *positions,
+				   __s32 *counts, int n)
+{
+	if (check_unit(axis, unit) < 0 || n < 0)
+		return -EINVAL;
+
+	return scale(positions, counts, n, axis->position[unit]);
+}
+
+int andi_velocities(struct andi_axis *axis, int unit,
+					const double *velocities, __s32 *counts, int n)
+{
+	if (check_unit(axis, unit) < 0 || n < 0)
+		return -EINVAL;
+
+	return scale(velocities, counts, n, axis->velocity[unit]);
+}
+
+int andi_accelerations(struct andi_axis *axis, int unit, const double *accs,
+					   __s32 *counts, int n)
+{
+	if (check_unit(axis, unit) < 0 || n < 0)
+		return -EINVAL;
+
+	return scale(accs, counts, n, axis->acc[unit]);
+}
+
+/*---------------------------------------------------------------------+
+ | int andi_move(struct andi_axis *axis, int unit, double position,    |
+ |               double velocity, double acc,                          |
+ |               struct LM629_Trajectory *trajectory)                  |
+ |                                                                     |
+ | Loads all three. velocity and acc are magnitudes; -ERANGE if any    |
+ | value is beyond the LM629, or if the velocity or the acceleration   |
+ | would round to nothing.                                             |
+ +--------------------------------------------------------------------*/
+int andi_move(struct andi_axis *axis, int unit, double position,
+			  double velocity, double acc,
+			  struct LM629_Trajectory *trajectory)
+{
+	double values[3];
+	__s32 counts[3];
+	int retval;
+
+	if (check_unit(axis, unit) < 0 || velocity < 0 || acc < 0)
+		return -EINVAL;
+
+	values[0] = position * axis->position[unit];
+	values[1] = velocity * axis->velocity[unit];
+	values[2] = acc * axis->acc[unit];
+
+	retval = scale(values, counts, 3, 1.0);
+	if (retval < 0)
+		return retval;
+
+	if (counts[1] == 0 || counts[2] == 0)
+		return -ERANGE;
+
+	memset(trajectory, 0, sizeof (struct LM629_Trajectory));
+	trajectory->load_pos = TRUE;
+	trajectory->load_vel = TRUE;
+	trajectory->load_acc = TRUE;
+	trajectory->position = counts[0];
+	trajectory->velocity = counts[1];
+	trajectory->acc = counts[2];
+
+	return 0;
+}
@@ -0,0 +1,430 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver Benchmark                          |
+ |                                                                                |
+ |   Copyright (c) 1999, Mark Dennehy                                             |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+/*
+ * bench [-n ops] [-s scenario] [-p base]
+ *
+ * Runs the chip functions, built for user space, through fixed
+ * scenarios: filter reloads, trajectory loads, velocity streaming,
+ * status polling and a mix of all of them on both channels. Each
+ * scenario op is timed on the emulated board's clock, which only port
+ * accesses and delays move on, so a run gives the same figures every
+ * time and a change in them is a change in the driver. ops/s and the
+ * latencies are bus time; host ns/op is what the code itself costs on
+ * the machine running the benchmark. With -p the board at base is used
+ * instead of the emulator, and all the times are real.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <andi_servo.h>
+#include <tools.h>
+
+#define BASE_ADDRESS	0x300
+#define DEFAULT_OPS		10000
+
+struct bench_result
+{
+	unsigned long ops;
+	unsigned long errors;
+	unsigned long long *latency;	/* ns, one per op                       */
+	unsigned long long bus_ns;
+	unsigned long long host_ns;
+	unsigned long bytes;		/* LM629 command and data bytes         */
+	unsigned long accesses;		/* Port reads and writes, polls too     */
+};
+
+struct scenario
+{
+	char *name;
+	int (*run) (unsigned long i);
+};
+
+static struct andi_servo board;
+static struct LM629 channel0, channel1;
+static struct LM629_Filter filters[2];
+static struct LM629_Trajectory trajectories[2];
+
+static unsigned long seed = 1;
+
+/*---------------------------------------------------------------------+
+ |    static int filter_reload(int channel)                            |
+ |                                                                     |
+ |    A new set of gains, loaded and committed.                        |
+ +--------------------------------------------------------------------*/
+static int filter_reload(int channel)
+{
+	struct LM629_Filter *filter;
+	int retval;
+
+	filter = &filters[channel];
+	filter->dterm = 1 + next_random(&seed) % 4;
+	filter->kp = 1 + next_random(&seed) % 0x100;
+	filter->ki = next_random(&seed) % 0x10;
+	filter->kd = next_random(&seed) % 0x400;
+	filter->il = next_random(&seed) % 0x100;
+	userspace_channel(&board, channel)->NewFilter = filter;
+
+	retval = load_filter(&board, channel);
+	if (retval < 0)
+		return retval;
+
+	return update_filter(&board, channel);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int trajectory_load(int channel)                          |
+ |                                                                     |
+ |    A position move: acceleration, velocity and position, started.   |
+ +--------------------------------------------------------------------*/
+static int trajectory_load(int channel)
+{
+	struct LM629_Trajectory *trajectory;
+	int retval;
+
+	trajectory = &trajectories[channel];
+	memset(trajectory, 0, sizeof (struct LM629_Trajectory));
+	trajectory->load_acc = TRUE;
+	trajectory->load_vel = TRUE;
+	trajectory->load_pos = TRUE;
+	trajectory->acc = 1 + next_random(&seed) * 4;
+	trajectory->velocity = 0x10000 + next_random(&seed) * 64;
+	trajectory->position = (long) next_random(&seed) * 8 - 0x20000;
+	userspace_channel(&board, channel)->NewTrajectory = trajectory;
+
+	retval = load_trajectory(&board, channel);
+	if (retval < 0)
+		return retval;
+
+	return start_trajectory(&board, channel);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int velocity_update(int channel)                          |
+ |                                                                     |
+ |    What an outer loop streams: a velocity mode velocity, started.   |
+ +--------------------------------------------------------------------*/
+static int velocity_update(int channel)
+{
+	struct LM629_Trajectory *trajectory;
+	int retval;
+
+	trajectory = &trajectories[channel];
+	memset(trajectory, 0, sizeof (struct LM629_Trajectory));
+	trajectory->velocity_mode = TRUE;
+	trajectory->load_vel = TRUE;
+	trajectory->forward_dir = next_random(&seed) & 1;
+	trajectory->velocity = next_random(&seed) * 256;
+	userspace_channel(&board, channel)->NewTrajectory = trajectory;
+
+	retval = load_trajectory(&board, channel);
+	if (retval < 0)
+		return retval;
+
+	return start_trajectory(&board, channel);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int status_poll(int channel)                              |
+ |                                                                     |
+ |    What the sampler does: the status byte and the real position.    |
+ +--------------------------------------------------------------------*/
+static int status_poll(int channel)
+{
+	long position;
+	int status, retval;
+
+	retval = get_status(&board, channel, &status);
+	if (retval < 0)
+		return retval;
+
+	return get_real_position(&board, channel, &position);
+}
+
+/*---------------------------------------------------------------------+
+ |    The scenarios. i counts the ops of a scenario from 0.            |
+ +--------------------------------------------------------------------*/
+static int run_filter(unsigned long i)
+{
+	return filter_reload(0);
+}
+
+static int run_trajectory(unsigned long i)
+{
+	return trajectory_load(0);
+}
+
+static int run_velocity(unsigned long i)
+{
+	return velocity_update(0);
+}
+
+static int run_status(unsigned long i)
+{
+	return status_poll(0);
+}
+
+/* Both channels in turn: mostly polling and streaming, as in use */
+static int run_mixed(unsigned long i)
+{
+	int channel;
+
+	channel = i & 1;
+
+	switch ((i >> 1) % 8)
+	{
+	case 0:
+		return filter_reload(channel);
+
+	case 1:
+		return trajectory_load(channel);
+
+	case 2:
+	case 3:
+	case 4:
+		return velocity_update(channel);
+
+	default:
+		return status_poll(channel);
+	}
+}
+
+static struct scenario scenarios[] = {
+	{"filter", run_filter},
+	{"trajectory", run_trajectory},
+	{"velocity", run_velocity},
+	{"status", run_status},
+	{"mixed", run_mixed},
+	{NULL, NULL}
+};
+
+/*---------------------------------------------------------------------+
+ |    static unsigned long op_bytes(void)                              |
+ |                                                                     |
+ |    Bytes moved through the LM629 ports so far, as finish_op()       |
+ |    counted them on both channels.                                   |
+ +--------------------------------------------------------------------*/
+static unsigned long op_bytes(void)
+{
+	unsigned long bytes;
+	int op;
+
+	bytes = 0;
+	for (op = 0; op < LM629_OPS; op++)
+	{
+		bytes += channel0.Ops[op].bytes_out + channel0.Ops[op].bytes_in;
+		bytes += channel1.Ops[op].bytes_out + channel1.Ops[op].bytes_in;
+	}
+
+	return bytes;
+}
+
+/*---------------------------------------------------------------------+
+ |    static unsigned long port_accesses(void)                         |
+ +--------------------------------------------------------------------*/
+static unsigned long port_accesses(void)
+{
+	struct ANDI_Bus counts;
+
+	get_bus_counts(&counts);
+
+	return counts.channel[0].port_reads + counts.channel[0].port_writes +
+		counts.channel[1].port_reads + counts.channel[1].port_writes +
+		counts.board_reads + counts.board_writes;
+}
+
+/*---------------------------------------------------------------------+
+ | static void run_scenario(struct scenario *scenario,                 |
+ |                          struct bench_result *result)               |
+ +--------------------------------------------------------------------*/
+static void run_scenario(struct scenario *scenario,
+						 struct bench_result *result)
+{
+	unsigned long long host_start;
+	unsigned long bytes, accesses, i;
+	cycles_t start, bus_start;
+
+	seed = 1;
+
+	bytes = op_bytes();
+	accesses = port_accesses();
+	bus_start = get_cycles();
+	host_start = clock_ns();
+
+	for (i = 0; i < result->ops; i++)
+	{
+		start = get_cycles();
+		if (scenario->run(i) < 0)
+			result->errors++;
+		result->latency[i] = get_cycles() - start;
+	}
+
+	result->host_ns = clock_ns() - host_start;
+	result->bus_ns = get_cycles() - bus_start;
+	result->bytes = op_bytes() - bytes;
+	result->accesses = port_accesses() - accesses;
+}
+
+/*---------------------------------------------------------------------+
+ | static void print_result(struct scenario *scenario,                 |
+ |                          struct bench_result *result)               |
+ +--------------------------------------------------------------------*/
+static void print_result(struct scenario *scenario,
+						 struct bench_result *result)
+{
+	sort_latency(result->latency, result->ops);
+
+	printf("%-11s %7lu %9.0f %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %8.0f %6lu\n",
+		   scenario->name, result->ops,
+		   result->bus_ns ? result->ops * 1e9 / result->bus_ns : 0.0,
+		   percentile(result->latency, result->ops, 500),
+		   percentile(result->latency, result->ops, 990),
+		   percentile(result->latency, result->ops, 999),
+		   result->latency[result->ops - 1] / 1000.0,
+		   (double) result->bytes / result->ops,
+		   (double) result->accesses / result->ops,
+		   (double) result->host_ns / result->ops, result->errors);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int usage(char *name)                                     |
+ +--------------------------------------------------------------------*/
+static int usage(char *name)
+{
+	struct scenario *scenario;
+
+	fprintf(stderr, "usage: %s [-n ops] [-s scenario] [-p base]\n", name);
+	fprintf(stderr, "scenarios:");
+	for (scenario = scenarios; scenario->name; scenario++)
+		fprintf(stderr, " %s", scenario->name);
+	fprintf(stderr, "\n");
+
+	return 2;
+}
+
+/*---------------------------------------------------------------------+
+ |    int main(int argc, char **argv)                                  |
+ +--------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+	struct bench_result result;
+	struct scenario *scenario;
+	char *only;
+	unsigned long ops;
+	int backend, base, retval, c;
+
+	ops = DEFAULT_OPS;
+	only = NULL;
+	backend = USERSPACE_EMULATOR;
+	base = BASE_ADDRESS;
+
+	while ((c = getopt(argc, argv, "n:s:p:")) != -1)
+	{
+		switch (c)
+		{
+		case 'n':
+			ops = strtoul(optarg, NULL, 0);
+			break;
+
+		case 's':
+			only = optarg;
+			break;
+
+		case 'p':
+			backend = USERSPACE_PORTS;
+			base = strtol(optarg, NULL, 0);
+			break;
+
+		default:
+			return usage(argv[0]);
+		}
+	}
+
+	if (!ops || optind != argc)
+		return usage(argv[0]);
+
+	for (scenario = scenarios; only && scenario->name; scenario++)
+		if (!strcmp(only, scenario->name))
+			break;
+	if (only && !scenario->name)
+		return usage(argv[0]);
+
+	retval = userspace_open(backend, base);
+	if (retval < 0)
+	{
+		fprintf(stderr, "%s: cannot open the board: %s\n", argv[0],
+				strerror(-retval));
+		return 1;
+	}
+
+	userspace_board(&board, &channel0, &channel1);
+
+	if (hard_reset(&board, 0) < 0 || hard_reset(&board, 1) < 0)
+	{
+		fprintf(stderr, "%s: the board did not reset\n", argv[0]);
+		return 1;
+	}
+
+	result.latency = malloc(ops * sizeof (unsigned long long));
+	if (!result.latency)
+	{
+		perror(argv[0]);
+		return 1;
+	}
+
+	printf("%s, %lu ops a scenario; latencies in us\n",
+		   backend == USERSPACE_EMULATOR ? "emulated LM629" : "board",
+		   ops);
+	printf("%-11s %7s %9s %8s %8s %8s %8s %8s %8s %8s %6s\n",
+		   "scenario", "ops", "ops/s", "p50", "p99", "p999", "max",
+		   "bytes/op", "ports/op", "host ns", "errors");
+
+	retval = 0;
+	for (scenario = scenarios; scenario->name; scenario++)
+	{
+		if (only && strcmp(only, scenario->name))
+			continue;
+
+		result.ops = ops;
+		result.errors = 0;
+		run_scenario(scenario, &result);
+		print_result(scenario, &result);
+
+		if (result.errors)
+			retval = 1;
+	}
+
+	if (backend == USERSPACE_EMULATOR && userspace_emu.violations)
+	{
+		printf("emulator: %lu protocol violations\n",
+			   userspace_emu.violations);
+		retval = 1;
+	}
+
+	free(result.latency);
+	userspace_close();
+
+	return retval;
+}
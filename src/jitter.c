@@ -0,0 +1,390 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver Control loop jitter test           |
+ |                                                                                |
+ |   Copyright (c) 1999, Mark Dennehy                                             |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+/*
+ * jitter [-r rate] [-l loops] [-P priority] [-h us] [-k | -p base]
+ *
+ * The outer loop as the robot runs it: at each period, read both
+ * encoders, work out a velocity for each wheel, and send both as
+ * velocity mode trajectories. The loop sleeps to absolute deadlines
+ * under SCHED_FIFO with its memory locked, as cyclictest does, and
+ * time-stamps each cycle: the wake-up latency (how late after its
+ * deadline it woke) and the cycle time (from the deadline to the last
+ * trajectory started). A cycle that ends after the next deadline is an
+ * overrun. Both are printed as histograms, one bucket a microsecond.
+ *
+ * With -k the loop uses the driver in the kernel, through
+ * /dev/andi_servo; otherwise it runs the chip functions, built for user
+ * space, on the emulated board, or with -p on the board at base. The
+ * exit status is 1 if any cycle overran.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <andi_servo.h>
+#include <andi_client.h>
+#include <tools.h>
+
+#define BASE_ADDRESS	0x300
+#define DEFAULT_RATE	1000		/* Hz                                   */
+#define DEFAULT_LOOPS	10000
+#define DEFAULT_PRIO	80
+#define DEFAULT_BUCKETS	1000		/* us                                   */
+
+#define GAIN			64			/* Velocity per count of error          */
+#define AMPLITUDE		4000		/* Of the target, in counts             */
+
+struct histogram
+{
+	unsigned long *count;		/* One a microsecond                    */
+	unsigned long overflow;		/* Past the last bucket                 */
+	unsigned long long min;
+	unsigned long long max;
+	unsigned long long sum;		/* ns                                   */
+};
+
+static struct andi_servo board;
+static struct LM629 channel0, channel1;
+static struct LM629_Trajectory trajectories[2];
+
+static int kernel_mode;
+static struct andi_client client;
+static int buckets;
+
+/*---------------------------------------------------------------------+
+ |    static void sleep_until(unsigned long long ns)                   |
+ +--------------------------------------------------------------------*/
+static void sleep_until(unsigned long long ns)
+{
+	struct timespec deadline;
+
+	deadline.tv_sec = ns / 1000000000;
+	deadline.tv_nsec = ns % 1000000000;
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)
+		   == EINTR)
+		;
+}
+
+/*---------------------------------------------------------------------+
+ |    static void record(struct histogram *histogram,                  |
+ |                       unsigned long long ns)                        |
+ +--------------------------------------------------------------------*/
+static void record(struct histogram *histogram, unsigned long long ns)
+{
+	unsigned long long us;
+
+	us = ns / 1000;
+	if (us < buckets)
+		histogram->count[us]++;
+	else
+		histogram->overflow++;
+
+	if (ns < histogram->min)
+		histogram->min = ns;
+	if (ns > histogram->max)
+		histogram->max = ns;
+	histogram->sum += ns;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int read_position(int channel, long *position)            |
+ +--------------------------------------------------------------------*/
+static int read_position(int channel, long *position)
+{
+	struct LM629_Position position64;
+	int retval;
+
+	if (!kernel_mode)
+		return get_real_position(&board, channel, position);
+
+	retval = andi_get_position(&client, channel, &position64);
+	if (retval < 0)
+		return retval;
+
+	*position = (long) position64.position;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int send_velocity(int channel, long velocity)             |
+ +--------------------------------------------------------------------*/
+static int send_velocity(int channel, long velocity)
+{
+	struct LM629_Trajectory *trajectory;
+	int retval;
+
+	trajectory = &trajectories[channel];
+	trajectory->velocity_mode = TRUE;
+	trajectory->load_vel = TRUE;
+	trajectory->forward_dir = velocity >= 0;
+	trajectory->velocity = velocity >= 0 ? velocity : -velocity;
+	if (trajectory->velocity > LM629_MAXRANGE)
+		trajectory->velocity = LM629_MAXRANGE;
+
+	if (kernel_mode)
+	{
+		retval = andi_load_trajectory(&client, channel, trajectory);
+		if (retval < 0)
+			return retval;
+		return andi_start_trajectory(&client, channel);
+	}
+
+	(channel ? &channel1 : &channel0)->NewTrajectory = trajectory;
+
+	retval = load_trajectory(&board, channel);
+	if (retval < 0)
+		return retval;
+
+	return start_trajectory(&board, channel);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int cycle(unsigned long i, int rate)                      |
+ |                                                                     |
+ |    Read, compute, write: both wheels follow a triangle wave of      |
+ |    a second's period, opposite ways, with a proportional gain.      |
+ +--------------------------------------------------------------------*/
+static int cycle(unsigned long i, int rate)
+{
+	long position[2], target, phase;
+	int channel, retval;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		retval = read_position(channel, &position[channel]);
+		if (retval < 0)
+			return retval;
+	}
+
+	phase = i % rate;
+	target = (long) ((long long) (phase < rate / 2 ? phase : rate - phase) *
+					 4 * AMPLITUDE / rate) - AMPLITUDE;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		retval = send_velocity(channel, ((channel ? -target : target) -
+										 position[channel]) * GAIN);
+		if (retval < 0)
+			return retval;
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static void go_realtime(char *name, int priority)                |
+ |                                                                     |
+ |    Without root the loop still runs, and says that its figures      |
+ |    are not those of a real-time task.                               |
+ +--------------------------------------------------------------------*/
+static void go_realtime(char *name, int priority)
+{
+	struct sched_param param;
+	char stack[64 * 1024];
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+		fprintf(stderr, "%s: mlockall: %s; memory not locked\n", name,
+				strerror(errno));
+
+	/* Fault the stack in now, not in the first cycles */
+	memset(stack, 0, sizeof (stack));
+
+	param.sched_priority = priority;
+	if (sched_setscheduler(0, SCHED_FIFO, &param) < 0)
+		fprintf(stderr, "%s: SCHED_FIFO: %s; running as a normal task\n",
+				name, strerror(errno));
+}
+
+/*---------------------------------------------------------------------+
+ | static void print_histogram(char *title, struct histogram *histogram,|
+ |                             unsigned long loops)                    |
+ +--------------------------------------------------------------------*/
+static void print_histogram(char *title, struct histogram *histogram,
+							unsigned long loops)
+{
+	int us;
+
+	printf("%s: min %.1f avg %.1f max %.1f us\n", title,
+		   histogram->min / 1000.0, histogram->sum / 1000.0 / loops,
+		   histogram->max / 1000.0);
+
+	for (us = 0; us < buckets; us++)
+		if (histogram->count[us])
+			printf("  %6d %10lu\n", us, histogram->count[us]);
+	if (histogram->overflow)
+		printf("  >%5d %10lu\n", buckets - 1, histogram->overflow);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int usage(char *name)                                     |
+ +--------------------------------------------------------------------*/
+static int usage(char *name)
+{
+	fprintf(stderr,
+			"usage: %s [-r rate] [-l loops] [-P priority] [-h us] [-k | -p base]\n",
+			name);
+
+	return 2;
+}
+
+/*---------------------------------------------------------------------+
+ |    int main(int argc, char **argv)                                  |
+ +--------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+	struct histogram latency, cycles;
+	unsigned long long period, deadline, woke, done;
+	unsigned long loops, overruns, errors, i;
+	int rate, priority, backend, base, retval, c;
+
+	rate = DEFAULT_RATE;
+	loops = DEFAULT_LOOPS;
+	priority = DEFAULT_PRIO;
+	buckets = DEFAULT_BUCKETS;
+	backend = USERSPACE_EMULATOR;
+	base = BASE_ADDRESS;
+
+	while ((c = getopt(argc, argv, "r:l:P:h:kp:")) != -1)
+	{
+		switch (c)
+		{
+		case 'r':
+			rate = atoi(optarg);
+			break;
+
+		case 'l':
+			loops = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'P':
+			priority = atoi(optarg);
+			break;
+
+		case 'h':
+			buckets = atoi(optarg);
+			break;
+
+		case 'k':
+			kernel_mode = TRUE;
+			break;
+
+		case 'p':
+			backend = USERSPACE_PORTS;
+			base = strtol(optarg, NULL, 0);
+			break;
+
+		default:
+			return usage(argv[0]);
+		}
+	}
+
+	if (rate < 1 || rate > 1000000 || !loops || buckets < 1 ||
+		optind != argc)
+		return usage(argv[0]);
+
+	memset(&latency, 0, sizeof (latency));
+	memset(&cycles, 0, sizeof (cycles));
+	latency.count = calloc(buckets, sizeof (unsigned long));
+	cycles.count = calloc(buckets, sizeof (unsigned long));
+	if (!latency.count || !cycles.count)
+	{
+		perror(argv[0]);
+		return 1;
+	}
+	latency.min = cycles.min = ~0ULL;
+
+	if (kernel_mode)
+		retval = andi_open(&client, 0);
+	else
+	{
+		retval = userspace_open(backend, base);
+		if (retval >= 0)
+		{
+			userspace_board(&board, &channel0, &channel1);
+			retval = hard_reset(&board, 0);
+			if (retval >= 0)
+				retval = hard_reset(&board, 1);
+		}
+	}
+	if (retval < 0)
+	{
+		fprintf(stderr, "%s: cannot open the board: %s\n", argv[0],
+				strerror(-retval));
+		return 1;
+	}
+
+	go_realtime(argv[0], priority);
+
+	printf("%s, %d Hz, %lu loops\n",
+		   kernel_mode ? "/dev/andi_servo" :
+		   backend == USERSPACE_EMULATOR ? "emulated LM629" : "board",
+		   rate, loops);
+
+	period = 1000000000ULL / rate;
+	overruns = 0;
+	errors = 0;
+
+	deadline = clock_ns() + period;
+	for (i = 0; i < loops; i++)
+	{
+		sleep_until(deadline);
+		woke = clock_ns();
+
+		if (cycle(i, rate) < 0)
+			errors++;
+
+		done = clock_ns();
+
+		record(&latency, woke - deadline);
+		record(&cycles, done - deadline);
+
+		deadline += period;
+		if (done > deadline)
+		{
+			overruns++;
+
+			/* Skip the periods missed, as a controller would */
+			while (deadline < done)
+				deadline += period;
+		}
+	}
+
+	print_histogram("wake-up latency", &latency, loops);
+	print_histogram("cycle time", &cycles, loops);
+	printf("overruns: %lu of %lu (period %.1f us)\n", overruns, loops,
+		   period / 1000.0);
+	printf("errors: %lu\n", errors);
+
+	if (kernel_mode)
+		andi_close(&client);
+	else
+		userspace_close();
+
+	return overruns || errors ? 1 : 0;
+}
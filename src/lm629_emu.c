@@ -0,0 +1,606 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#include <string.h>
+#include <andi_servo.h>
+#include <lm629_emu.h>
+
+/* Status bits RSTI can clear */
+#define EMU_INTERRUPT_FLAGS		0x7e
+
+/*---------------------------------------------------------------------+
+ | static void emu_reset(struct lm629_emu_chip *chip,                  |
+ |                       unsigned long long now)                       |
+ |                                                                     |
+ | Power on state: motor off, trajectory complete, nothing loaded.     |
+ +--------------------------------------------------------------------*/
+static void emu_reset(struct lm629_emu_chip *chip, unsigned long long now)
+{
+	memset(chip, 0, sizeof (struct lm629_emu_chip));
+
+	chip->status = MOTOR_OFF | TRAJECTORY_COMPLETE;
+	chip->command = -1;
+	chip->busy_until = now + EMU_RESET_NS;
+	chip->filter.dterm = 1;
+	chip->new_filter.dterm = 1;
+	chip->next_sample = now + EMU_SAMPLE_NS;
+}
+
+/*---------------------------------------------------------------------+
+ |    static long long index_of(long long position)                    |
+ |                                                                     |
+ |    Which index pulse interval a position (counts * 65536) is in.    |
+ +--------------------------------------------------------------------*/
+static long long index_of(long long position)
+{
+	long long counts;
+
+	counts = position >> 16;
+	if (counts < 0)
+		return (counts + 1) / EMU_INDEX_COUNTS - 1;
+
+	return counts / EMU_INDEX_COUNTS;
+}
+
+/*---------------------------------------------------------------------+
+ |    static void emu_complete(struct lm629_emu_chip *chip)            |
+ +--------------------------------------------------------------------*/
+static void emu_complete(struct lm629_emu_chip *chip)
+{
+	chip->velocity = 0;
+	chip->stopping = FALSE;
+	chip->target = chip->position >> 16;
+	chip->status |= TRAJECTORY_COMPLETE;
+}
+
+/*---------------------------------------------------------------------+
+ |    static void emu_sample(struct lm629_emu_chip *chip)              |
+ |                                                                     |
+ |    One sample interval of the trajectory generator. Velocity ramps  |
+ |    at the acceleration; in position mode the ramp down starts when  |
+ |    the stopping distance reaches the distance to go.                |
+ +--------------------------------------------------------------------*/
+static void emu_sample(struct lm629_emu_chip *chip)
+{
+	long long speed, remaining, stopping, before;
+	int direction;
+
+	if ((chip->status & MOTOR_OFF) || (chip->status & TRAJECTORY_COMPLETE))
+		return;
+
+	before = chip->position;
+
+	if (chip->velocity_mode || chip->stopping)
+	{
+		long long target;
+
+		target = 0;
+		if (!chip->stopping)
+			target = chip->forward ? chip->max_velocity : -chip->max_velocity;
+
+		if (!chip->acc)
+			chip->velocity = target;
+		else if (chip->velocity < target)
+			chip->velocity = chip->velocity + chip->acc < target ?
+				chip->velocity + chip->acc : target;
+		else if (chip->velocity > target)
+			chip->velocity = chip->velocity - chip->acc > target ?
+				chip->velocity - chip->acc : target;
+
+		chip->position += chip->velocity;
+
+		if (chip->stopping && !chip->velocity)
+			emu_complete(chip);
+	}
+	else
+	{
+		remaining = (chip->target << 16) - chip->position;
+		direction = remaining < 0 ? -1 : 1;
+		if (remaining < 0)
+			remaining = -remaining;
+
+		speed = chip->velocity < 0 ? -chip->velocity : chip->velocity;
+
+		if (!chip->acc)
+			speed = chip->max_velocity;
+		else
+		{
+			stopping = speed * speed / (2 * chip->acc);
+			if (stopping >= remaining)
+				speed = speed - chip->acc > chip->acc ?
+					speed - chip->acc : chip->acc;
+			else
+				speed = speed + chip->acc < chip->max_velocity ?
+					speed + chip->acc : chip->max_velocity;
+		}
+
+		if (!remaining || speed >= remaining)
+		{
+			chip->position = chip->target << 16;
+			emu_complete(chip);
+		}
+		else
+		{
+			chip->velocity = direction * speed;
+			chip->position += chip->velocity;
+		}
+	}
+
+	if (chip->acquire_index && index_of(before) != index_of(chip->position))
+	{
+		chip->index_position = chip->position >> 16;
+		chip->acquire_index = FALSE;
+		chip->status |= INDEX_PULSE;
+	}
+}
+
+/*---------------------------------------------------------------------+
+ | static void emu_start(struct lm629_emu_chip *chip)                  |
+ |                                                                     |
+ | STT: the trajectory loaded by LTRJ takes effect.                    |
+ +--------------------------------------------------------------------*/
+static void emu_start(struct lm629_emu_chip *chip)
+{
+	int control;
+
+	control = chip->load_control;
+
+	if (control & LOAD_ACCELERATION)
+		chip->acc = (control & ACCELERATION_RELATIVE) ?
+			chip->acc + chip->load_acc : chip->load_acc;
+	if (control & LOAD_VELOCITY)
+		chip->max_velocity = (control & VELOCITY_RELATIVE) ?
+			chip->max_velocity + chip->load_velocity : chip->load_velocity;
+	if (control & LOAD_POSITION)
+		chip->target = (control & POSITION_RELATIVE) ?
+			chip->target + chip->load_position : chip->load_position;
+
+	chip->velocity_mode = (control & VELOCITY_MODE) != 0;
+	chip->forward = (control & FORWARD_DIRECTION) != 0;
+	chip->stopping = FALSE;
+
+	if (control & TURN_MOTOR_OFF)
+	{
+		chip->status |= MOTOR_OFF;
+		emu_complete(chip);
+	}
+	else if (control & ABRUPT_STOP)
+	{
+		chip->status &= ~MOTOR_OFF;
+		emu_complete(chip);
+	}
+	else
+	{
+		chip->status &= ~(MOTOR_OFF | TRAJECTORY_COMPLETE);
+		chip->stopping = (control & SMOOTH_STOP) != 0;
+	}
+
+	chip->load_control = 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int emu_signals(struct lm629_emu_chip *chip)              |
+ +--------------------------------------------------------------------*/
+static int emu_signals(struct lm629_emu_chip *chip)
+{
+	int signals;
+
+	signals = chip->status & 0xfe;
+
+	if (chip->status & chip->irq_mask & EMU_INTERRUPT_FLAGS)
+		signals |= HOST_INTERRUPT;
+	if (chip->velocity_mode)
+		signals |= VELOCITY_MODE;
+	if (chip->forward)
+		signals |= FORWARD_DIRECTION;
+	if (chip->status & TRAJECTORY_COMPLETE)
+		signals |= ON_TARGET;
+	if (chip->stop_on_error)
+		signals |= TURN_OFF_ON_POS_ERROR;
+	if (chip->acquire_index)
+		signals |= ACQUIRE_NEXT_INDEX;
+
+	return signals;
+}
+
+/*---------------------------------------------------------------------+
+ |    static void emu_error(struct lm629_emu *emu,                     |
+ |                          struct lm629_emu_chip *chip)               |
+ +--------------------------------------------------------------------*/
+static void emu_error(struct lm629_emu *emu, struct lm629_emu_chip *chip)
+{
+	chip->status |= COMMAND_ERROR;
+	emu->violations++;
+}
+
+/*---------------------------------------------------------------------+
+ | static void emu_command(struct lm629_emu *emu,                      |
+ |                         struct lm629_emu_chip *chip, int command,   |
+ |                         unsigned long long now)                     |
+ +--------------------------------------------------------------------*/
+static void emu_command(struct lm629_emu *emu, struct lm629_emu_chip *chip,
+						int command, unsigned long long now)
+{
+	long long position;
+
+	emu->commands++;
+
+	if (now < chip->busy_until)
+		emu->violations++;
+
+	/* The last command was not given all its data */
+	if (chip->command >= 0 && !chip->reading && chip->bytes < chip->expect)
+		emu_error(emu, chip);
+
+	chip->command = command;
+	chip->reading = FALSE;
+	chip->bytes = 0;
+	chip->expect = 0;
+	chip->busy_until = now + EMU_COMMAND_NS;
+
+	position = chip->position >> 16;
+
+	switch (command)
+	{
+	case RESET:
+		emu_reset(chip, now);
+		break;
+
+	case DFH:
+		chip->target -= position;
+		chip->position -= position << 16;
+		chip->command = -1;
+		break;
+
+	case SIP:
+		chip->acquire_index = TRUE;
+		chip->command = -1;
+		break;
+
+	case UDF:
+		chip->filter = chip->new_filter;
+		chip->command = -1;
+		break;
+
+	case STT:
+		emu_start(chip);
+		chip->command = -1;
+		break;
+
+	case LPEI:
+	case LPES:
+	case MSKI:
+	case RSTI:
+	case LFIL:
+	case LTRJ:
+		chip->expect = 2;
+		break;
+
+	case SBPA:
+	case SBPR:
+		chip->expect = 4;
+		break;
+
+	case RDSIGS:
+		chip->reading = TRUE;
+		chip->result = emu_signals(chip);
+		chip->expect = 2;
+		break;
+
+	case RDSUM:
+		chip->reading = TRUE;
+		chip->result = 0;
+		chip->expect = 2;
+		break;
+
+	case RDIP:
+		chip->reading = TRUE;
+		chip->result = chip->index_position;
+		chip->expect = 4;
+		break;
+
+	case RDDP:
+	case RDRP:
+		chip->reading = TRUE;
+		chip->result = (__u32) position;
+		chip->expect = 4;
+		break;
+
+	case RDDV:
+	case RDRV:
+		chip->reading = TRUE;
+		chip->result = (__u32) chip->velocity;
+		chip->expect = 4;
+		break;
+
+	default:
+		chip->command = -1;
+		emu_error(emu, chip);
+		break;
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |    static __u32 emu_word(struct lm629_emu_chip *chip, int n)        |
+ |                                                                     |
+ |    The n'th 16 bit word of data written, high byte first.           |
+ +--------------------------------------------------------------------*/
+static __u32 emu_word(struct lm629_emu_chip *chip, int n)
+{
+	return (chip->data[2 * n] << 8) | chip->data[2 * n + 1];
+}
+
+/*---------------------------------------------------------------------+
+ |    static void emu_data(struct lm629_emu_chip *chip)                |
+ |                                                                     |
+ |    A word of data has come in. The first word of LFIL and LTRJ     |
+ |    says how many follow; when they are all in, the command is done. |
+ +--------------------------------------------------------------------*/
+static void emu_data(struct lm629_emu_chip *chip)
+{
+	int control, n;
+
+	if (chip->bytes == 2 && chip->command == LFIL)
+	{
+		control = chip->data[1];
+		chip->expect += (control & LOAD_Kp) ? 2 : 0;
+		chip->expect += (control & LOAD_Ki) ? 2 : 0;
+		chip->expect += (control & LOAD_Kd) ? 2 : 0;
+		chip->expect += (control & LOAD_Il) ? 2 : 0;
+	}
+
+	if (chip->bytes == 2 && chip->command == LTRJ)
+	{
+		control = emu_word(chip, 0);
+		chip->expect += (control & LOAD_ACCELERATION) ? 4 : 0;
+		chip->expect += (control & LOAD_VELOCITY) ? 4 : 0;
+		chip->expect += (control & LOAD_POSITION) ? 4 : 0;
+	}
+
+	if (chip->bytes < chip->expect)
+		return;
+
+	switch (chip->command)
+	{
+	case LPEI:
+	case LPES:
+		chip->position_error = emu_word(chip, 0);
+		chip->stop_on_error = chip->command == LPES;
+		break;
+
+	case MSKI:
+		chip->irq_mask = chip->data[1] & EMU_INTERRUPT_FLAGS;
+		break;
+
+	case RSTI:
+		chip->status &= chip->data[1] | ~EMU_INTERRUPT_FLAGS;
+		break;
+
+	case LFIL:
+		control = chip->data[1];
+		chip->new_filter.dterm = chip->data[0] + 1;
+		n = 1;
+		if (control & LOAD_Kp)
+			chip->new_filter.kp = emu_word(chip, n++);
+		if (control & LOAD_Ki)
+			chip->new_filter.ki = emu_word(chip, n++);
+		if (control & LOAD_Kd)
+			chip->new_filter.kd = emu_word(chip, n++);
+		if (control & LOAD_Il)
+			chip->new_filter.il = emu_word(chip, n++);
+		break;
+
+	case LTRJ:
+		control = emu_word(chip, 0);
+		chip->load_control = control;
+		n = 1;
+		if (control & LOAD_ACCELERATION)
+		{
+			chip->load_acc = (emu_word(chip, n) << 16) | emu_word(chip, n + 1);
+			n += 2;
+		}
+		if (control & LOAD_VELOCITY)
+		{
+			chip->load_velocity =
+				(emu_word(chip, n) << 16) | emu_word(chip, n + 1);
+			n += 2;
+		}
+		if (control & LOAD_POSITION)
+		{
+			chip->load_position =
+				(emu_word(chip, n) << 16) | emu_word(chip, n + 1);
+			n += 2;
+		}
+		break;
+	}
+
+	chip->command = -1;
+}
+
+/*---------------------------------------------------------------------+
+ | void lm629_emu_init(struct lm629_emu *emu, unsigned long long now)  |
+ |                                                                     |
+ | A board powered up long enough ago for the LM629s to be ready.      |
+ +--------------------------------------------------------------------*/
+void lm629_emu_init(struct lm629_emu *emu, unsigned long long now)
+{
+	int channel;
+
+	memset(emu, 0, sizeof (struct lm629_emu));
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		emu_reset(&emu->chip[channel], now);
+		emu->chip[channel].busy_until = now;
+	}
+}
+
+/*---------------------------------------------------------------------+
+ | void lm629_emu_run(struct lm629_emu *emu, unsigned long long now)   |
+ |                                                                     |
+ | Brings the motion of both LM629s up to time now.                    |
+ +--------------------------------------------------------------------*/
+void lm629_emu_run(struct lm629_emu *emu, unsigned long long now)
+{
+	struct lm629_emu_chip *chip;
+	int channel;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		chip = &emu->chip[channel];
+
+		while (chip->next_sample <= now)
+		{
+			emu_sample(chip);
+			chip->next_sample += EMU_SAMPLE_NS;
+		}
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |    unsigned char lm629_emu_inb(struct lm629_emu *emu, int port,     |
+ |                                unsigned long long now)              |
+ |                                                                     |
+ |    port is the offset from the board's base address.                |
+ +--------------------------------------------------------------------*/
+unsigned char lm629_emu_inb(struct lm629_emu *emu, int port,
+							unsigned long long now)
+{
+	struct lm629_emu_chip *chip;
+	int value;
+
+	lm629_emu_run(emu, now);
+
+	switch (port)
+	{
+	case COMMAND_0:
+	case COMMAND_1:
+		chip = &emu->chip[port == COMMAND_1];
+		value = chip->status;
+		if (now < chip->busy_until)
+			value |= BUSY_BIT;
+		return value;
+
+	case DATA_0:
+	case DATA_1:
+		chip = &emu->chip[port == DATA_1];
+
+		if (chip->command < 0 || !chip->reading || chip->bytes >= chip->expect)
+		{
+			emu_error(emu, chip);
+			return 0;
+		}
+		if (now < chip->busy_until)
+			emu->violations++;
+
+		value = (chip->result >> (8 * (chip->expect - 1 - chip->bytes)));
+		chip->bytes++;
+
+		if (!(chip->bytes & 1))
+			chip->busy_until = now + EMU_WORD_NS;
+		if (chip->bytes == chip->expect)
+			chip->command = -1;
+
+		return value & 0xff;
+
+	case IRQCAUSE:
+		value = 0;
+		if (emu->chip[0].status & emu->chip[0].irq_mask & EMU_INTERRUPT_FLAGS)
+			value |= CHANNEL0_LM629_IRQ;
+		if (emu->chip[1].status & emu->chip[1].irq_mask & EMU_INTERRUPT_FLAGS)
+			value |= CHANNEL1_LM629_IRQ;
+		return value;
+
+	default:
+		return 0;
+	}
+}
+
+/*---------------------------------------------------------------------+
+ | void lm629_emu_outb(struct lm629_emu *emu, int port,                |
+ |                     unsigned char value, unsigned long long now)    |
+ +--------------------------------------------------------------------*/
+void lm629_emu_outb(struct lm629_emu *emu, int port, unsigned char value,
+					unsigned long long now)
+{
+	struct lm629_emu_chip *chip;
+
+	lm629_emu_run(emu, now);
+
+	switch (port)
+	{
+	case COMMAND_0:
+	case COMMAND_1:
+		emu_command(emu, &emu->chip[port == COMMAND_1], value, now);
+		break;
+
+	case DATA_0:
+	case DATA_1:
+		chip = &emu->chip[port == DATA_1];
+
+		if (chip->command < 0 || chip->reading || chip->bytes >= chip->expect)
+		{
+			emu_error(emu, chip);
+			break;
+		}
+		if (now < chip->busy_until)
+			emu->violations++;
+
+		chip->data[chip->bytes++] = value;
+
+		if (!(chip->bytes & 1))
+		{
+			chip->busy_until = now + EMU_WORD_NS;
+			emu_data(chip);
+		}
+		break;
+
+	case PWM_BRAKES:
+		emu->brakes = value;
+		break;
+
+	case HARD_RESET:
+		/* Each LM629 is reset when its line is asserted */
+		if ((value & 0x01) && !(emu->reset_lines & 0x01))
+			emu_reset(&emu->chip[0], now);
+		if ((value & 0x02) && !(emu->reset_lines & 0x02))
+			emu_reset(&emu->chip[1], now);
+		emu->reset_lines = value;
+		break;
+
+	case IRQENABLE:
+		emu->control = value;
+		break;
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |    long lm629_emu_position(struct lm629_emu *emu, int channel)      |
+ |                                                                     |
+ |    Where the motor really is, in counts.                            |
+ +--------------------------------------------------------------------*/
+long lm629_emu_position(struct lm629_emu *emu, int channel)
+{
+	return (long) (emu->chip[channel].position >> 16);
+}
@@ -0,0 +1,276 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#include <odometry.h>
+
+#define TRACE TRUE
+
+#ifndef __KERNEL__
+#	define __KERNEL__
+#endif
+
+#ifndef MODULE
+#	define EXPORT_NO_SYMBOLS
+#	define MODULE
+#endif
+
+#define __NO_VERSION__
+
+/*
+ * sin() over the first quadrant in 256 steps, Q16. The other quadrants
+ * are folded onto this one and steps are linearly interpolated.
+ */
+static const int sine_table[257] = {
+	0, 402, 804, 1206, 1608, 2010, 2412, 2814,
+	3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023,
+	6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+	9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391,
+	12785, 13180, 13573, 13966, 14359, 14751, 15143, 15534,
+	15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+	19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699,
+	22078, 22457, 22834, 23210, 23586, 23961, 24335, 24708,
+	25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+	28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538,
+	30893, 31248, 31600, 31952, 32303, 32652, 33000, 33347,
+	33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+	36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716,
+	39040, 39362, 39683, 40002, 40320, 40636, 40951, 41264,
+	41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+	44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056,
+	46341, 46624, 46906, 47186, 47464, 47741, 48015, 48288,
+	48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+	50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398,
+	52639, 52878, 53114, 53349, 53581, 53812, 54040, 54267,
+	54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+	56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607,
+	57798, 57986, 58172, 58356, 58538, 58718, 58896, 59071,
+	59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+	60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568,
+	61705, 61839, 61971, 62101, 62228, 62353, 62476, 62596,
+	62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+	63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197,
+	64277, 64354, 64429, 64501, 64571, 64639, 64704, 64766,
+	64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+	65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436,
+	65457, 65476, 65492, 65505, 65516, 65525, 65531, 65535,
+	65536
+};
+
+/*---------------------------------------------------------------------+
+ | int odometry_configure(struct andi_odometry *odometry,              |
+ |                        struct ANDI_Odometry *config)                |
+ |                                                                     |
+ | Works out the per-count and per-turn factors once so that the       |
+ | update needs only multiplies and shifts. Does not move the pose.    |
+ +--------------------------------------------------------------------*/
+int odometry_configure(struct andi_odometry *odometry,
+					   struct ANDI_Odometry *config)
+{
+	u64 n;
+	int i;
+
+	LG(TRACE,
+	   "int odometry_configure(struct andi_odometry *odometry, struct ANDI_Odometry *config)\n");
+
+	if (config->wheel_base < 1000)
+		return -EINVAL;
+
+	for (i = 0; i < 2; i++)
+		if (!config->counts_per_metre[i])
+			return -EINVAL;
+
+	odometry->config = *config;
+
+	for (i = 0; i < 2; i++)
+	{
+		n = (u64) 1000000 << ODOMETRY_SHIFT;
+		if (config->counts_per_metre[i] < 0)
+		{
+			do_div(n, -config->counts_per_metre[i]);
+			odometry->scale[i] = -(s64) n;
+		}
+		else
+		{
+			do_div(n, config->counts_per_metre[i]);
+			odometry->scale[i] = n;
+		}
+	}
+
+	/* 2^32 / (2 pi wheel_base), Q8, with 2 pi taken as 710/113 */
+	n = (u64) 1 << (32 + ODOMETRY_TURN_SHIFT);
+	do_div(n, config->wheel_base);
+	n *= 113;
+	do_div(n, 710);
+	odometry->turn = n;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ | void odometry_set_pose(struct andi_odometry *odometry,              |
+ |                        struct ANDI_Pose *pose)                      |
+ +--------------------------------------------------------------------*/
+void odometry_set_pose(struct andi_odometry *odometry, struct ANDI_Pose *pose)
+{
+	LG(TRACE,
+	   "void odometry_set_pose(struct andi_odometry *odometry, struct ANDI_Pose *pose)\n");
+
+	odometry->x = (s64) pose->x << ODOMETRY_SHIFT;
+	odometry->y = (s64) pose->y << ODOMETRY_SHIFT;
+	odometry->heading = pose->heading;
+
+	odometry->pose.x = pose->x;
+	odometry->pose.y = pose->y;
+	odometry->pose.heading = pose->heading;
+}
+
+/*---------------------------------------------------------------------+
+ | void odometry_restart(struct andi_odometry *odometry)               |
+ |                                                                     |
+ | Forgets the last encoder counts, for when the counters are redefined|
+ | under the integrator. The next update only records the new counts.  |
+ +--------------------------------------------------------------------*/
+void odometry_restart(struct andi_odometry *odometry)
+{
+	LG(TRACE, "void odometry_restart(struct andi_odometry *odometry)\n");
+
+	odometry->primed = FALSE;
+}
+
+/*---------------------------------------------------------------------+
+ | void odometry_update(struct andi_odometry *odometry, long left,     |
+ |                      long right, struct timeval *tv)                |
+ |                                                                     |
+ | Integrates one pair of encoder readings. Runs from the sampler, so  |
+ | no tracing. The counts are the raw 32 bit LM629 positions; the      |
+ | deltas are taken modulo 2^32 so counter wrap is harmless. The arc is|
+ | approximated by a chord at the mean heading over the sample.        |
+ +--------------------------------------------------------------------*/
+void odometry_update(struct andi_odometry *odometry, long left, long right,
+					 struct timeval *tv)
+{
+	s32 delta[2];
+	s64 l, r, d;
+	s32 turn;
+	u32 mean;
+
+	delta[0] = (s32) left - odometry->last[0];
+	delta[1] = (s32) right - odometry->last[1];
+
+	odometry->last[0] = (s32) left;
+	odometry->last[1] = (s32) right;
+
+	odometry->pose.tv_sec = tv->tv_sec;
+	odometry->pose.tv_usec = tv->tv_usec;
+
+	if (!odometry->primed)
+	{
+		odometry->primed = TRUE;
+		return;
+	}
+
+	if (!odometry->turn)
+		return;
+
+	if (!delta[0] && !delta[1])
+		return;
+
+	l = delta[0] * odometry->scale[0];
+	r = delta[1] * odometry->scale[1];
+
+	turn = (s32) (((r - l) * odometry->turn) >>
+				  (ODOMETRY_SHIFT + ODOMETRY_TURN_SHIFT));
+	mean = odometry->heading + turn / 2;
+	d = (l + r) >> 1;
+
+	odometry->x += (d * odometry_cos(mean)) >> 16;
+	odometry->y += (d * odometry_sin(mean)) >> 16;
+	odometry->heading += turn;
+
+	odometry->pose.x = (s32) (odometry->x >> ODOMETRY_SHIFT);
+	odometry->pose.y = (s32) (odometry->y >> ODOMETRY_SHIFT);
+	odometry->pose.heading = odometry->heading;
+}
+
+/*---------------------------------------------------------------------+
+ | int odometry_sin(u32 angle)                                         |
+ +--------------------------------------------------------------------*/
+int odometry_sin(u32 angle)
+{
+	u32 u;
+	int i, f, v;
+
+	u = angle & 0x3fffffff;
+	if (angle & 0x40000000)
+		u = 0x40000000 - u;
+
+	i = u >> 22;
+	if (i == 256)
+		v = sine_table[256];
+	else
+	{
+		f = (u >> 6) & 0xffff;
+		v = sine_table[i] +
+			(((sine_table[i + 1] - sine_table[i]) * f) >> 16);
+	}
+
+	return (angle & 0x80000000) ? -v : v;
+}
+
+/*---------------------------------------------------------------------+
+ | int odometry_cos(u32 angle)                                         |
+ +--------------------------------------------------------------------*/
+int odometry_cos(u32 angle)
+{
+	return odometry_sin(angle + 0x40000000);
+}
+
+/*---------------------------------------------------------------------+
+ | int print_pose(struct andi_odometry *odometry, char *buffer)        |
+ +--------------------------------------------------------------------*/
+int print_pose(struct andi_odometry *odometry, char *buffer)
+{
+	unsigned int tenths;
+	int len;
+
+	LG(TRACE, "int print_pose(struct andi_odometry *odometry, char *buffer) ");
+
+	len = sprintf(buffer, "Dead reckoning\n");
+	len += sprintf(buffer + len, "\tx          : %d um\n", odometry->pose.x);
+	len += sprintf(buffer + len, "\ty          : %d um\n", odometry->pose.y);
+	tenths = ((u64) odometry->pose.heading * 3600) >> 32;
+	len += sprintf(buffer + len, "\theading    : %u.%u degrees\n",
+				   tenths / 10, tenths % 10);
+	len += sprintf(buffer + len, "\ttime       : %u.%06u\n",
+				   odometry->pose.tv_sec, odometry->pose.tv_usec);
+	len += sprintf(buffer + len, "\twheel base : %u um\n",
+				   odometry->config.wheel_base);
+	len += sprintf(buffer + len, "\tcounts/m   : %d, %d\n",
+				   odometry->config.counts_per_metre[0],
+				   odometry->config.counts_per_metre[1]);
+
+	LG(TRACE, "%i characters stored in buffer\n", len);
+
+	return len;
+}
@@ -0,0 +1,498 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver Capture Replay                     |
+ |                                                                                |
+ |   Copyright (c) 1999, Mark Dennehy                                             |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+/*
+ * replay [-t percent] capture
+ *
+ * Runs a capture taken from /proc/andi_servo/capture through the chip
+ * functions of this tree, against the LM629 emulator, and sets the port
+ * accesses and time of each kind of operation beside those captured.
+ * The captured figures are those of the driver that made the capture,
+ * so a capture from a known good driver shows what a change did to the
+ * bus traffic. With -t, exits 1 if any kind of operation takes more
+ * than percent more port accesses than it did in the capture.
+ *
+ * The arguments of each operation (filter gains, trajectories, masks)
+ * are taken from the bytes it wrote. A captured operation is given the
+ * accesses to its own LM629's ports up to the next operation, and for
+ * hard_reset those to the board registers as well; anything the
+ * interrupt handler did in between on the same ports is counted in.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <andi_servo.h>
+
+#define BASE_ADDRESS 0x300
+
+struct replay_op
+{
+	int op;
+	int channel;				/* TP_BOARD for update_filters          */
+	int command;				/* First command byte written           */
+	int bytes;
+	unsigned char data[32];		/* Data port bytes written              */
+	unsigned long reads;
+	unsigned long writes;
+	unsigned long long start;	/* Capture time, ns                     */
+	unsigned long long end;
+};
+
+struct replay_stats
+{
+	unsigned long count;
+	unsigned long errors;
+	unsigned long reads;
+	unsigned long writes;
+	unsigned long long ns;
+};
+
+static struct replay_stats captured[LM629_OPS];
+static struct replay_stats replayed[LM629_OPS];
+
+static struct andi_servo board;
+static struct LM629 channel0, channel1;
+static struct LM629_Filter filters[2];
+static struct LM629_Trajectory trajectories[2];
+
+/*---------------------------------------------------------------------+
+ |    static __u32 data_word(struct replay_op *op, int n)              |
+ +--------------------------------------------------------------------*/
+static __u32 data_word(struct replay_op *op, int n)
+{
+	if (2 * n + 1 >= op->bytes)
+		return 0;
+
+	return (op->data[2 * n] << 8) | op->data[2 * n + 1];
+}
+
+/*---------------------------------------------------------------------+
+ |    static void decode_filter(struct replay_op *op,                  |
+ |                              struct LM629_Filter *filter)           |
+ |                                                                     |
+ |    Back from the LFIL data to the filter load_filter() was given.   |
+ +--------------------------------------------------------------------*/
+static void decode_filter(struct replay_op *op, struct LM629_Filter *filter)
+{
+	int control, n;
+
+	memset(filter, 0, sizeof (struct LM629_Filter));
+
+	filter->dterm = op->data[0] + 1;
+	control = op->data[1];
+	n = 1;
+	if (control & LOAD_Kp)
+		filter->kp = data_word(op, n++);
+	if (control & LOAD_Ki)
+		filter->ki = data_word(op, n++);
+	if (control & LOAD_Kd)
+		filter->kd = data_word(op, n++);
+	if (control & LOAD_Il)
+		filter->il = data_word(op, n++);
+}
+
+/*---------------------------------------------------------------------+
+ |    static void decode_trajectory(struct replay_op *op,              |
+ |                                  struct LM629_Trajectory *t)        |
+ +--------------------------------------------------------------------*/
+static void decode_trajectory(struct replay_op *op, struct LM629_Trajectory *t)
+{
+	int control, n;
+
+	memset(t, 0, sizeof (struct LM629_Trajectory));
+
+	control = data_word(op, 0);
+	t->forward_dir = (control & FORWARD_DIRECTION) != 0;
+	t->velocity_mode = (control & VELOCITY_MODE) != 0;
+	t->stop_smooth = (control & SMOOTH_STOP) != 0;
+	t->stop_abrupt = (control & ABRUPT_STOP) != 0;
+	t->motor_off = (control & TURN_MOTOR_OFF) != 0;
+	t->load_acc = (control & LOAD_ACCELERATION) != 0;
+	t->load_vel = (control & LOAD_VELOCITY) != 0;
+	t->load_pos = (control & LOAD_POSITION) != 0;
+	t->acc_relative = (control & ACCELERATION_RELATIVE) != 0;
+	t->vel_relative = (control & VELOCITY_RELATIVE) != 0;
+	t->pos_relative = (control & POSITION_RELATIVE) != 0;
+
+	n = 1;
+	if (t->load_acc)
+	{
+		t->acc = (long) (__s32) ((data_word(op, n) << 16) | data_word(op, n + 1));
+		n += 2;
+	}
+	if (t->load_vel)
+	{
+		t->velocity =
+			(long) (__s32) ((data_word(op, n) << 16) | data_word(op, n + 1));
+		n += 2;
+	}
+	if (t->load_pos)
+	{
+		t->position =
+			(long) (__s32) ((data_word(op, n) << 16) | data_word(op, n + 1));
+		n += 2;
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |    static int replay_call(struct replay_op *op)                     |
+ |                                                                     |
+ |    Does the captured operation again with the chip functions.       |
+ +--------------------------------------------------------------------*/
+static int replay_call(struct replay_op *op)
+{
+	int channel, value;
+	long position;
+
+	channel = op->channel & 1;
+
+	switch (op->op)
+	{
+	case LM629_OP_SOFT_RESET:
+		return soft_reset(&board, channel);
+
+	case LM629_OP_DEFINE_HOME:
+		return define_home(&board, channel);
+
+	case LM629_OP_SET_POSITION_ERROR:
+		return set_position_error_threshold(&board, channel,
+											data_word(op, 0) & 0x7fff,
+											op->command == LPES);
+
+	case LM629_OP_LOAD_FILTER:
+		decode_filter(op, &filters[channel]);
+		userspace_channel(&board, channel)->NewFilter = &filters[channel];
+		return load_filter(&board, channel);
+
+	case LM629_OP_UPDATE_FILTER:
+		userspace_channel(&board, channel)->NewFilter = &filters[channel];
+		return update_filter(&board, channel);
+
+	case LM629_OP_UPDATE_FILTERS:
+		channel0.NewFilter = &filters[0];
+		channel1.NewFilter = &filters[1];
+		channel0.filter_pending = TRUE;
+		channel1.filter_pending = TRUE;
+		return update_filters(&board);
+
+	case LM629_OP_LOAD_TRAJECTORY:
+		decode_trajectory(op, &trajectories[channel]);
+		userspace_channel(&board, channel)->NewTrajectory =
+			&trajectories[channel];
+		return load_trajectory(&board, channel);
+
+	case LM629_OP_START_TRAJECTORY:
+		userspace_channel(&board, channel)->NewTrajectory =
+			&trajectories[channel];
+		return start_trajectory(&board, channel);
+
+	case LM629_OP_GET_STATUS:
+		return get_status(&board, channel, &value);
+
+	case LM629_OP_GET_SIGNALS:
+		return get_signals(&board, channel, &value);
+
+	case LM629_OP_GET_INDEX_POSITION:
+		return get_index_position(&board, channel, &position);
+
+	case LM629_OP_SET_INDEX_POSITION:
+		return set_index_position(&board, channel);
+
+	case LM629_OP_GET_DESIRED_POSITION:
+		return get_desired_position(&board, channel, &position);
+
+	case LM629_OP_GET_REAL_POSITION:
+		return get_real_position(&board, channel, &position);
+
+	case LM629_OP_GET_DESIRED_VELOCITY:
+		return get_desired_velocity(&board, channel, &position);
+
+	case LM629_OP_GET_REAL_VELOCITY:
+		return get_real_velocity(&board, channel, &position);
+
+	case LM629_OP_SET_IRQ_MASK:
+		value = op->data[1];
+		return set_irq_mask(&board, channel, &value);
+
+	case LM629_OP_RESET_INTERRUPTS:
+		return reset_interrupts(&board, channel, ~op->data[1] & 0xff);
+
+	case LM629_OP_HARD_RESET:
+		return hard_reset(&board, channel);
+	}
+
+	return -EINVAL;
+}
+
+/*---------------------------------------------------------------------+
+ |    static void replay(struct replay_op *op)                         |
+ |                                                                     |
+ |    Adds a captured operation to the captured stats, replays it and  |
+ |    adds the replay to the replayed stats.                           |
+ +--------------------------------------------------------------------*/
+static void replay(struct replay_op *op)
+{
+	struct ANDI_Bus before, after;
+	struct replay_stats *stats;
+	cycles_t start;
+	int channel, retval;
+
+	if (op->op < 0 || op->op >= LM629_OPS)
+		return;
+
+	stats = &captured[op->op];
+	stats->count++;
+	stats->reads += op->reads;
+	stats->writes += op->writes;
+	stats->ns += op->end - op->start;
+
+	get_bus_counts(&before);
+	start = get_cycles();
+
+	retval = replay_call(op);
+
+	stats = &replayed[op->op];
+	stats->ns += get_cycles() - start;
+	get_bus_counts(&after);
+
+	stats->count++;
+	if (retval < 0)
+		stats->errors++;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		stats->reads += after.channel[channel].port_reads -
+			before.channel[channel].port_reads;
+		stats->writes += after.channel[channel].port_writes -
+			before.channel[channel].port_writes;
+	}
+	stats->reads += after.board_reads - before.board_reads;
+	stats->writes += after.board_writes - before.board_writes;
+}
+
+/*---------------------------------------------------------------------+
+ | static BOOLEAN belongs(struct replay_op *op, int port)              |
+ |                                                                     |
+ | Whether an access to port is counted as part of the operation.      |
+ +--------------------------------------------------------------------*/
+static BOOLEAN belongs(struct replay_op *op, int port)
+{
+	if (op->op == LM629_OP_HARD_RESET)
+		return TRUE;
+
+	if (op->channel == TP_BOARD)
+		return port <= DATA_1;
+
+	if (op->channel)
+		return port == COMMAND_1 || port == DATA_1;
+
+	return port == COMMAND_0 || port == DATA_0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static double per_op(unsigned long long total,                   |
+ |                         unsigned long count)                        |
+ +--------------------------------------------------------------------*/
+static double per_op(unsigned long long total, unsigned long count)
+{
+	return count ? (double) total / count : 0.0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int report(double threshold)                              |
+ |                                                                     |
+ |    Prints the two sets of stats, and returns 1 if the accesses of   |
+ |    any operation grew by more than threshold percent.               |
+ +--------------------------------------------------------------------*/
+static int report(double threshold)
+{
+	double before, after, delta;
+	int op, regressed;
+
+	regressed = 0;
+
+	printf("%-20s %7s | %27s | %27s | %7s\n", "", "",
+		   "captured", "replayed", "");
+	printf("%-20s %7s | %8s %8s %9s | %8s %8s %9s | %7s\n",
+		   "operation", "count", "reads", "writes", "us", "reads", "writes",
+		   "us", "delta");
+
+	for (op = 0; op < LM629_OPS; op++)
+	{
+		if (!captured[op].count)
+			continue;
+
+		before = per_op(captured[op].reads + captured[op].writes,
+						captured[op].count);
+		after = per_op(replayed[op].reads + replayed[op].writes,
+					   replayed[op].count);
+		delta = before ? 100.0 * (after - before) / before : 0.0;
+
+		printf("%-20s %7lu | %8.1f %8.1f %9.1f | %8.1f %8.1f %9.1f | %+6.1f%%",
+			   op_name(op), captured[op].count,
+			   per_op(captured[op].reads, captured[op].count),
+			   per_op(captured[op].writes, captured[op].count),
+			   per_op(captured[op].ns, captured[op].count) / 1000,
+			   per_op(replayed[op].reads, replayed[op].count),
+			   per_op(replayed[op].writes, replayed[op].count),
+			   per_op(replayed[op].ns, replayed[op].count) / 1000, delta);
+
+		if (replayed[op].errors)
+			printf("  %lu failed", replayed[op].errors);
+
+		if (threshold >= 0 && delta > threshold)
+		{
+			printf("  REGRESSED");
+			regressed = 1;
+		}
+
+		printf("\n");
+	}
+
+	printf("\nemulator: %lu commands, %lu protocol violations\n",
+		   userspace_emu.commands, userspace_emu.violations);
+
+	return regressed;
+}
+
+/*---------------------------------------------------------------------+
+ |    int main(int argc, char **argv)                                  |
+ +--------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+	struct ANDI_Capture record;
+	struct replay_op op;
+	unsigned long long now, khz;
+	unsigned long lost;
+	double threshold;
+	FILE *capture;
+	int c;
+
+	threshold = -1;
+
+	while ((c = getopt(argc, argv, "t:")) != -1)
+	{
+		switch (c)
+		{
+		case 't':
+			threshold = atof(optarg);
+			break;
+
+		default:
+			fprintf(stderr, "usage: %s [-t percent] capture\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (optind != argc - 1)
+	{
+		fprintf(stderr, "usage: %s [-t percent] capture\n", argv[0]);
+		return 2;
+	}
+
+	capture = fopen(argv[optind], "rb");
+	if (!capture)
+	{
+		perror(argv[optind]);
+		return 2;
+	}
+
+	userspace_open(USERSPACE_EMULATOR, BASE_ADDRESS);
+	userspace_board(&board, &channel0, &channel1);
+
+	memset(&op, 0, sizeof (struct replay_op));
+	op.op = -1;
+	now = 0;
+	khz = 0;
+	lost = 0;
+
+	while (fread(&record, sizeof (struct ANDI_Capture), 1, capture) == 1)
+	{
+		switch (record.type)
+		{
+		case ANDI_CAPTURE_START:
+			khz = record.cycles;
+			now = 0;
+			op.op = -1;
+			continue;
+
+		case ANDI_CAPTURE_LOST:
+			/* The operation under way lost its end, or its start */
+			lost += record.cycles;
+			op.op = -1;
+			continue;
+		}
+
+		if (khz)
+			now += (unsigned long long) record.cycles * 1000000 / khz;
+
+		switch (record.type)
+		{
+		case ANDI_CAPTURE_OP:
+			replay(&op);
+			memset(&op, 0, sizeof (struct replay_op));
+			op.op = record.value;
+			op.channel = record.port;
+			op.command = -1;
+			op.start = now;
+			op.end = now;
+			break;
+
+		case ANDI_CAPTURE_IN:
+		case ANDI_CAPTURE_OUT:
+			if (op.op < 0 || !belongs(&op, record.port))
+				break;
+
+			op.end = now;
+
+			if (record.type == ANDI_CAPTURE_IN)
+			{
+				op.reads++;
+				break;
+			}
+
+			op.writes++;
+			if (record.port == COMMAND_0 || record.port == COMMAND_1)
+			{
+				if (op.command < 0)
+					op.command = record.value;
+			}
+			else if ((record.port == DATA_0 || record.port == DATA_1)
+					 && op.bytes < sizeof (op.data))
+				op.data[op.bytes++] = record.value;
+			break;
+		}
+	}
+	replay(&op);
+
+	fclose(capture);
+	userspace_close();
+
+	if (!khz)
+		printf("No start record, captured times are not known\n");
+	if (lost)
+		printf("%lu records were lost from the capture\n", lost);
+
+	return report(threshold);
+}
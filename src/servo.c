@@ -111,15 +111,51 @@ static struct LM629_Trajectory new_trajectory1 = {
 	position:0L
 };
 
+/*
+ * Filter and trajectory tables. Each channel has two banks of each so
+ * that a new table can be written while the LM629 is still running an
+ * entry from the old one.
+ */
+static struct LM629_Filter filter_bank0[2][SERVO_MAX_RECORDS];
+static struct LM629_Filter filter_bank1[2][SERVO_MAX_RECORDS];
+static struct LM629_Trajectory trajectory_bank0[2][SERVO_MAX_RECORDS];
+static struct LM629_Trajectory trajectory_bank1[2][SERVO_MAX_RECORDS];
+
+/* Event rings, read through the channel files */
+static struct LM629_Event events0[SERVO_EVENTS];
+static struct LM629_Event events1[SERVO_EVENTS];
+
+/*
+ * Staging areas for packed records, which have to be unpacked into a
+ * bank. Native records are copied straight into the bank. One for each
+ * channel, as a write holds only its own channel's bus lock.
+ */
+static char write_buffer[2][SERVO_WRITE_BUFFER_SIZE];
+
 static struct LM629 channel0 = {
 	Filter:&filter0,
 	NewFilter:&new_filter0,
 	Trajectory:&trajectory0,
 	NewTrajectory:&new_trajectory0,
+	FilterBank:{filter_bank0[0], filter_bank0[1]},
+	TrajectoryBank:{trajectory_bank0[0], trajectory_bank0[1]},
+	FilterTable:filter_bank0[0],
+	TrajectoryTable:trajectory_bank0[0],
+	filter_count:0,
+	trajectory_count:0,
+	trajectory_next:0,
+	filter_seq:0,
+	trajectory_seq:0,
 	filter_updated:FALSE,
+	filter_pending:FALSE,
+	filter_scheduled:FALSE,
 	trajectory_started:FALSE,
+	trajectory_complete:TRUE,
 	pwm_brake:FALSE,
-	position_error:0
+	position_error:0,
+	GainStatus:{active:-1},
+	Events:events0,
+	event_head:0
 };
 
 static struct LM629 channel1 = {
@@ -127,10 +163,25 @@ static struct LM629 channel1 = {
 	NewFilter:&new_filter1,
 	Trajectory:&trajectory1,
 	NewTrajectory:&new_trajectory1,
+	FilterBank:{filter_bank1[0], filter_bank1[1]},
+	TrajectoryBank:{trajectory_bank1[0], trajectory_bank1[1]},
+	FilterTable:filter_bank1[0],
+	TrajectoryTable:trajectory_bank1[0],
+	filter_count:0,
+	trajectory_count:0,
+	trajectory_next:0,
+	filter_seq:0,
+	trajectory_seq:0,
 	filter_updated:FALSE,
+	filter_pending:FALSE,
+	filter_scheduled:FALSE,
 	trajectory_started:FALSE,
+	trajectory_complete:TRUE,
 	pwm_brake:FALSE,
-	position_error:0
+	position_error:0,
+	GainStatus:{active:-1},
+	Events:events1,
+	event_head:0
 };
 
 static struct andi_servo servo = {
@@ -139,6 +190,96 @@ static struct andi_servo servo = {
 	FaultLED:FALSE
 };
 
+/*
+ * The sampler reads both encoders every sample_ticks jiffies and runs
+ * the gain schedules. 0 turns it off.
+ */
+static int sample_ticks = 1;
+MODULE_PARM(sample_ticks, "i");
+MODULE_PARM_DESC(sample_ticks, "Encoder sample period in jiffies, 0 = off");
+
+static struct timer_list sample_timer;
+
+/*
+ * With an IRQ the LM629 interrupts (encoder wrap-around so far) are
+ * handled as they happen rather than at the next sample. 0 = polled.
+ * The handler only notes which chip interrupted; the LM629 commands
+ * are issued from servo_irq_task, in process context under the bus
+ * locks.
+ */
+static int irq = 0;
+MODULE_PARM(irq, "i");
+MODULE_PARM_DESC(irq, "ANDI-SERVO IRQ line, 0 = polled");
+
+static unsigned long servo_irq_pending;
+static unsigned long servo_irq_stamped;
+static struct timeval servo_irq_stamp[2];	/* First interrupt not yet handled */
+
+/* Woken whenever the sampler or the IRQ task sees an LM629 event */
+static DECLARE_WAIT_QUEUE_HEAD(servo_wait);
+
+/*
+ * Position error fault. Set, and the brakes applied, by whichever of
+ * the interrupt handler or servo_handle_status sees it first.
+ */
+static struct ANDI_Fault fault;
+static cycles_t fault_seen;
+static BOOLEAN fault_stopped;
+
+/*
+ * Protects the fault and thermal state and the brakes forced on by
+ * them, which the interrupt handler changes.
+ */
+static spinlock_t brake_lock = SPIN_LOCK_UNLOCKED;
+
+/*
+ * Protects the event rings. They are filled by the sampler and the IRQ
+ * task, and read by read() without the bus locks.
+ */
+static spinlock_t event_lock = SPIN_LOCK_UNLOCKED;
+
+/* Every open file, for waking just the clients that want an event */
+static LIST_HEAD(servo_clients);
+static spinlock_t client_lock = SPIN_LOCK_UNLOCKED;
+
+/* Processes that asked for SIGIO with fcntl(F_SETFL, O_ASYNC) */
+static struct fasync_struct *servo_async_queue;
+
+static struct LM629_Trajectory home_trajectory[2];
+static struct LM629_Trajectory stop_trajectory[2] = {
+	{stop_abrupt:TRUE},
+	{stop_abrupt:TRUE}
+};
+static struct LM629_Trajectory off_trajectory[2] = {
+	{motor_off:TRUE},
+	{motor_off:TRUE}
+};
+
+static struct tq_struct servo_irq_task = {
+	routine:servo_irq_bh
+};
+
+/*
+ * Dead reckoning from the sampled encoders. Stays put until
+ * SERVO_SET_ODOMETRY gives it the wheel geometry.
+ */
+static struct andi_odometry odometry;
+
+/*
+ * Dead reckoning is fed by the sampler and set by the board ioctls; it
+ * has a lock of its own so that reading the pose never waits for the
+ * LM629s.
+ */
+static spinlock_t odometry_lock = SPIN_LOCK_UNLOCKED;
+
+/*
+ * Bus locks, one per LM629. A user-space call takes the locks of the
+ * channels its minor addresses, both for the board, and always channel
+ * 0 first. The sampler never waits for one; it just skips the sample.
+ */
+static struct semaphore servo_bus[2];
+static struct servo_lock_stats servo_lock_stats[2];
+
 /*---------------------------------------------------------------------+
  |    /proc/andi-servo file data structures                            |
  +--------------------------------------------------------------------*/
@@ -222,6 +363,80 @@ struct proc_dir_entry servo_filter1_proc_file = {
 	read_proc:procfile_filter1_read
 };
 
+struct proc_dir_entry servo_pose_proc_file = {
+	namelen:4,
+	name:"pose",
+	mode:S_IFREG | S_IRUGO,
+	uid:0,
+	gid:0,
+	nlink:1,
+	read_proc:procfile_pose_read
+};
+
+struct proc_dir_entry servo_locks_proc_file = {
+	namelen:5,
+	name:"locks",
+	mode:S_IFREG | S_IRUGO,
+	uid:0,
+	gid:0,
+	nlink:1,
+	read_proc:procfile_locks_read
+};
+
+struct proc_dir_entry servo_latency0_proc_file = {
+	namelen:8,
+	name:"latency0",
+	mode:S_IFREG | S_IRUGO | S_IWUSR,
+	uid:0,
+	gid:0,
+	nlink:1,
+	read_proc:procfile_latency0_read,
+	write_proc:procfile_latency0_write
+};
+
+struct proc_dir_entry servo_latency1_proc_file = {
+	namelen:8,
+	name:"latency1",
+	mode:S_IFREG | S_IRUGO | S_IWUSR,
+	uid:0,
+	gid:0,
+	nlink:1,
+	read_proc:procfile_latency1_read,
+	write_proc:procfile_latency1_write
+};
+
+struct proc_dir_entry servo_bus_proc_file = {
+	namelen:3,
+	name:"bus",
+	mode:S_IFREG | S_IRUGO,
+	uid:0,
+	gid:0,
+	nlink:1,
+	read_proc:procfile_bus_read
+};
+
+struct proc_dir_entry servo_trace_proc_file = {
+	namelen:5,
+	name:"trace",
+	mode:S_IFREG | S_IRUGO | S_IWUSR,
+	uid:0,
+	gid:0,
+	nlink:1,
+	read_proc:procfile_trace_read,
+	write_proc:procfile_trace_write
+};
+
+struct proc_dir_entry servo_capture_proc_file = {
+	namelen:7,
+	name:"capture",
+	mode:S_IFREG | S_IRUSR | S_IWUSR,
+	uid:0,
+	gid:0,
+	nlink:1,
+	read_proc:procfile_capture_read,
+	write_proc:procfile_capture_write
+};
+
 /*---------------------------------------------------------------------+
  |    file operations structure                                        |
  +--------------------------------------------------------------------*/
@@ -229,9 +444,12 @@ struct proc_dir_entry servo_filter1_proc_file = {
 struct file_operations servo_fops = {
 	read:servo_read,
 	write:servo_write,
+	writev:servo_writev,
 	ioctl:servo_ioctl,
 	open:servo_open,
-	release:servo_close
+	release:servo_close,
+	fasync:servo_fasync,
+	poll:servo_poll
 };
 
 /*---------------------------------------------------------------------+
@@ -241,22 +459,156 @@ struct file_operations servo_fops = {
 int servo_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num,
 				unsigned long ioctl_param)
 {
+	int channels, retval;
+
 	LG(TRACE,
 	   "int servo_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num, unsigned long ioctl_param)\n");
 
+	/* Homing sleeps, so it takes the bus locks only while it talks to the LM629s */
+	if (MINOR(inode->i_rdev) == BOARD && ioctl_num == SERVO_HOME)
+		return servo_home((struct ANDI_Home *) ioctl_param);
+
+	/* And so does waiting for a trajectory */
+	if (ioctl_num == SERVO_WAIT_TRAJECTORY)
+		switch (MINOR(inode->i_rdev))
+		{
+		case BOARD:
+			return servo_wait_trajectory(0, (struct ANDI_Wait *) ioctl_param);
+		case TRAJECTORY_0:
+			return servo_wait_trajectory(1, (struct ANDI_Wait *) ioctl_param);
+		case TRAJECTORY_1:
+			return servo_wait_trajectory(2, (struct ANDI_Wait *) ioctl_param);
+		}
+
+	/* The traffic counts are per CPU and need no bus lock */
+	if (ioctl_num == SERVO_GET_BUS_COUNTS)
+	{
+		struct ANDI_Bus counts;
+
+		get_bus_counts(&counts);
+		if (copy_to_user((void *) ioctl_param, &counts, sizeof (counts)))
+			return -EFAULT;
+		return 0;
+	}
+
+	channels = servo_ioctl_channels(MINOR(inode->i_rdev), ioctl_num);
+
+	retval = servo_lock(channels);
+	if (retval < 0)
+		return retval;
+
+	retval = servo_do_ioctl(inode, file, ioctl_num, ioctl_param);
+
+	servo_unlock(channels);
+
+	return retval;
+}
+
+static int servo_do_ioctl(struct inode *inode, struct file *file,
+						  unsigned int ioctl_num, unsigned long ioctl_param)
+{
+	LG(TRACE,
+	   "static int servo_do_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num, unsigned long ioctl_param)\n");
+
 	switch (MINOR(inode->i_rdev))
 	{
 	case BOARD:
 		switch (ioctl_num)
 		{
+		case SERVO_UPDATE_FILTERS:
+			return update_filters(&servo);
+
+		case SERVO_GET_FAULT:
+			return servo_get_fault((struct ANDI_Fault *) ioctl_param);
+
+		case SERVO_CLEAR_FAULT:
+			return servo_clear_fault();
+
+		case SERVO_GET_POSE:
+			{
+				struct ANDI_Pose pose;
+
+				spin_lock_bh(&odometry_lock);
+				pose = odometry.pose;
+				spin_unlock_bh(&odometry_lock);
+
+				if (copy_to_user((void *) ioctl_param, &pose, sizeof (pose)))
+					return -EFAULT;
+				return 0;
+			}
+
+		case SERVO_SET_POSE:
+			{
+				struct ANDI_Pose pose;
+
+				if (copy_from_user(&pose, (void *) ioctl_param, sizeof (pose)))
+					return -EFAULT;
+
+				spin_lock_bh(&odometry_lock);
+				odometry_set_pose(&odometry, &pose);
+				spin_unlock_bh(&odometry_lock);
+				return 0;
+			}
+
+		case SERVO_SET_ODOMETRY:
+			{
+				struct ANDI_Odometry config;
+				int retval;
+
+				if (copy_from_user(&config, (void *) ioctl_param,
+								   sizeof (config)))
+					return -EFAULT;
+
+				spin_lock_bh(&odometry_lock);
+				retval = odometry_configure(&odometry, &config);
+				spin_unlock_bh(&odometry_lock);
+				return retval;
+			}
+
+		case SERVO_GET_ODOMETRY:
+			{
+				struct ANDI_Odometry config;
+
+				spin_lock_bh(&odometry_lock);
+				config = odometry.config;
+				spin_unlock_bh(&odometry_lock);
+
+				if (copy_to_user((void *) ioctl_param, &config,
+								 sizeof (config)))
+					return -EFAULT;
+				return 0;
+			}
+
 		case SERVO_HARD_RESET:
+			return servo_hard_reset();
+
 		case SERVO_SET_BRAKES:
+			return servo_set_board(servo_set_brakes, (int) ioctl_param);
+
 		case SERVO_SET_LED:
+			return servo_set_board(servo_set_led, (int) ioctl_param);
+
 		case SERVO_SET_IRQ_ENABLE:
+			if (ioctl_param && irq <= 0)
+				return -EINVAL;
+			return servo_set_board(servo_set_irq_enable, (int) ioctl_param);
+
 		case SERVO_GET_BRAKES:
+			return put_user(servo_brake_image(), (int *) ioctl_param);
+
 		case SERVO_GET_LED:
+			return put_user((servo.control & LED_MASK) != 0,
+							(int *) ioctl_param);
+
 		case SERVO_GET_IRQ_ENABLE:
+			return put_user((servo.control & IRQ_MASK) != 0,
+							(int *) ioctl_param);
+
 		case SERVO_GET_IRQ_CAUSE:
+			BUS_BOARD.board_reads++;
+			return put_user(bus_inb(servo.base_address + IRQCAUSE),
+							(int *) ioctl_param);
+
 		default:
 			L("Unknown ioctl_number %u\n", ioctl_num);
 			return -ENOSYS;
@@ -267,24 +619,76 @@ int servo_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num,
 	case CHANNEL_1:
 		switch (ioctl_num)
 		{
+		case SERVO_GET_POSITION64:
+			return servo_get_position64(MINOR(inode->i_rdev) == CHANNEL_1,
+										(struct LM629_Position *)
+										ioctl_param);
+
+		case SERVO_SET_SUBSCRIPTION:
+			return servo_set_subscription(file->private_data,
+										  (struct ANDI_Subscription *)
+										  ioctl_param);
+
+		case SERVO_GET_SUBSCRIPTION:
+			return servo_get_subscription(file->private_data,
+										  (struct ANDI_Subscription *)
+										  ioctl_param);
+
+		case SERVO_SET_HOME_POSITION:
+			return servo_define_home(MINOR(inode->i_rdev) == CHANNEL_1, 0L);
+
+		case SERVO_GET_THERMAL:
+			return servo_get_thermal(MINOR(inode->i_rdev) == CHANNEL_1,
+									 (struct LM629_Thermal *) ioctl_param);
+
+		case SERVO_CLEAR_THERMAL:
+			return servo_clear_thermal(MINOR(inode->i_rdev) == CHANNEL_1);
+
+		case SERVO_SET_BRAKE:
+			return servo_set_board(MINOR(inode->i_rdev) == CHANNEL_1 ?
+								   servo_set_brake1 : servo_set_brake0,
+								   (int) ioctl_param);
+
+		case SERVO_GET_BRAKE:
+			return put_user((servo_brake_image() >>
+							 (MINOR(inode->i_rdev) == CHANNEL_1)) & 1,
+							(int *) ioctl_param);
+
+		case SERVO_SET_POSITION_ERROR_THRESHOLD:
+			return set_position_error_threshold(&servo,
+												MINOR(inode->i_rdev) ==
+												CHANNEL_1,
+												(int) ioctl_param &
+												LM629_PERR_THRESHOLD,
+												((int) ioctl_param &
+												 LM629_PERR_STOP) != 0);
+
+		case SERVO_GET_POSITION_ERROR_THRESHOLD:
+			{
+				int threshold;
+
+				get_position_error_threshold(&servo,
+											 MINOR(inode->i_rdev) == CHANNEL_1,
+											 &threshold);
+				if ((MINOR(inode->i_rdev) == CHANNEL_1 ? servo.Channel1 :
+					 servo.Channel0)->stop_on_error)
+					threshold |= LM629_PERR_STOP;
+				return put_user(threshold, (int *) ioctl_param);
+			}
+
 		case SERVO_SOFT_RESET:
 		case SERVO_SMOOTH_STOP:
 		case SERVO_ABRUPT_STOP:
 		case SERVO_MOTOR_OFF:
-		case SERVO_SET_HOME_POSITION:
-		case SERVO_SET_BRAKE:
 		case SERVO_POSITION_MODE:
 		case SERVO_FEEDBACK_MODE:
 		case SERVO_SET_BREAKPOINT:
 		case SERVO_SET_ACCELERATION:
-		case SERVO_SET_POSITION_ERROR_THRESHOLD:
 		case SERVO_SET_IRQ_MASK:
 		case SERVO_GET_STATUS:
 		case SERVO_GET_SIGNALS:
-		case SERVO_GET_BRAKE:
 		case SERVO_GET_BREAKPOINT:
 		case SERVO_GET_ACCELERATION:
-		case SERVO_GET_POSITION_ERROR_THRESHOLD:
 		case SERVO_GET_IRQ_MASK:
 		default:
 			L("Unknown ioctl_number %u\n", ioctl_num);
@@ -296,10 +700,39 @@ int servo_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num,
 		switch (ioctl_num)
 		{
 		case SERVO_UPDATE_FILTER:
-			return update_filter(&servo, 1);
+			return update_filter(&servo, 0);
 		case SERVO_CHECK_FILTER_UPDATED:
 			*(int *) ioctl_param = servo.Channel0->filter_updated;
 			return 0;
+		case SERVO_CHECK_FILTER_PENDING:
+			*(int *) ioctl_param = servo.Channel0->filter_pending;
+			return 0;
+		case SERVO_SET_GAIN_SCHEDULE:
+			return servo_set_gain_schedule(0,
+										   (struct LM629_Gain_Schedule *)
+										   ioctl_param);
+		case SERVO_GET_GAIN_SCHEDULE:
+			if (copy_to_user((void *) ioctl_param,
+							 &servo.Channel0->GainSchedule,
+							 sizeof (struct LM629_Gain_Schedule)))
+				return -EFAULT;
+			return 0;
+		case SERVO_GET_GAIN_STATUS:
+			if (copy_to_user((void *) ioctl_param,
+							 &servo.Channel0->GainStatus,
+							 sizeof (struct LM629_Gain_Status)))
+				return -EFAULT;
+			return 0;
+		case SERVO_LOAD_FILTER:
+			return servo_load_filter_entry(0, (int) ioctl_param);
+		case SERVO_LOAD_FILTER_PACKED:
+			return servo_load_filter_packed(0,
+											(struct LM629_Filter_packed *)
+											ioctl_param);
+		case SERVO_GET_FILTER_PACKED:
+			return servo_get_filter_packed(0,
+										   (struct LM629_Filter_packed *)
+										   ioctl_param);
 
 		default:
 			L("Unknown ioctl_number %u\n", ioctl_num);
@@ -315,6 +748,35 @@ int servo_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num,
 		case SERVO_CHECK_FILTER_UPDATED:
 			*(int *) ioctl_param = servo.Channel1->filter_updated;
 			return 0;
+		case SERVO_CHECK_FILTER_PENDING:
+			*(int *) ioctl_param = servo.Channel1->filter_pending;
+			return 0;
+		case SERVO_SET_GAIN_SCHEDULE:
+			return servo_set_gain_schedule(1,
+										   (struct LM629_Gain_Schedule *)
+										   ioctl_param);
+		case SERVO_GET_GAIN_SCHEDULE:
+			if (copy_to_user((void *) ioctl_param,
+							 &servo.Channel1->GainSchedule,
+							 sizeof (struct LM629_Gain_Schedule)))
+				return -EFAULT;
+			return 0;
+		case SERVO_GET_GAIN_STATUS:
+			if (copy_to_user((void *) ioctl_param,
+							 &servo.Channel1->GainStatus,
+							 sizeof (struct LM629_Gain_Status)))
+				return -EFAULT;
+			return 0;
+		case SERVO_LOAD_FILTER:
+			return servo_load_filter_entry(1, (int) ioctl_param);
+		case SERVO_LOAD_FILTER_PACKED:
+			return servo_load_filter_packed(1,
+											(struct LM629_Filter_packed *)
+											ioctl_param);
+		case SERVO_GET_FILTER_PACKED:
+			return servo_get_filter_packed(1,
+										   (struct LM629_Filter_packed *)
+										   ioctl_param);
 
 		default:
 			L("Unknown ioctl_number %u\n", ioctl_num);
@@ -326,13 +788,23 @@ int servo_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num,
 		switch (ioctl_num)
 		{
 		case SERVO_START_TRAJECTORY:
-			return start_trajectory(&servo, 0);
+			return servo_start_trajectory(0);
+		case SERVO_LOAD_TRAJECTORY:
+			return servo_load_trajectory_entry(0, (int) ioctl_param);
 		case SERVO_CHECK_TRAJECTORY_STARTED:
 			*(int *) ioctl_param = servo.Channel0->trajectory_started;
 			return 0;
 		case SERVO_CHECK_TRAJECTORY_COMPLETE:
 			*(int *) ioctl_param = servo.Channel0->trajectory_complete;
 			return 0;
+		case SERVO_LOAD_TRAJECTORY_PACKED:
+			return servo_load_trajectory_packed(0,
+												(struct LM629_Trajectory_packed
+												 *) ioctl_param);
+		case SERVO_GET_TRAJECTORY_PACKED:
+			return servo_get_trajectory_packed(0,
+											   (struct LM629_Trajectory_packed
+												*) ioctl_param);
 
 		case SERVO_REGISTER_FOR_NOTIFICATION:
 		default:
@@ -345,13 +817,23 @@ int servo_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num,
 		switch (ioctl_num)
 		{
 		case SERVO_START_TRAJECTORY:
-			return start_trajectory(&servo, 1);
+			return servo_start_trajectory(1);
+		case SERVO_LOAD_TRAJECTORY:
+			return servo_load_trajectory_entry(1, (int) ioctl_param);
 		case SERVO_CHECK_TRAJECTORY_STARTED:
 			*(int *) ioctl_param = servo.Channel1->trajectory_started;
 			return 0;
 		case SERVO_CHECK_TRAJECTORY_COMPLETE:
 			*(int *) ioctl_param = servo.Channel1->trajectory_complete;
 			return 0;
+		case SERVO_LOAD_TRAJECTORY_PACKED:
+			return servo_load_trajectory_packed(1,
+												(struct LM629_Trajectory_packed
+												 *) ioctl_param);
+		case SERVO_GET_TRAJECTORY_PACKED:
+			return servo_get_trajectory_packed(1,
+											   (struct LM629_Trajectory_packed
+												*) ioctl_param);
 
 		case SERVO_REGISTER_FOR_NOTIFICATION:
 		default:
@@ -374,9 +856,43 @@ int servo_ioctl(struct inode *inode, struct file *file, unsigned int ioctl_num,
 
 static int servo_open(struct inode *inode, struct file *file)
 {
+	struct servo_client *client;
+
 	LG(TRACE,
 	   "static int servo_open(struct inode *inode, struct file *file)\n");
 
+	client = kmalloc(sizeof (struct servo_client), GFP_KERNEL);
+	if (!client)
+		return -ENOMEM;
+
+	switch (MINOR(inode->i_rdev))
+	{
+	case CHANNEL_0:
+		client->channel = 0;
+		break;
+
+	case CHANNEL_1:
+		client->channel = 1;
+		break;
+
+	default:
+		client->channel = -1;
+		break;
+	};
+
+	/* Everything still in the log, and no telemetry */
+	client->events = SERVO_EVENT_BITS;
+	client->decimation = 0;
+	client->cursor = 0;
+	client->sample_seen = 0;
+	init_waitqueue_head(&client->wait);
+
+	file->private_data = client;
+
+	spin_lock_bh(&client_lock);
+	list_add(&client->list, &servo_clients);
+	spin_unlock_bh(&client_lock);
+
 	MOD_INC_USE_COUNT;
 
 	return 0;
@@ -388,14 +904,57 @@ static int servo_open(struct inode *inode, struct file *file)
 
 static int servo_close(struct inode *inode, struct file *file)
 {
+	struct servo_client *client = file->private_data;
+
 	LG(TRACE,
 	   "static int servo_close(struct inode *inode, struct file *file)\n");
 
+	servo_fasync(-1, file, 0);
+
+	spin_lock_bh(&client_lock);
+	list_del(&client->list);
+	spin_unlock_bh(&client_lock);
+
+	kfree(client);
+
 	MOD_DEC_USE_COUNT;
 
 	return 0;
 }
 
+/*---------------------------------------------------------------------+
+ |    fasync() function                                                |
+ +--------------------------------------------------------------------*/
+
+static int servo_fasync(int fd, struct file *file, int on)
+{
+	LG(TRACE, "static int servo_fasync(int fd, struct file *file, int on)\n");
+
+	return fasync_helper(fd, file, on, &servo_async_queue);
+}
+
+/*---------------------------------------------------------------------+
+ |    poll() function                                                  |
+ +--------------------------------------------------------------------*/
+
+static unsigned int servo_poll(struct file *file, poll_table * wait)
+{
+	struct servo_client *client = file->private_data;
+
+	LG(TRACE,
+	   "static unsigned int servo_poll(struct file *file, poll_table * wait)\n");
+
+	if (client->channel < 0)
+		return POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM;
+
+	poll_wait(file, &client->wait, wait);
+
+	if (servo_client_ready(client))
+		return POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM;
+
+	return POLLOUT | POLLWRNORM;
+}
+
 /*---------------------------------------------------------------------+
  |    read() function                                                  |
  +--------------------------------------------------------------------*/
@@ -417,10 +976,10 @@ static ssize_t servo_read(struct file *file, char *buffer, size_t length,
 		return servo_read_board(buffer, length, offset);
 
 	case CHANNEL_0:
-		return servo_read_channel0(buffer, length, offset);
+		return servo_read_channel0(file, buffer, length, offset);
 
 	case CHANNEL_1:
-		return servo_read_channel1(buffer, length, offset);
+		return servo_read_channel1(file, buffer, length, offset);
 
 	case FILTER_0:
 		return servo_read_filter0(buffer, length, offset);
@@ -450,9 +1009,31 @@ static ssize_t servo_read(struct file *file, char *buffer, size_t length,
 static ssize_t servo_write(struct file *file, const char *buffer, size_t length,
 						   loff_t * offset)
 {
+	ssize_t retval;
+	int channels;
+
 	LG(TRACE,
 	   "static ssize_t servo_write(struct file *file, const char *buffer, size_t length, loff_t * offset)\n");
 
+	channels = servo_minor_channels(MINOR(file->f_dentry->d_inode->i_rdev));
+
+	retval = servo_lock(channels);
+	if (retval < 0)
+		return retval;
+
+	retval = servo_do_write(file, buffer, length, offset);
+
+	servo_unlock(channels);
+
+	return retval;
+}
+
+static ssize_t servo_do_write(struct file *file, const char *buffer,
+							  size_t length, loff_t * offset)
+{
+	LG(TRACE,
+	   "static ssize_t servo_do_write(struct file *file, const char *buffer, size_t length, loff_t * offset)\n");
+
 	switch (MINOR(file->f_dentry->d_inode->i_rdev))
 	{
 	case BOARD:
@@ -485,16 +1066,74 @@ static ssize_t servo_write(struct file *file, const char *buffer, size_t length,
 	return 0;
 }
 
+/*---------------------------------------------------------------------+
+ |    writev() function                                                |
+ |                                                                     |
+ |    The filter and trajectory minors gather all the segments into    |
+ |    one table, so records may straddle segment boundaries. The other |
+ |    minors just see one write() per segment.                         |
+ +--------------------------------------------------------------------*/
+
+static ssize_t servo_writev(struct file *file, const struct iovec *iov,
+							unsigned long count, loff_t * offset)
+{
+	size_t length;
+	unsigned long i;
+	int minor, retval;
+
+	LG(TRACE,
+	   "static ssize_t servo_writev(struct file *file, const struct iovec *iov, unsigned long count, loff_t * offset)\n");
+
+	minor = MINOR(file->f_dentry->d_inode->i_rdev);
+
+	switch (minor)
+	{
+	case FILTER_0:
+	case FILTER_1:
+	case TRAJECTORY_0:
+	case TRAJECTORY_1:
+		retval = servo_lock(servo_minor_channels(minor));
+		if (retval < 0)
+			return retval;
+
+		if (minor == FILTER_0 || minor == FILTER_1)
+			retval = servo_write_filter_table(minor == FILTER_1, iov, count);
+		else
+			retval =
+				servo_write_trajectory_table(minor == TRAJECTORY_1, iov, count);
+
+		servo_unlock(servo_minor_channels(minor));
+		return retval;
+
+	default:
+		break;
+	};
+
+	length = 0;
+	for (i = 0; i < count; i++)
+	{
+		retval = servo_write(file, iov[i].iov_base, iov[i].iov_len, offset);
+		if (retval < 0)
+			return length ? length : retval;
+		length += retval;
+	}
+
+	return length;
+}
+
 /*---------------------------------------------------------------------+
  |    int init_module(void)                                            |
  +--------------------------------------------------------------------*/
 
 int init_module(void)
 {
-	int retval;
+	int retval, channel, irq_mask;
 
 	LG(TRACE, "int init_module(void)\n");
 
+	for (channel = 0; channel < 2; channel++)
+		init_MUTEX(&servo_bus[channel]);
+
 /*
  * port ranges: the device can reside between
  * 0x280 and 0x3F0, in step of 0x10. It uses 8 ports.
@@ -531,6 +1170,13 @@ int init_module(void)
  * 			/trajectory1
  * 			/filter0
  * 			/filter1
+ * 			/pose
+ * 			/locks
+ * 			/latency0
+ * 			/latency1
+ * 			/bus
+ * 			/trace
+ * 			/capture
  * 			
  */
 
@@ -599,6 +1245,62 @@ int init_module(void)
 		goto proc_filter1_register_failure;	/* Yes, a goto. I know, I know ... */
 	}
 
+	retval = proc_register(&servo_proc_dir, &servo_pose_proc_file);
+	if (retval < 0)
+	{
+		L("Error in registering /proc/%s/pose file : %d\n", SERVO_NAME,
+		  retval);
+		goto proc_pose_register_failure;	/* Yes, a goto. I know, I know ... */
+	}
+
+	retval = proc_register(&servo_proc_dir, &servo_locks_proc_file);
+	if (retval < 0)
+	{
+		L("Error in registering /proc/%s/locks file : %d\n", SERVO_NAME,
+		  retval);
+		goto proc_locks_register_failure;	/* Yes, a goto. I know, I know ... */
+	}
+
+	retval = proc_register(&servo_proc_dir, &servo_latency0_proc_file);
+	if (retval < 0)
+	{
+		L("Error in registering /proc/%s/latency0 file : %d\n", SERVO_NAME,
+		  retval);
+		goto proc_latency0_register_failure;	/* Yes, a goto. I know, I know ... */
+	}
+
+	retval = proc_register(&servo_proc_dir, &servo_latency1_proc_file);
+	if (retval < 0)
+	{
+		L("Error in registering /proc/%s/latency1 file : %d\n", SERVO_NAME,
+		  retval);
+		goto proc_latency1_register_failure;	/* Yes, a goto. I know, I know ... */
+	}
+
+	retval = proc_register(&servo_proc_dir, &servo_bus_proc_file);
+	if (retval < 0)
+	{
+		L("Error in registering /proc/%s/bus file : %d\n", SERVO_NAME,
+		  retval);
+		goto proc_bus_register_failure;	/* Yes, a goto. I know, I know ... */
+	}
+
+	retval = proc_register(&servo_proc_dir, &servo_trace_proc_file);
+	if (retval < 0)
+	{
+		L("Error in registering /proc/%s/trace file : %d\n", SERVO_NAME,
+		  retval);
+		goto proc_trace_register_failure;	/* Yes, a goto. I know, I know ... */
+	}
+
+	retval = proc_register(&servo_proc_dir, &servo_capture_proc_file);
+	if (retval < 0)
+	{
+		L("Error in registering /proc/%s/capture file : %d\n", SERVO_NAME,
+		  retval);
+		goto proc_capture_register_failure;	/* Yes, a goto. I know, I know ... */
+	}
+
 /*
  * This is the actual device itself. It has several minor devices. 
  * These are the actual control nodes. In /dev there should be a
@@ -623,6 +1325,33 @@ int init_module(void)
 		goto chrdev_register_failure;	/* Yes, a goto. I know, I know ... */
 	}
 
+	if (irq > 0)
+	{
+		retval = request_irq(irq, servo_interrupt, 0, SERVO_NAME, &servo);
+		if (retval < 0)
+		{
+			L("Error in requesting IRQ %d : %d\n", irq, retval);
+			goto chrdev_register_failure;	/* Yes, a goto. I know, I know ... */
+		}
+
+		for (channel = 0; channel < 2; channel++)
+		{
+			irq_mask = I_ENA_WRAP | I_ENA_POSERR | I_ENA_DONE |
+				I_ENA_BP | I_ENA_CMDERR;
+			set_irq_mask(&servo, channel, &irq_mask);
+		}
+		set_board_irq(&servo, TRUE);
+	}
+
+	if (sample_ticks > 0)
+	{
+		init_timer(&sample_timer);
+		sample_timer.function = servo_sample;
+		sample_timer.data = 0;
+		sample_timer.expires = jiffies + sample_ticks;
+		add_timer(&sample_timer);
+	}
+
 	L("Success\n");
 	return 0;
 
@@ -633,6 +1362,20 @@ int init_module(void)
 
   chrdev_register_failure:
 	unregister_chrdev(SERVO_MAJOR, SERVO_NAME);
+  proc_capture_register_failure:
+	proc_unregister(&servo_proc_dir, servo_capture_proc_file.low_ino);
+  proc_trace_register_failure:
+	proc_unregister(&servo_proc_dir, servo_trace_proc_file.low_ino);
+  proc_bus_register_failure:
+	proc_unregister(&servo_proc_dir, servo_bus_proc_file.low_ino);
+  proc_latency1_register_failure:
+	proc_unregister(&servo_proc_dir, servo_latency1_proc_file.low_ino);
+  proc_latency0_register_failure:
+	proc_unregister(&servo_proc_dir, servo_latency0_proc_file.low_ino);
+  proc_locks_register_failure:
+	proc_unregister(&servo_proc_dir, servo_locks_proc_file.low_ino);
+  proc_pose_register_failure:
+	proc_unregister(&servo_proc_dir, servo_pose_proc_file.low_ino);
   proc_filter1_register_failure:
 	proc_unregister(&servo_proc_dir, servo_filter1_proc_file.low_ino);
   proc_filter0_register_failure:
@@ -665,6 +1408,16 @@ void cleanup_module(void)
 
 	LG(TRACE, "void cleanup_module(void)\n");
 
+	if (sample_ticks > 0)
+		del_timer_sync(&sample_timer);
+
+	if (irq > 0)
+	{
+		set_board_irq(&servo, FALSE);
+		free_irq(irq, &servo);
+		flush_scheduled_tasks();
+	}
+
 	release_region(servo.base_address, 8);
 
 	retval = proc_unregister(&servo_proc_dir, servo_board_proc_file.low_ino);
@@ -725,6 +1478,62 @@ void cleanup_module(void)
 		return;
 	}
 
+	retval = proc_unregister(&servo_proc_dir, servo_pose_proc_file.low_ino);
+	if (retval < 0)
+	{
+		L("Error in unregistering /proc/%s/pose file: %d\n", SERVO_NAME,
+		  retval);
+		return;
+	}
+
+	retval = proc_unregister(&servo_proc_dir, servo_locks_proc_file.low_ino);
+	if (retval < 0)
+	{
+		L("Error in unregistering /proc/%s/locks file: %d\n", SERVO_NAME,
+		  retval);
+		return;
+	}
+
+	retval = proc_unregister(&servo_proc_dir, servo_latency0_proc_file.low_ino);
+	if (retval < 0)
+	{
+		L("Error in unregistering /proc/%s/latency0 file: %d\n", SERVO_NAME,
+		  retval);
+		return;
+	}
+
+	retval = proc_unregister(&servo_proc_dir, servo_latency1_proc_file.low_ino);
+	if (retval < 0)
+	{
+		L("Error in unregistering /proc/%s/latency1 file: %d\n", SERVO_NAME,
+		  retval);
+		return;
+	}
+
+	retval = proc_unregister(&servo_proc_dir, servo_bus_proc_file.low_ino);
+	if (retval < 0)
+	{
+		L("Error in unregistering /proc/%s/bus file: %d\n", SERVO_NAME,
+		  retval);
+		return;
+	}
+
+	retval = proc_unregister(&servo_proc_dir, servo_trace_proc_file.low_ino);
+	if (retval < 0)
+	{
+		L("Error in unregistering /proc/%s/trace file: %d\n", SERVO_NAME,
+		  retval);
+		return;
+	}
+
+	retval = proc_unregister(&servo_proc_dir, servo_capture_proc_file.low_ino);
+	if (retval < 0)
+	{
+		L("Error in unregistering /proc/%s/capture file: %d\n", SERVO_NAME,
+		  retval);
+		return;
+	}
+
 	retval = proc_unregister(&proc_root, servo_proc_dir.low_ino);
 	if (retval < 0)
 	{
@@ -754,11 +1563,34 @@ void cleanup_module(void)
 int procfile_board_read(char *buffer, char **buffer_location, off_t offset,
 						int buffer_length, int *eof, void *data)
 {
+	int retval;
+
+	if (offset > 0)
+		return 0;
+
+	retval = servo_lock(3);
+	if (retval < 0)
+		return retval;
+
+	retval = servo_print_board(buffer);
+
+	servo_unlock(3);
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_print_board(char *buffer)                       |
+ +--------------------------------------------------------------------*/
+
+static int servo_print_board(char *buffer)
+{
+	struct ANDI_Fault copy;
+	unsigned long flags;
 	int len, retval, status0, status1, signals0, signals1, heading;
 	long encoder0, encoder1;
 
-	LG(TRACE,
-	   "int procfile_board_read(char *buffer, char **buffer_location, off_t offset, int buffer_length, int *eof, void *data)\n");
+	LG(TRACE, "static int servo_print_board(char *buffer)\n");
 
 	heading = 0;
 	len = 0;
@@ -770,9 +1602,6 @@ int procfile_board_read(char *buffer, char **buffer_location, off_t offset,
 	signals0 = 0;
 	encoder0 = 0L;
 
-	if (offset > 0)
-		return 0;
-
 	retval = get_status(&servo, 0, &status0);
 	if (retval < 0)
 	{
@@ -837,6 +1666,21 @@ int procfile_board_read(char *buffer, char **buffer_location, off_t offset,
 	len += sprintf(buffer + len, "Channel 1 Encoder Count : %08lx\n", encoder1);
 	len += sprintf(buffer + len, "\n");
 
+	/* The IRQ handler writes the record under brake_lock */
+	spin_lock_irqsave(&brake_lock, flags);
+	copy = fault;
+	spin_unlock_irqrestore(&brake_lock, flags);
+
+	len += sprintf(buffer + len, "Position Error Fault : %s\n",
+				   copy.active ? "Active" : "None");
+	len += sprintf(buffer + len, "\tChannels : %x\n", copy.channels);
+	len += sprintf(buffer + len, "\tCount    : %u\n", copy.count);
+	len += sprintf(buffer + len, "\tTime     : %u.%06u\n", copy.tv_sec,
+				   copy.tv_usec);
+	len += sprintf(buffer + len, "\tBrake    : %u ns\n", copy.brake_ns);
+	len += sprintf(buffer + len, "\tStop     : %u ns\n", copy.stop_ns);
+	len += sprintf(buffer + len, "\n");
+
 	return len;
 }
 
@@ -848,6 +1692,10 @@ int procfile_board_read(char *buffer, char **buffer_location, off_t offset,
 int procfile_channel0_read(char *buffer, char **buffer_location, off_t offset,
 						   int buffer_length, int *eof, void *data)
 {
+	struct LM629_Thermal thermal;
+	unsigned long flags;
+	__s64 position;
+	unsigned int wraps;
 	int len;
 
 	LG(TRACE,
@@ -856,8 +1704,21 @@ int procfile_channel0_read(char *buffer, char **buffer_location, off_t offset,
 	if (offset > 0)
 		return 0;
 
+	servo_copy_position(0, &position, &wraps);
+
+	spin_lock_irqsave(&brake_lock, flags);
+	thermal = servo.Channel0->Thermal;
+	spin_unlock_irqrestore(&brake_lock, flags);
+
 	len = sprintf(buffer,
 				  "Ajeco ANDI-SERVO Motion controller driver. $Revision: 2.59 $\n\n");
+	len += sprintf(buffer + len, "Channel 0 Position : %Ld\n",
+				   (long long) position);
+	len += sprintf(buffer + len, "Channel 0 Wraps    : %u\n", wraps);
+	len += sprintf(buffer + len,
+				   "Channel 0 Thermal  : %s, %u events, last %u.%06u\n",
+				   thermal.active ? "Braked" : "OK", thermal.count,
+				   thermal.tv_sec, thermal.tv_usec);
 
 	return len;
 }
@@ -870,6 +1731,10 @@ int procfile_channel0_read(char *buffer, char **buffer_location, off_t offset,
 int procfile_channel1_read(char *buffer, char **buffer_location, off_t offset,
 						   int buffer_length, int *eof, void *data)
 {
+	struct LM629_Thermal thermal;
+	unsigned long flags;
+	__s64 position;
+	unsigned int wraps;
 	int len;
 
 	LG(TRACE,
@@ -878,8 +1743,21 @@ int procfile_channel1_read(char *buffer, char **buffer_location, off_t offset,
 	if (offset > 0)
 		return 0;
 
+	servo_copy_position(1, &position, &wraps);
+
+	spin_lock_irqsave(&brake_lock, flags);
+	thermal = servo.Channel1->Thermal;
+	spin_unlock_irqrestore(&brake_lock, flags);
+
 	len = sprintf(buffer,
 				  "Ajeco ANDI-SERVO Motion controller driver. $Revision: 2.59 $\n\n");
+	len += sprintf(buffer + len, "Channel 1 Position : %Ld\n",
+				   (long long) position);
+	len += sprintf(buffer + len, "Channel 1 Wraps    : %u\n", wraps);
+	len += sprintf(buffer + len,
+				   "Channel 1 Thermal  : %s, %u events, last %u.%06u\n",
+				   thermal.active ? "Braked" : "OK", thermal.count,
+				   thermal.tv_sec, thermal.tv_usec);
 
 	return len;
 }
@@ -893,6 +1771,7 @@ int procfile_trajectory0_read(char *buffer, char **buffer_location,
 							  off_t offset, int buffer_length, int *eof,
 							  void *data)
 {
+	struct LM629_Trajectory trajectory;
 	int len;
 
 	LG(TRACE,
@@ -902,7 +1781,8 @@ int procfile_trajectory0_read(char *buffer, char **buffer_location,
 		return 0;
 
 	len = sprintf(buffer, "Channel 0 Trajectory :\n");
-	len += print_trajectory(servo.Channel0->Trajectory, buffer + len);
+	servo_copy_trajectory(0, &trajectory);
+	len += print_trajectory(&trajectory, buffer + len);
 
 	return len;
 }
@@ -916,6 +1796,7 @@ int procfile_trajectory1_read(char *buffer, char **buffer_location,
 							  off_t offset, int buffer_length, int *eof,
 							  void *data)
 {
+	struct LM629_Trajectory trajectory;
 	int len;
 
 	LG(TRACE,
@@ -925,7 +1806,8 @@ int procfile_trajectory1_read(char *buffer, char **buffer_location,
 		return 0;
 
 	len = sprintf(buffer, "Channel 1 Trajectory :\n");
-	len += print_trajectory(servo.Channel1->Trajectory, buffer + len);
+	servo_copy_trajectory(1, &trajectory);
+	len += print_trajectory(&trajectory, buffer + len);
 
 	return len;
 }
@@ -938,6 +1820,7 @@ int procfile_trajectory1_read(char *buffer, char **buffer_location,
 int procfile_filter0_read(char *buffer, char **buffer_location, off_t offset,
 						  int buffer_length, int *eof, void *data)
 {
+	struct LM629_Filter filter;
 	int len;
 
 	LG(TRACE,
@@ -947,7 +1830,10 @@ int procfile_filter0_read(char *buffer, char **buffer_location, off_t offset,
 		return 0;
 
 	len = sprintf(buffer, "Channel 0 Filter :\n");
-	len += print_filter(servo.Channel0->Filter, buffer + len);
+	servo_copy_filter(0, &filter);
+	len += print_filter(&filter, buffer + len);
+	len += print_gain_status(&servo.Channel0->GainSchedule,
+							 &servo.Channel0->GainStatus, buffer + len);
 
 	return len;
 }
@@ -960,6 +1846,7 @@ int procfile_filter0_read(char *buffer, char **buffer_location, off_t offset,
 int procfile_filter1_read(char *buffer, char **buffer_location, off_t offset,
 						  int buffer_length, int *eof, void *data)
 {
+	struct LM629_Filter filter;
 	int len;
 
 	LG(TRACE,
@@ -969,221 +1856,526 @@ int procfile_filter1_read(char *buffer, char **buffer_location, off_t offset,
 		return 0;
 
 	len = sprintf(buffer, "Channel 1 Filter :\n");
-	len += print_filter(servo.Channel1->Filter, buffer + len);
+	servo_copy_filter(1, &filter);
+	len += print_filter(&filter, buffer + len);
+	len += print_gain_status(&servo.Channel1->GainSchedule,
+							 &servo.Channel1->GainStatus, buffer + len);
 
 	return len;
 }
 
-/*------------------------------------------------------------------------+
- |static int servo_read_board(char* buffer, size_t length, loff_t *offset)|
- +-----------------------------------------------------------------------*/
-static int servo_read_board(char *buffer, size_t length, loff_t * offset)
+/*---------------------------------------------------------------------------+
+ |int procfile_pose_read(char *buffer, char **buffer_location, off_t offset, |
+ |              int buffer_length, int *eof, void *data)                     |
+ +--------------------------------------------------------------------------*/
+
+int procfile_pose_read(char *buffer, char **buffer_location, off_t offset,
+					   int buffer_length, int *eof, void *data)
 {
+	int len;
 
 	LG(TRACE,
-	   "static int servo_read_board(char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_pose_read(char *buffer, char **buffer_location, off_t offset, int buffer_length, int *eof, void *data)\n");
 
-	return -ENOSYS;
+	if (offset > 0)
+		return 0;
+
+	spin_lock_bh(&odometry_lock);
+	len = print_pose(&odometry, buffer);
+	spin_unlock_bh(&odometry_lock);
+
+	return len;
 }
 
-/*---------------------------------------------------------------------------+
- |static int servo_read_channel0(char* buffer, size_t length, loff_t *offset)|
- +--------------------------------------------------------------------------*/
-static int servo_read_channel0(char *buffer, size_t length, loff_t * offset)
+/*----------------------------------------------------------------------------+
+ |int procfile_locks_read(char *buffer, char **buffer_location, off_t offset, |
+ |              int buffer_length, int *eof, void *data)                      |
+ +---------------------------------------------------------------------------*/
+
+int procfile_locks_read(char *buffer, char **buffer_location, off_t offset,
+						int buffer_length, int *eof, void *data)
 {
+	struct servo_lock_stats stats;
+	int len, channel;
+
 	LG(TRACE,
-	   "static int servo_read_channel0(char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_locks_read(char *buffer, char **buffer_location, off_t offset, int buffer_length, int *eof, void *data)\n");
 
-	return -ENOSYS;
+	if (offset > 0)
+		return 0;
+
+	len = 0;
+	for (channel = 0; channel < 2; channel++)
+	{
+		/* A snapshot; the counters are only changed with the lock held */
+		stats = servo_lock_stats[channel];
+
+		len += sprintf(buffer + len,
+					   "Channel %d bus lock : %lu taken, %lu contended, %lu samples skipped\n",
+					   channel, stats.acquired, stats.contended, stats.skipped);
+		len += sprintf(buffer + len,
+					   "                     held %lu us in all, %lu us at most\n",
+					   servo_cycles_to_us(stats.held),
+					   servo_cycles_to_us(stats.held_max));
+	}
+
+	return len;
 }
 
-/*---------------------------------------------------------------------------+
- |static int servo_read_channel1(char* buffer, size_t length, loff_t *offset)|
- +--------------------------------------------------------------------------*/
-static int servo_read_channel1(char *buffer, size_t length, loff_t * offset)
+/*-------------------------------------------------------------------------------+
+ |int procfile_latency0_read(char *buffer, char **buffer_location, off_t offset, |
+ |              int buffer_length, int *eof, void *data)                         |
+ +------------------------------------------------------------------------------*/
+
+int procfile_latency0_read(char *buffer, char **buffer_location, off_t offset,
+						   int buffer_length, int *eof, void *data)
 {
 	LG(TRACE,
-	   "static int servo_read_channel1(char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_latency0_read(char *buffer, char **buffer_location, off_t offset, int buffer_length, int *eof, void *data)\n");
 
-	return 0;
+	if (offset > 0)
+		return 0;
+
+	return servo_print_latency(0, buffer);
 }
 
-/*--------------------------------------------------------------------------+
- |static int servo_read_filter0(char* buffer, size_t length, loff_t *offset)|
- +-------------------------------------------------------------------------*/
-static int servo_read_filter0(char *buffer, size_t length, loff_t * offset)
-{
-	int retval;
+/*-------------------------------------------------------------------------------+
+ |int procfile_latency1_read(char *buffer, char **buffer_location, off_t offset, |
+ |              int buffer_length, int *eof, void *data)                         |
+ +------------------------------------------------------------------------------*/
 
+int procfile_latency1_read(char *buffer, char **buffer_location, off_t offset,
+						   int buffer_length, int *eof, void *data)
+{
 	LG(TRACE,
-	   "static int servo_read_filter0(char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_latency1_read(char *buffer, char **buffer_location, off_t offset, int buffer_length, int *eof, void *data)\n");
 
-	retval = sprintf(buffer, "Channel 0 Filter :\n");
-	retval += print_filter(servo.Channel0->Filter, buffer + retval);
+	if (offset > 0)
+		return 0;
 
-	return retval;
+	return servo_print_latency(1, buffer);
 }
 
-/*--------------------------------------------------------------------------+
- |static int servo_read_filter1(char* buffer, size_t length, loff_t *offset)|
- +-------------------------------------------------------------------------*/
-static int servo_read_filter1(char *buffer, size_t length, loff_t * offset)
+/*---------------------------------------------------------------------+
+ |int procfile_latency0_write(struct file *file, const char *buffer,   |
+ |              unsigned long count, void *data)                       |
+ |                                                                     |
+ |    Writing anything to the file clears the channel's stats.         |
+ +--------------------------------------------------------------------*/
+
+int procfile_latency0_write(struct file *file, const char *buffer,
+							unsigned long count, void *data)
 {
 	int retval;
 
 	LG(TRACE,
-	   "static int servo_read_filter1(char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_latency0_write(struct file *file, const char *buffer, unsigned long count, void *data)\n");
 
-	retval = sprintf(buffer, "Channel 1 Filter :\n");
-	retval += print_filter(servo.Channel1->Filter, buffer + retval);
+	retval = servo_reset_latency(0);
+	if (retval < 0)
+		return retval;
 
-	return retval;
+	return count;
 }
 
-/*------------------------------------------------------------------------------+
- |static int servo_read_trajectory0(char* buffer, size_t length, loff_t *offset)|
- +-----------------------------------------------------------------------------*/
-static int servo_read_trajectory0(char *buffer, size_t length, loff_t * offset)
+/*---------------------------------------------------------------------+
+ |int procfile_latency1_write(struct file *file, const char *buffer,   |
+ |              unsigned long count, void *data)                       |
+ +--------------------------------------------------------------------*/
+
+int procfile_latency1_write(struct file *file, const char *buffer,
+							unsigned long count, void *data)
 {
 	int retval;
 
 	LG(TRACE,
-	   "static int servo_read_trajectory0(char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_latency1_write(struct file *file, const char *buffer, unsigned long count, void *data)\n");
 
-	retval = sprintf(buffer, "Channel 0 Trajectory :\n");
-	retval += print_trajectory(servo.Channel0->Trajectory, buffer + retval);
+	retval = servo_reset_latency(1);
+	if (retval < 0)
+		return retval;
 
-	return retval;
+	return count;
 }
 
-/*------------------------------------------------------------------------------+
- |static int servo_read_trajectory1(char* buffer, size_t length, loff_t *offset)|
- +-----------------------------------------------------------------------------*/
-static int servo_read_trajectory1(char *buffer, size_t length, loff_t * offset)
+/*---------------------------------------------------------------------------+
+ |int procfile_bus_read(char *buffer, char **buffer_location, off_t offset,  |
+ |              int buffer_length, int *eof, void *data)                     |
+ +--------------------------------------------------------------------------*/
+
+int procfile_bus_read(char *buffer, char **buffer_location, off_t offset,
+					  int buffer_length, int *eof, void *data)
 {
-	int retval;
+	struct ANDI_Bus counts;
 
 	LG(TRACE,
-	   "static int servo_read_trajectory1(char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_bus_read(char *buffer, char **buffer_location, off_t offset, int buffer_length, int *eof, void *data)\n");
 
-	retval = sprintf(buffer, "Channel 1 Trajectory :\n");
-	retval += print_trajectory(servo.Channel1->Trajectory, buffer + retval);
+	if (offset > 0)
+		return 0;
 
-	return retval;
+	get_bus_counts(&counts);
+
+	return print_bus_counts(&counts, buffer);
 }
 
-/*-------------------------------------------------------------------------------+
- |static int servo_write_board(const char* buffer, size_t length, loff_t *offset)|
- +------------------------------------------------------------------------------*/
-static int servo_write_board(const char *buffer, size_t length, loff_t * offset)
+/*----------------------------------------------------------------------------+
+ |int procfile_trace_read(char *buffer, char **buffer_location, off_t offset, |
+ |              int buffer_length, int *eof, void *data)                      |
+ +---------------------------------------------------------------------------*/
+
+int procfile_trace_read(char *buffer, char **buffer_location, off_t offset,
+						int buffer_length, int *eof, void *data)
 {
 	LG(TRACE,
-	   "static int servo_write_board(const char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_trace_read(char *buffer, char **buffer_location, off_t offset, int buffer_length, int *eof, void *data)\n");
 
-	return -ENOSYS;
+	return trace_read(buffer, buffer_location, offset, buffer_length);
 }
 
-/*----------------------------------------------------------------------------------+
- |static int servo_write_channel0(const char* buffer, size_t length, loff_t *offset)|
- +---------------------------------------------------------------------------------*/
-static int servo_write_channel0(const char *buffer, size_t length,
-								loff_t * offset)
+/*---------------------------------------------------------------------+
+ |int procfile_trace_write(struct file *file, const char *buffer,      |
+ |              unsigned long count, void *data)                       |
+ |                                                                     |
+ |    1 empties the trace and starts it, 0 stops it.                   |
+ +--------------------------------------------------------------------*/
+
+int procfile_trace_write(struct file *file, const char *buffer,
+						 unsigned long count, void *data)
 {
+	char c;
+
 	LG(TRACE,
-	   "static int servo_write_channel0(const char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_trace_write(struct file *file, const char *buffer, unsigned long count, void *data)\n");
 
-	return -ENOSYS;
+	if (!count)
+		return 0;
+
+	if (get_user(c, buffer))
+		return -EFAULT;
+
+	switch (c)
+	{
+	case '1':
+		trace_start();
+		break;
+
+	case '0':
+		trace_stop();
+		break;
+
+	default:
+		return -EINVAL;
+	}
+
+	return count;
 }
 
-/*----------------------------------------------------------------------------------+
- |static int servo_write_channel1(const char* buffer, size_t length, loff_t *offset)|
- +---------------------------------------------------------------------------------*/
-static int servo_write_channel1(const char *buffer, size_t length,
-								loff_t * offset)
+/*------------------------------------------------------------------------------+
+ |int procfile_capture_read(char *buffer, char **buffer_location, off_t offset, |
+ |              int buffer_length, int *eof, void *data)                        |
+ +-----------------------------------------------------------------------------*/
+
+int procfile_capture_read(char *buffer, char **buffer_location, off_t offset,
+						  int buffer_length, int *eof, void *data)
 {
 	LG(TRACE,
-	   "static int servo_write_channel1(const char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_capture_read(char *buffer, char **buffer_location, off_t offset, int buffer_length, int *eof, void *data)\n");
 
-	return -ENOSYS;
+	return capture_read(buffer, buffer_location, offset, buffer_length);
 }
 
-/*---------------------------------------------------------------------------------+
- |static int servo_write_filter0(const char* buffer, size_t length, loff_t *offset)|
- +--------------------------------------------------------------------------------*/
-static int servo_write_filter0(const char *buffer, size_t length,
-							   loff_t * offset)
+/*---------------------------------------------------------------------+
+ |int procfile_capture_write(struct file *file, const char *buffer,    |
+ |              unsigned long count, void *data)                       |
+ |                                                                     |
+ |    1 empties the capture and starts it, 0 stops it.                 |
+ +--------------------------------------------------------------------*/
+
+int procfile_capture_write(struct file *file, const char *buffer,
+						   unsigned long count, void *data)
 {
-	int retval;
+	char c;
 
 	LG(TRACE,
-	   "static int servo_write_filter0(const char* buffer, size_t length, loff_t *offset)\n");
+	   "int procfile_capture_write(struct file *file, const char *buffer, unsigned long count, void *data)\n");
 
-	retval =
-		copy_from_user(servo.Channel0->NewFilter,
-					   (struct LM629_Filter *) buffer,
-					   sizeof (struct LM629_Filter));
+	if (!count)
+		return 0;
 
-	if (retval)
+	if (get_user(c, buffer))
 		return -EFAULT;
 
-	if (!load_filter(&servo, 0))
-		return -EIO;
+	switch (c)
+	{
+	case '1':
+		capture_start(servo.base_address);
+		break;
+
+	case '0':
+		capture_stop();
+		break;
 
-	memcpy(servo.Channel0->Filter, servo.Channel0->NewFilter,
-		   sizeof (struct LM629_Filter));
+	default:
+		return -EINVAL;
+	}
 
-	return sizeof (struct LM629_Filter);
+	return count;
 }
 
-/*---------------------------------------------------------------------------------+
- |static int servo_write_filter1(const char* buffer, size_t length, loff_t *offset)|
- +--------------------------------------------------------------------------------*/
-static int servo_write_filter1(const char *buffer, size_t length,
-							   loff_t * offset)
+/*---------------------------------------------------------------------+
+ |    static int servo_print_latency(int channel, char *buffer)        |
+ |                                                                     |
+ |    A snapshot, taken without the bus lock. Operations that would    |
+ |    run the page over are left out and the fact noted.               |
+ +--------------------------------------------------------------------*/
+static int servo_print_latency(int channel, char *buffer)
 {
-	int retval;
+	struct LM629_Op_Stats stats;
+	struct LM629 *lm629;
+	char line[768];
+	int len, n, op;
 
-	LG(TRACE,
-	   "static int servo_write_filter1(const char* buffer, size_t length, loff_t *offset)\n");
+	LG(TRACE, "static int servo_print_latency(int channel, char *buffer)\n");
 
-	retval =
-		copy_from_user(servo.Channel1->NewFilter,
-					   (struct LM629_Filter *) buffer,
-					   sizeof (struct LM629_Filter));
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
 
-	if (retval)
-		return -EFAULT;
+	len = sprintf(buffer, "Channel %d LM629 operations :\n", channel);
+	for (op = 0; op < LM629_OPS; op++)
+	{
+		stats = lm629->Ops[op];
 
-	if (!load_filter(&servo, 1))
-		return -EIO;
+		n = print_op_stats(op, &stats, line);
+		if (len + n > LIMIT)
+		{
+			len += sprintf(buffer + len, "...\n");
+			break;
+		}
 
-	memcpy(servo.Channel1->Filter, servo.Channel1->NewFilter,
-		   sizeof (struct LM629_Filter));
+		memcpy(buffer + len, line, n);
+		len += n;
+	}
 
-	return sizeof (struct LM629_Filter);
+	return len;
 }
 
-/*-------------------------------------------------------------------------------------+
+/*---------------------------------------------------------------------+
+ |    static int servo_reset_latency(int channel)                      |
+ +--------------------------------------------------------------------*/
+static int servo_reset_latency(int channel)
+{
+	struct LM629 *lm629;
+	int retval;
+
+	LG(TRACE, "static int servo_reset_latency(int channel)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	retval = servo_lock(1 << channel);
+	if (retval < 0)
+		return retval;
+
+	memset(lm629->Ops, 0, sizeof(lm629->Ops));
+
+	servo_unlock(1 << channel);
+
+	return 0;
+}
+
+/*------------------------------------------------------------------------+
+ |static int servo_read_board(char* buffer, size_t length, loff_t *offset)|
+ +-----------------------------------------------------------------------*/
+static int servo_read_board(char *buffer, size_t length, loff_t * offset)
+{
+
+	LG(TRACE,
+	   "static int servo_read_board(char* buffer, size_t length, loff_t *offset)\n");
+
+	return -ENOSYS;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_read_channel0(struct file *file, char* buffer,      |
+ |                               size_t length, loff_t *offset)        |
+ +--------------------------------------------------------------------*/
+static int servo_read_channel0(struct file *file, char *buffer, size_t length,
+							   loff_t * offset)
+{
+	LG(TRACE,
+	   "static int servo_read_channel0(struct file *file, char* buffer, size_t length, loff_t *offset)\n");
+
+	return servo_read_events(file->private_data, file, buffer, length);
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_read_channel1(struct file *file, char* buffer,      |
+ |                               size_t length, loff_t *offset)        |
+ +--------------------------------------------------------------------*/
+static int servo_read_channel1(struct file *file, char *buffer, size_t length,
+							   loff_t * offset)
+{
+	LG(TRACE,
+	   "static int servo_read_channel1(struct file *file, char* buffer, size_t length, loff_t *offset)\n");
+
+	return servo_read_events(file->private_data, file, buffer, length);
+}
+
+/*--------------------------------------------------------------------------+
+ |static int servo_read_filter0(char* buffer, size_t length, loff_t *offset)|
+ +-------------------------------------------------------------------------*/
+static int servo_read_filter0(char *buffer, size_t length, loff_t * offset)
+{
+	struct LM629_Filter filter;
+	int retval;
+
+	LG(TRACE,
+	   "static int servo_read_filter0(char* buffer, size_t length, loff_t *offset)\n");
+
+	retval = sprintf(buffer, "Channel 0 Filter :\n");
+	servo_copy_filter(0, &filter);
+	retval += print_filter(&filter, buffer + retval);
+
+	return retval;
+}
+
+/*--------------------------------------------------------------------------+
+ |static int servo_read_filter1(char* buffer, size_t length, loff_t *offset)|
+ +-------------------------------------------------------------------------*/
+static int servo_read_filter1(char *buffer, size_t length, loff_t * offset)
+{
+	struct LM629_Filter filter;
+	int retval;
+
+	LG(TRACE,
+	   "static int servo_read_filter1(char* buffer, size_t length, loff_t *offset)\n");
+
+	retval = sprintf(buffer, "Channel 1 Filter :\n");
+	servo_copy_filter(1, &filter);
+	retval += print_filter(&filter, buffer + retval);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------------+
+ |static int servo_read_trajectory0(char* buffer, size_t length, loff_t *offset)|
+ +-----------------------------------------------------------------------------*/
+static int servo_read_trajectory0(char *buffer, size_t length, loff_t * offset)
+{
+	struct LM629_Trajectory trajectory;
+	int retval;
+
+	LG(TRACE,
+	   "static int servo_read_trajectory0(char* buffer, size_t length, loff_t *offset)\n");
+
+	retval = sprintf(buffer, "Channel 0 Trajectory :\n");
+	servo_copy_trajectory(0, &trajectory);
+	retval += print_trajectory(&trajectory, buffer + retval);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------------+
+ |static int servo_read_trajectory1(char* buffer, size_t length, loff_t *offset)|
+ +-----------------------------------------------------------------------------*/
+static int servo_read_trajectory1(char *buffer, size_t length, loff_t * offset)
+{
+	struct LM629_Trajectory trajectory;
+	int retval;
+
+	LG(TRACE,
+	   "static int servo_read_trajectory1(char* buffer, size_t length, loff_t *offset)\n");
+
+	retval = sprintf(buffer, "Channel 1 Trajectory :\n");
+	servo_copy_trajectory(1, &trajectory);
+	retval += print_trajectory(&trajectory, buffer + retval);
+
+	return retval;
+}
+
+/*-------------------------------------------------------------------------------+
+ |static int servo_write_board(const char* buffer, size_t length, loff_t *offset)|
+ +------------------------------------------------------------------------------*/
+static int servo_write_board(const char *buffer, size_t length, loff_t * offset)
+{
+	LG(TRACE,
+	   "static int servo_write_board(const char* buffer, size_t length, loff_t *offset)\n");
+
+	return -ENOSYS;
+}
+
+/*----------------------------------------------------------------------------------+
+ |static int servo_write_channel0(const char* buffer, size_t length, loff_t *offset)|
+ +---------------------------------------------------------------------------------*/
+static int servo_write_channel0(const char *buffer, size_t length,
+								loff_t * offset)
+{
+	LG(TRACE,
+	   "static int servo_write_channel0(const char* buffer, size_t length, loff_t *offset)\n");
+
+	return -ENOSYS;
+}
+
+/*----------------------------------------------------------------------------------+
+ |static int servo_write_channel1(const char* buffer, size_t length, loff_t *offset)|
+ +---------------------------------------------------------------------------------*/
+static int servo_write_channel1(const char *buffer, size_t length,
+								loff_t * offset)
+{
+	LG(TRACE,
+	   "static int servo_write_channel1(const char* buffer, size_t length, loff_t *offset)\n");
+
+	return -ENOSYS;
+}
+
+/*---------------------------------------------------------------------------------+
+ |static int servo_write_filter0(const char* buffer, size_t length, loff_t *offset)|
+ +--------------------------------------------------------------------------------*/
+static int servo_write_filter0(const char *buffer, size_t length,
+							   loff_t * offset)
+{
+	struct iovec iov;
+
+	LG(TRACE,
+	   "static int servo_write_filter0(const char* buffer, size_t length, loff_t *offset)\n");
+
+	iov.iov_base = (void *) buffer;
+	iov.iov_len = length;
+
+	return servo_write_filter_table(0, &iov, 1);
+}
+
+/*---------------------------------------------------------------------------------+
+ |static int servo_write_filter1(const char* buffer, size_t length, loff_t *offset)|
+ +--------------------------------------------------------------------------------*/
+static int servo_write_filter1(const char *buffer, size_t length,
+							   loff_t * offset)
+{
+	struct iovec iov;
+
+	LG(TRACE,
+	   "static int servo_write_filter1(const char* buffer, size_t length, loff_t *offset)\n");
+
+	iov.iov_base = (void *) buffer;
+	iov.iov_len = length;
+
+	return servo_write_filter_table(1, &iov, 1);
+}
+
+/*-------------------------------------------------------------------------------------+
  |static int servo_write_trajectory0(const char* buffer, size_t length, loff_t *offset)|
  +------------------------------------------------------------------------------------*/
 static int servo_write_trajectory0(const char *buffer, size_t length,
 								   loff_t * offset)
 {
+	struct iovec iov;
+
 	LG(TRACE,
 	   "static int servo_write_trajectory0(const char* buffer, size_t length, loff_t *offset)\n");
 
-	if (copy_from_user
-		(servo.Channel0->NewTrajectory, (struct LM629_Trajectory *) buffer,
-		 sizeof (struct LM629_Trajectory)))
-		return -EFAULT;
-
-	if (!load_trajectory(&servo, 1))
-		return -EIO;
+	iov.iov_base = (void *) buffer;
+	iov.iov_len = length;
 
-	memcpy(servo.Channel0->Trajectory, servo.Channel0->NewTrajectory,
-		   sizeof (struct LM629_Trajectory));
-
-	return sizeof (struct LM629_Trajectory);
+	return servo_write_trajectory_table(0, &iov, 1);
 }
 
 /*-------------------------------------------------------------------------------------+
@@ -1192,19 +2384,2403 @@ static int servo_write_trajectory0(const char *buffer, size_t length,
 static int servo_write_trajectory1(const char *buffer, size_t length,
 								   loff_t * offset)
 {
+	struct iovec iov;
+
 	LG(TRACE,
 	   "static int servo_write_trajectory1(const char* buffer, size_t length, loff_t *offset)\n");
 
-	if (copy_from_user
-		(servo.Channel1->NewTrajectory, (struct LM629_Trajectory *) buffer,
-		 sizeof (struct LM629_Trajectory)))
+	iov.iov_base = (void *) buffer;
+	iov.iov_len = length;
+
+	return servo_write_trajectory_table(1, &iov, 1);
+}
+
+/*---------------------------------------------------------------------+
+ |    Helpers shared by the filter and trajectory minors.              |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |static int servo_gather(char *dest, size_t size,                     |
+ |                        const struct iovec *iov, unsigned long count)|
+ |                                                                     |
+ | Copies write() or writev() segments back to back into dest. This is |
+ | the only copy_from_user() on the table write path. Returns the      |
+ | total length.                                                       |
+ +--------------------------------------------------------------------*/
+static int servo_gather(char *dest, size_t size, const struct iovec *iov,
+						unsigned long count)
+{
+	size_t length;
+	unsigned long i;
+
+	LG(TRACE,
+	   "static int servo_gather(char *dest, size_t size, const struct iovec *iov, unsigned long count)\n");
+
+	length = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (iov[i].iov_len > size - length)
+			return -EFBIG;
+
+		if (copy_from_user(dest + length, iov[i].iov_base, iov[i].iov_len))
+			return -EFAULT;
+
+		length += iov[i].iov_len;
+	}
+
+	return length;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_is_packed(const struct iovec *iov,                  |
+ |                           unsigned long count)                      |
+ |                                                                     |
+ | Peeks at the leading word of a write to tell packed records from    |
+ | native ones.                                                        |
+ +--------------------------------------------------------------------*/
+static int servo_is_packed(const struct iovec *iov, unsigned long count)
+{
+	__u16 version;
+
+	LG(TRACE,
+	   "static int servo_is_packed(const struct iovec *iov, unsigned long count)\n");
+
+	if (!count || iov[0].iov_len < sizeof (version))
+		return -EINVAL;
+
+	if (get_user(version, (__u16 *) iov[0].iov_base))
 		return -EFAULT;
 
-	if (!load_trajectory(&servo, 1))
-		return -EIO;
+	return version == LM629_PACKED_VERSION;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_fill_filters(int channel, struct LM629_Filter *bank,|
+ |                         const struct iovec *iov, unsigned long count)|
+ |                                                                     |
+ | Fills a filter bank from user-space and validates it. Native records|
+ | land directly in the bank and are checked in place; packed ones go  |
+ | through the channel's staging buffer to be unpacked. Returns the    |
+ | number of records.                                                  |
+ +--------------------------------------------------------------------*/
+static int servo_fill_filters(int channel, struct LM629_Filter *bank,
+							  const struct iovec *iov, unsigned long count)
+{
+	struct LM629_Filter_packed *packed;
+	int i, length, records, retval;
+
+	LG(TRACE,
+	   "static int servo_fill_filters(int channel, struct LM629_Filter *bank, const struct iovec *iov, unsigned long count)\n");
+
+	retval = servo_is_packed(iov, count);
+	if (retval < 0)
+		return retval;
+
+	if (retval)
+	{
+		length = servo_gather(write_buffer[channel], SERVO_WRITE_BUFFER_SIZE,
+							  iov, count);
+		if (length < 0)
+			return length;
+
+		if (length % sizeof (struct LM629_Filter_packed))
+			return -EINVAL;
+
+		records = length / sizeof (struct LM629_Filter_packed);
+		packed = (struct LM629_Filter_packed *) write_buffer[channel];
+
+		for (i = 0; i < records; i++)
+		{
+			retval = unpack_filter(&packed[i], &bank[i]);
+			if (retval < 0)
+				return retval;
+		}
+	}
+	else
+	{
+		length = servo_gather((char *) bank,
+							  SERVO_MAX_RECORDS * sizeof (struct LM629_Filter),
+							  iov, count);
+		if (length < 0)
+			return length;
+
+		if (length % sizeof (struct LM629_Filter))
+			return -EINVAL;
+
+		records = length / sizeof (struct LM629_Filter);
+	}
+
+	if (!records)
+		return -EINVAL;
+
+	for (i = 0; i < records; i++)
+	{
+		retval = check_filter(&bank[i]);
+		if (retval < 0)
+			return retval;
+	}
+
+	return records;
+}
+
+/*----------------------------------------------------------------------+
+ |static int servo_fill_trajectories(int channel,                       |
+ |                                   struct LM629_Trajectory *bank,     |
+ |                         const struct iovec *iov, unsigned long count)|
+ |                                                                      |
+ | As servo_fill_filters(), for trajectories.                           |
+ +---------------------------------------------------------------------*/
+static int servo_fill_trajectories(int channel,
+								   struct LM629_Trajectory *bank,
+								   const struct iovec *iov, unsigned long count)
+{
+	struct LM629_Trajectory_packed *packed;
+	int i, length, records, retval;
+
+	LG(TRACE,
+	   "static int servo_fill_trajectories(int channel, struct LM629_Trajectory *bank, const struct iovec *iov, unsigned long count)\n");
+
+	retval = servo_is_packed(iov, count);
+	if (retval < 0)
+		return retval;
+
+	if (retval)
+	{
+		length = servo_gather(write_buffer[channel], SERVO_WRITE_BUFFER_SIZE,
+							  iov, count);
+		if (length < 0)
+			return length;
+
+		if (length % sizeof (struct LM629_Trajectory_packed))
+			return -EINVAL;
+
+		records = length / sizeof (struct LM629_Trajectory_packed);
+		packed = (struct LM629_Trajectory_packed *) write_buffer[channel];
+
+		for (i = 0; i < records; i++)
+		{
+			retval = unpack_trajectory(&packed[i], &bank[i]);
+			if (retval < 0)
+				return retval;
+		}
+	}
+	else
+	{
+		length = servo_gather((char *) bank,
+							  SERVO_MAX_RECORDS *
+							  sizeof (struct LM629_Trajectory), iov, count);
+		if (length < 0)
+			return length;
+
+		if (length % sizeof (struct LM629_Trajectory))
+			return -EINVAL;
+
+		records = length / sizeof (struct LM629_Trajectory);
+	}
+
+	if (!records)
+		return -EINVAL;
+
+	for (i = 0; i < records; i++)
+	{
+		retval = check_trajectory(&bank[i]);
+		if (retval < 0)
+			return retval;
+	}
+
+	return records;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_write_filter_table(int channel,                     |
+ |                         const struct iovec *iov, unsigned long count)|
+ |                                                                     |
+ | The records are written into whichever bank doesn't hold the filter |
+ | the LM629 is running, validated there, and committed by switching   |
+ | the table over to that bank and bumping filter_seq. The first entry |
+ | is then sent to the LM629 with LFIL; SERVO_UPDATE_FILTER makes it   |
+ | active. SERVO_LOAD_FILTER picks another entry.                      |
+ +--------------------------------------------------------------------*/
+static int servo_write_filter_table(int channel, const struct iovec *iov,
+									unsigned long count)
+{
+	struct LM629 *lm629;
+	struct LM629_Filter *bank;
+	int records, retval;
+	size_t length;
+	unsigned long i;
 
-	memcpy(servo.Channel1->Trajectory, servo.Channel1->NewTrajectory,
-		   sizeof (struct LM629_Trajectory));
+	LG(TRACE,
+	   "static int servo_write_filter_table(int channel, const struct iovec *iov, unsigned long count)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	bank = lm629->FilterBank[0];
+	if (IN_BANK(lm629->Filter, bank))
+		bank = lm629->FilterBank[1];
+
+	records = servo_fill_filters(channel, bank, iov, count);
+	if (records < 0)
+	{
+		/* The pending filter, if it lived here, has been overwritten */
+		if (IN_BANK(lm629->NewFilter, bank))
+			lm629->NewFilter = NULL;
+		if (lm629->FilterTable == bank)
+			lm629->filter_count = 0;
+		return records;
+	}
+
+	lm629->FilterTable = bank;
+	lm629->filter_count = records;
+	lm629->filter_seq++;
+	lm629->NewFilter = &bank[0];
+	lm629->GainStatus.active = -1;
+
+	retval = load_filter(&servo, channel);
+	if (retval < 0)
+		return retval;
+
+	for (length = 0, i = 0; i < count; i++)
+		length += iov[i].iov_len;
+
+	return length;
+}
+
+/*----------------------------------------------------------------------+
+ |static int servo_write_trajectory_table(int channel,                  |
+ |                         const struct iovec *iov, unsigned long count)|
+ |                                                                      |
+ | As servo_write_filter_table(), for trajectories. Each                |
+ | SERVO_START_TRAJECTORY starts the loaded entry and loads the next.   |
+ +---------------------------------------------------------------------*/
+static int servo_write_trajectory_table(int channel, const struct iovec *iov,
+										unsigned long count)
+{
+	struct LM629 *lm629;
+	struct LM629_Trajectory *bank;
+	int records, retval;
+	size_t length;
+	unsigned long i;
+
+	LG(TRACE,
+	   "static int servo_write_trajectory_table(int channel, const struct iovec *iov, unsigned long count)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	bank = lm629->TrajectoryBank[0];
+	if (IN_BANK(lm629->Trajectory, bank))
+		bank = lm629->TrajectoryBank[1];
+
+	records = servo_fill_trajectories(channel, bank, iov, count);
+	if (records < 0)
+	{
+		if (IN_BANK(lm629->NewTrajectory, bank))
+			lm629->NewTrajectory = NULL;
+		if (lm629->TrajectoryTable == bank)
+			lm629->trajectory_count = 0;
+		return records;
+	}
+
+	lm629->TrajectoryTable = bank;
+	lm629->trajectory_count = records;
+	lm629->trajectory_next = 1;
+	lm629->trajectory_seq++;
+	lm629->NewTrajectory = &bank[0];
+
+	retval = load_trajectory(&servo, channel);
+	if (retval < 0)
+		return retval;
+
+	for (length = 0, i = 0; i < count; i++)
+		length += iov[i].iov_len;
+
+	return length;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_load_filter_entry(int channel, int index)           |
+ +--------------------------------------------------------------------*/
+static int servo_load_filter_entry(int channel, int index)
+{
+	struct LM629 *lm629;
+
+	LG(TRACE, "static int servo_load_filter_entry(int channel, int index)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	if (index < 0 || index >= lm629->filter_count)
+		return -EINVAL;
+
+	lm629->NewFilter = &lm629->FilterTable[index];
+
+	return load_filter(&servo, channel);
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_load_trajectory_entry(int channel, int index)       |
+ |                                                                     |
+ | Loads trajectory table entry index; the table carries on from there.|
+ +--------------------------------------------------------------------*/
+static int servo_load_trajectory_entry(int channel, int index)
+{
+	struct LM629 *lm629;
+
+	LG(TRACE,
+	   "static int servo_load_trajectory_entry(int channel, int index)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	if (index < 0 || index >= lm629->trajectory_count)
+		return -EINVAL;
+
+	lm629->trajectory_next = index + 1;
+	lm629->NewTrajectory = &lm629->TrajectoryTable[index];
+
+	return load_trajectory(&servo, channel);
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_start_trajectory(int channel)                       |
+ |                                                                     |
+ | Starts the loaded trajectory. If the trajectory table has more      |
+ | entries, the next one is loaded straight away so that it is ready   |
+ | in the LM629 for the following start.                               |
+ +--------------------------------------------------------------------*/
+static int servo_start_trajectory(int channel)
+{
+	struct LM629 *lm629;
+	struct timeval now;
+	int retval;
+
+	LG(TRACE, "static int servo_start_trajectory(int channel)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	/* The complete bit is sticky, so clear what the last move left */
+	retval = reset_interrupts(&servo, channel, TRAJECTORY_COMPLETE_INTERRUPT);
+	if (retval < 0)
+		return retval;
+
+	retval = start_trajectory(&servo, channel);
+	if (retval < 0)
+		return retval;
+
+	do_gettimeofday(&now);
+
+	lm629->trajectory_complete = FALSE;
+	lm629->Move.start_sec = now.tv_sec;
+	lm629->Move.start_usec = now.tv_usec;
+	lm629->Move.done_sec = 0;
+	lm629->Move.done_usec = 0;
+	lm629->Move.duration_us = 0;
+
+	if (lm629->trajectory_next >= lm629->trajectory_count)
+		return 0;
+
+	lm629->NewTrajectory = &lm629->TrajectoryTable[lm629->trajectory_next++];
+
+	return load_trajectory(&servo, channel);
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_load_filter_packed(int channel,                     |
+ |                                    struct LM629_Filter_packed *arg) |
+ +--------------------------------------------------------------------*/
+static int servo_load_filter_packed(int channel,
+									struct LM629_Filter_packed *arg)
+{
+	struct iovec iov;
+	int retval;
+
+	LG(TRACE,
+	   "static int servo_load_filter_packed(int channel, struct LM629_Filter_packed *arg)\n");
+
+	iov.iov_base = arg;
+	iov.iov_len = sizeof (struct LM629_Filter_packed);
+
+	retval = servo_write_filter_table(channel, &iov, 1);
+	if (retval < 0)
+		return retval;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_get_filter_packed(int channel,                      |
+ |                                   struct LM629_Filter_packed *arg)  |
+ +--------------------------------------------------------------------*/
+static int servo_get_filter_packed(int channel, struct LM629_Filter_packed *arg)
+{
+	struct LM629_Filter_packed packed;
+	struct LM629 *lm629;
+
+	LG(TRACE,
+	   "static int servo_get_filter_packed(int channel, struct LM629_Filter_packed *arg)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	pack_filter(lm629->Filter, &packed);
+
+	if (copy_to_user(arg, &packed, sizeof (packed)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------+
+ |static int servo_load_trajectory_packed(int channel,                  |
+ |                                  struct LM629_Trajectory_packed *arg)|
+ +---------------------------------------------------------------------*/
+static int servo_load_trajectory_packed(int channel,
+										struct LM629_Trajectory_packed *arg)
+{
+	struct iovec iov;
+	int retval;
+
+	LG(TRACE,
+	   "static int servo_load_trajectory_packed(int channel, struct LM629_Trajectory_packed *arg)\n");
+
+	iov.iov_base = arg;
+	iov.iov_len = sizeof (struct LM629_Trajectory_packed);
+
+	retval = servo_write_trajectory_table(channel, &iov, 1);
+	if (retval < 0)
+		return retval;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------+
+ |static int servo_get_trajectory_packed(int channel,                   |
+ |                                  struct LM629_Trajectory_packed *arg)|
+ +---------------------------------------------------------------------*/
+static int servo_get_trajectory_packed(int channel,
+									   struct LM629_Trajectory_packed *arg)
+{
+	struct LM629_Trajectory_packed packed;
+	struct LM629 *lm629;
+
+	LG(TRACE,
+	   "static int servo_get_trajectory_packed(int channel, struct LM629_Trajectory_packed *arg)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	pack_trajectory(lm629->Trajectory, &packed);
+
+	if (copy_to_user(arg, &packed, sizeof (packed)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    Sampler and gain scheduling                                      |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |    static void servo_sample(unsigned long data)                     |
+ |                                                                     |
+ |    Timer function. Samples both channels, feeds the dead reckoning  |
+ |    when both encoders were read, and re-arms itself.                |
+ +--------------------------------------------------------------------*/
+static void servo_sample(unsigned long data)
+{
+	struct timeval stamp;
+	int channel, held, sampled;
+
+	if (irq <= 0)
+		servo_poll_thermal();
+
+	held = sampled = 0;
+	for (channel = 0; channel < 2; channel++)
+		if (servo_trylock(channel))
+		{
+			held |= 1 << channel;
+			if (!servo_sample_channel(channel))
+				sampled++;
+		}
+
+	if (sampled == 2)
+	{
+		stamp.tv_sec = servo.Channel1->Sample.tv_sec;
+		stamp.tv_usec = servo.Channel1->Sample.tv_usec;
+
+		spin_lock_bh(&odometry_lock);
+		odometry_update(&odometry, servo.Channel0->Sample.position,
+						servo.Channel1->Sample.position, &stamp);
+		spin_unlock_bh(&odometry_lock);
+	}
+
+	if (held == 3)
+		servo_fault_stop();
+
+	servo_unlock(held);
+
+	sample_timer.expires = jiffies + sample_ticks;
+	add_timer(&sample_timer);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_sample_channel(int channel)                     |
+ +--------------------------------------------------------------------*/
+static int servo_sample_channel(int channel)
+{
+	struct LM629 *lm629;
+	struct LM629_Sample previous;
+	struct timeval now;
+	long position, velocity;
+	int retval, status;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	retval = get_status(&servo, channel, &status);
+	if (retval < 0)
+		return retval;
+
+	servo_handle_status(channel, status, NULL);
+
+	retval = get_real_position(&servo, channel, &position);
+	if (retval < 0)
+		return retval;
+
+	servo_extend_position(lm629, position);
+
+	retval = get_real_velocity(&servo, channel, &velocity);
+	if (retval < 0)
+		return retval;
+
+	do_gettimeofday(&now);
+
+	previous = lm629->Sample;
+
+	lm629->Sample.position = (__s32) position;
+	lm629->Sample.velocity = (__s32) velocity;
+	lm629->Sample.tv_sec = now.tv_sec;
+	lm629->Sample.tv_usec = now.tv_usec;
+
+	servo_log_sample(channel, status, &now);
+
+	servo_gain_schedule(channel, &previous);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |static long servo_gain_value(struct LM629_Gain *gain,                |
+ |                             struct LM629_Sample *sample)            |
+ +--------------------------------------------------------------------*/
+static long servo_gain_value(struct LM629_Gain *gain,
+							 struct LM629_Sample *sample)
+{
+	if (gain->trigger == LM629_GAIN_POSITION)
+		return sample->position;
+
+	return sample->velocity < 0 ? -sample->velocity : sample->velocity;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_gain_matches(struct LM629_Gain *gain,               |
+ |                              struct LM629_Sample *sample)           |
+ +--------------------------------------------------------------------*/
+static int servo_gain_matches(struct LM629_Gain *gain,
+							  struct LM629_Sample *sample)
+{
+	long value;
+
+	value = servo_gain_value(gain, sample);
+
+	return value >= gain->low && value < gain->high;
+}
+
+/*---------------------------------------------------------------------+
+ |static void servo_gain_schedule(int channel,                         |
+ |                                struct LM629_Sample *previous)       |
+ |                                                                     |
+ | Switches to the first schedule entry whose band the new sample is   |
+ | in, unless the entry in force still matches. The switch is LFIL +   |
+ | UDF, or just UDF when the entry was already preloaded: after every  |
+ | sample the neighbouring entry the velocity or position is heading   |
+ | towards is preloaded, so entries should be in ascending band order. |
+ | Nothing is switched or preloaded while a filter the user loaded is  |
+ | waiting for its UDF.                                                |
+ +--------------------------------------------------------------------*/
+static void servo_gain_schedule(int channel, struct LM629_Sample *previous)
+{
+	struct LM629 *lm629;
+	struct LM629_Gain_Schedule *schedule;
+	struct LM629_Gain_Status *status;
+	struct LM629_Filter *filter;
+	struct timeval now;
+	int i, next;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+	schedule = &lm629->GainSchedule;
+	status = &lm629->GainStatus;
+
+	if (!schedule->count)
+		return;
+
+	/* A filter the user preloaded waits for the user's UDF */
+	if (lm629->filter_pending && !lm629->filter_scheduled)
+		return;
+
+	i = status->active;
+
+	if (i < 0 || !servo_gain_matches(&schedule->gain[i], &lm629->Sample))
+	{
+		for (i = 0; i < schedule->count; i++)
+			if (servo_gain_matches(&schedule->gain[i], &lm629->Sample))
+				break;
+
+		if (i == schedule->count)
+			return;
+
+		if (schedule->gain[i].filter >= lm629->filter_count)
+			return;
+
+		filter = &lm629->FilterTable[schedule->gain[i].filter];
+
+		if (lm629->filter_pending && lm629->NewFilter == filter)
+			status->preloaded++;
+		else
+		{
+			lm629->NewFilter = filter;
+			if (load_filter(&servo, channel) < 0)
+				return;
+			lm629->filter_scheduled = TRUE;
+		}
+
+		if (update_filter(&servo, channel) < 0)
+			return;
+
+		do_gettimeofday(&now);
+
+		status->active = i;
+		status->switches++;
+		status->tv_sec = now.tv_sec;
+		status->tv_usec = now.tv_usec;
+	}
+
+	if (servo_gain_value(&schedule->gain[i], &lm629->Sample) >=
+		servo_gain_value(&schedule->gain[i], previous))
+		next = i + 1;
+	else
+		next = i - 1;
+
+	if (next < 0 || next >= schedule->count)
+		return;
+
+	if (schedule->gain[next].filter >= lm629->filter_count)
+		return;
+
+	filter = &lm629->FilterTable[schedule->gain[next].filter];
+
+	if (lm629->filter_pending && lm629->NewFilter == filter)
+		return;
+
+	lm629->NewFilter = filter;
+	if (load_filter(&servo, channel) == 0)
+		lm629->filter_scheduled = TRUE;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_set_gain_schedule(int channel,                      |
+ |                                   struct LM629_Gain_Schedule *arg)  |
+ +--------------------------------------------------------------------*/
+static int servo_set_gain_schedule(int channel, struct LM629_Gain_Schedule *arg)
+{
+	struct LM629 *lm629;
+	struct LM629_Gain_Schedule schedule;
+	int i;
+
+	LG(TRACE,
+	   "static int servo_set_gain_schedule(int channel, struct LM629_Gain_Schedule *arg)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	if (copy_from_user(&schedule, arg, sizeof (schedule)))
+		return -EFAULT;
+
+	if (schedule.count > LM629_MAX_GAINS)
+		return -EINVAL;
+
+	for (i = 0; i < schedule.count; i++)
+	{
+		if (schedule.gain[i].trigger != LM629_GAIN_VELOCITY &&
+			schedule.gain[i].trigger != LM629_GAIN_POSITION)
+			return -EINVAL;
+
+		if (schedule.gain[i].low >= schedule.gain[i].high)
+			return -EINVAL;
+
+		if (schedule.gain[i].filter >= lm629->filter_count)
+			return -EINVAL;
+	}
+
+	lm629->GainSchedule = schedule;
+	lm629->GainStatus.active = -1;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    Bus locks                                                        |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |    static int servo_minor_channels(int minor)                       |
+ |                                                                     |
+ |    The LM629s a minor device talks to, as a channel mask.           |
+ +--------------------------------------------------------------------*/
+static int servo_minor_channels(int minor)
+{
+	switch (minor)
+	{
+	case BOARD:
+		return 3;
+
+	case CHANNEL_0:
+	case FILTER_0:
+	case TRAJECTORY_0:
+		return 1;
+
+	case CHANNEL_1:
+	case FILTER_1:
+	case TRAJECTORY_1:
+		return 2;
+
+	default:
+		return 0;
+	};
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_ioctl_channels(int minor, unsigned int ioctl_num)   |
+ |                                                                     |
+ |    The bus locks an ioctl() needs. Those that only touch state with |
+ |    a lock of its own need none, and so never wait for the LM629s.   |
+ +--------------------------------------------------------------------*/
+static int servo_ioctl_channels(int minor, unsigned int ioctl_num)
+{
+	switch (ioctl_num)
+	{
+	case SERVO_GET_POSE:
+	case SERVO_SET_POSE:
+	case SERVO_GET_ODOMETRY:
+	case SERVO_SET_ODOMETRY:
+	case SERVO_SET_SUBSCRIPTION:
+	case SERVO_GET_SUBSCRIPTION:
+		return 0;
+
+	default:
+		return servo_minor_channels(minor);
+	};
+}
+
+/*---------------------------------------------------------------------+
+ |    static void servo_locked(int channel, int contended)             |
+ +--------------------------------------------------------------------*/
+static void servo_locked(int channel, int contended)
+{
+	struct servo_lock_stats *stats = &servo_lock_stats[channel];
+
+	stats->acquired++;
+	if (contended)
+		stats->contended++;
+	stats->since = get_cycles();
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_lock(int channels)                              |
+ |                                                                     |
+ |    Takes the bus locks of the channels in the mask, channel 0       |
+ |    first. Returns -ERESTARTSYS, holding none, on a signal.          |
+ +--------------------------------------------------------------------*/
+static int servo_lock(int channels)
+{
+	int channel, contended;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		if (!(channels & (1 << channel)))
+			continue;
+
+		contended = down_trylock(&servo_bus[channel]) != 0;
+		if (contended && down_interruptible(&servo_bus[channel]))
+		{
+			servo_unlock(channels & ((1 << channel) - 1));
+			return -ERESTARTSYS;
+		}
+
+		servo_locked(channel, contended);
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static void servo_lock_wait(int channels)                        |
+ |                                                                     |
+ |    The same, for callers that cannot back out.                      |
+ +--------------------------------------------------------------------*/
+static void servo_lock_wait(int channels)
+{
+	int channel, contended;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		if (!(channels & (1 << channel)))
+			continue;
+
+		contended = down_trylock(&servo_bus[channel]) != 0;
+		if (contended)
+			down(&servo_bus[channel]);
+
+		servo_locked(channel, contended);
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_trylock(int channel)                            |
+ |                                                                     |
+ |    For the sampler, which counts a busy lock as a skipped sample.   |
+ +--------------------------------------------------------------------*/
+static int servo_trylock(int channel)
+{
+	if (down_trylock(&servo_bus[channel]))
+	{
+		servo_lock_stats[channel].skipped++;
+		return 0;
+	}
+
+	servo_locked(channel, 0);
+
+	return 1;
+}
+
+/*---------------------------------------------------------------------+
+ |    static void servo_unlock(int channels)                           |
+ +--------------------------------------------------------------------*/
+static void servo_unlock(int channels)
+{
+	struct servo_lock_stats *stats;
+	cycles_t held;
+	int channel;
+
+	for (channel = 1; channel >= 0; channel--)
+	{
+		if (!(channels & (1 << channel)))
+			continue;
+
+		stats = &servo_lock_stats[channel];
+		held = get_cycles() - stats->since;
+		stats->held += held;
+		if (held > stats->held_max)
+			stats->held_max = held;
+
+		up(&servo_bus[channel]);
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |    static unsigned long servo_cycles_to_us(cycles_t cycles)         |
+ +--------------------------------------------------------------------*/
+static unsigned long servo_cycles_to_us(cycles_t cycles)
+{
+	u64 us;
+
+	if (!cpu_khz)
+		return 0;
+
+	us = (u64) cycles * 1000;
+	do_div(us, cpu_khz);
+
+	return (unsigned long) us;
+}
+
+/*---------------------------------------------------------------------+
+ |static void servo_copy_filter(int channel,                           |
+ |                              struct LM629_Filter *filter)           |
+ |                                                                     |
+ |    These copy model state for readers that take no bus lock.        |
+ +--------------------------------------------------------------------*/
+static void servo_copy_filter(int channel, struct LM629_Filter *filter)
+{
+	struct LM629 *lm629;
+	unsigned int seq;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	do
+	{
+		seq = model_read_begin(lm629);
+		*filter = *lm629->Filter;
+	}
+	while (model_read_retry(lm629, seq));
+}
+
+/*---------------------------------------------------------------------+
+ |static void servo_copy_trajectory(int channel,                       |
+ |                                  struct LM629_Trajectory *trajectory)|
+ +--------------------------------------------------------------------*/
+static void servo_copy_trajectory(int channel,
+								  struct LM629_Trajectory *trajectory)
+{
+	struct LM629 *lm629;
+	unsigned int seq;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	do
+	{
+		seq = model_read_begin(lm629);
+		*trajectory = *lm629->Trajectory;
+	}
+	while (model_read_retry(lm629, seq));
+}
+
+/*---------------------------------------------------------------------+
+ |static void servo_copy_position(int channel, __s64 *position,        |
+ |                                unsigned int *wraps)                 |
+ +--------------------------------------------------------------------*/
+static void servo_copy_position(int channel, __s64 * position,
+								unsigned int *wraps)
+{
+	struct LM629 *lm629;
+	unsigned int seq;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	do
+	{
+		seq = model_read_begin(lm629);
+		*position = lm629->position64;
+		*wraps = lm629->wraps;
+	}
+	while (model_read_retry(lm629, seq));
+}
+
+/*---------------------------------------------------------------------+
+ |    Extended position and LM629 interrupts                           |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |static void servo_extend_position(struct LM629 *lm629, long position)|
+ |                                                                     |
+ | Accumulates the 32 bit LM629 position into a 64 bit count. The      |
+ | delta is taken modulo 2^32, so this is right as long as the axis    |
+ | moves less than 2^31 counts between two reads.                      |
+ +--------------------------------------------------------------------*/
+static void servo_extend_position(struct LM629 *lm629, long position)
+{
+	model_write_begin(lm629);
+
+	if (!lm629->position_primed)
+	{
+		lm629->position64 = (__s32) position;
+		lm629->position_primed = TRUE;
+	}
+	else
+		lm629->position64 += (__s32) ((__s32) position - lm629->position_raw);
+
+	lm629->position_raw = (__s32) position;
+
+	model_write_end(lm629);
+}
+
+/*---------------------------------------------------------------------+
+ |static void servo_handle_status(int channel, int status,             |
+ |                                struct timeval *seen)                |
+ |                                                                     |
+ |    Acts on the LM629 status byte, from the sampler or the IRQ task. |
+ |    A wrap-around gets an immediate position read so the 64 bit      |
+ |    count does not depend on the sample rate. An index pulse is only |
+ |    flagged after SIP, and wakes the homing sequence. seen is when   |
+ |    the interrupt came in, NULL when polled. Needs only the bus lock |
+ |    of the channel, so a position error just brakes here; whoever    |
+ |    holds both locks calls servo_fault_stop() afterwards.            |
+ +--------------------------------------------------------------------*/
+static void servo_handle_status(int channel, int status, struct timeval *seen)
+{
+	struct LM629 *lm629;
+	long position;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	if (status & POSITION_ERROR)
+	{
+		servo_fault_brake(channel, ANDI_FAULT_POLLED, get_cycles());
+		reset_interrupts(&servo, channel, POSITION_ERROR_INTERRUPT);
+	}
+
+	if (status & INDEX_PULSE)
+	{
+		lm629->index_seen = TRUE;
+		reset_interrupts(&servo, channel, INDEX_PULSE_INTERRUPT);
+		wake_up_interruptible(&servo_wait);
+	}
+
+	if (status & WRAP_AROUND)
+	{
+		model_write_begin(lm629);
+		lm629->wraps++;
+		model_write_end(lm629);
+
+		if (get_real_position(&servo, channel, &position) == 0)
+			servo_extend_position(lm629, position);
+
+		reset_interrupts(&servo, channel, WRAP_AROUND_INTERRUPT);
+	}
+
+	if (status & TRAJECTORY_COMPLETE)
+	{
+		reset_interrupts(&servo, channel, TRAJECTORY_COMPLETE_INTERRUPT);
+		servo_trajectory_done(channel, seen);
+	}
+
+	/* The rest are only logged, but must be reset to be seen again */
+	if (status & BREAKPOINT_REACHED)
+		reset_interrupts(&servo, channel, BREAKPOINT_INTERRUPT);
+	if (status & COMMAND_ERROR)
+	{
+		BUS_CHANNEL(channel).command_errors++;
+		reset_interrupts(&servo, channel, COMMAND_ERROR_INTERRUPT);
+	}
+
+	if (status & SERVO_EVENT_BITS)
+	{
+		if (!(status & WRAP_AROUND) &&
+			get_real_position(&servo, channel, &position) == 0)
+			servo_extend_position(lm629, position);
+
+		servo_log_event(channel, status, seen);
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_get_position64(int channel,                         |
+ |                                struct LM629_Position *arg)          |
+ +--------------------------------------------------------------------*/
+static int servo_get_position64(int channel, struct LM629_Position *arg)
+{
+	struct LM629 *lm629;
+	struct LM629_Position position;
+	struct timeval now;
+	long raw;
+	int retval;
+
+	LG(TRACE,
+	   "static int servo_get_position64(int channel, struct LM629_Position *arg)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	retval = get_real_position(&servo, channel, &raw);
+	if (retval < 0)
+		return retval;
+
+	do_gettimeofday(&now);
+
+	servo_extend_position(lm629, raw);
+
+	position.position = lm629->position64;
+	position.wraps = lm629->wraps;
+	position.tv_sec = now.tv_sec;
+	position.tv_usec = now.tv_usec;
+
+	if (copy_to_user(arg, &position, sizeof (position)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |static void servo_interrupt(int irq, void *dev_id,                   |
+ |                            struct pt_regs *regs)                    |
+ +--------------------------------------------------------------------*/
+static void servo_interrupt(int irq, void *dev_id, struct pt_regs *regs)
+{
+	struct andi_servo *board = (struct andi_servo *) dev_id;
+	cycles_t seen;
+	int cause, channel;
+
+	seen = get_cycles();
+
+	cause = bus_inb(board->base_address + IRQCAUSE);
+	bus_inb(board->base_address + CLEARIRQ);
+	BUS_BOARD.board_reads += 2;
+
+	TRACE_POINT(TP_IRQ, TP_BOARD, cause, 0, 0, 0);
+
+	/*
+	 * The status byte can be read at any time without upsetting a
+	 * command in progress, so a position error is braked here and
+	 * now; the LM629 stop commands follow from the task.
+	 */
+	if (cause & CHANNEL0_LM629_IRQ)
+	{
+		BUS_CHANNEL(0).port_reads++;
+		if (bus_inb(board->base_address + COMMAND_0) & POSITION_ERROR)
+			servo_fault_brake(0, ANDI_FAULT_IRQ, seen);
+		set_bit(0, &servo_irq_pending);
+	}
+	if (cause & CHANNEL1_LM629_IRQ)
+	{
+		BUS_CHANNEL(1).port_reads++;
+		if (bus_inb(board->base_address + COMMAND_1) & POSITION_ERROR)
+			servo_fault_brake(1, ANDI_FAULT_IRQ, seen);
+		set_bit(1, &servo_irq_pending);
+	}
+
+	/* Moves are timed from here, not from when the task gets to run */
+	for (channel = 0; channel < 2; channel++)
+		if ((cause & (channel ? CHANNEL1_LM629_IRQ : CHANNEL0_LM629_IRQ)) &&
+			!test_and_set_bit(channel, &servo_irq_stamped))
+			do_gettimeofday(&servo_irq_stamp[channel]);
+
+	if (cause & CHANNEL0_THERMAL_IRQ)
+		servo_thermal(0, seen);
+	if (cause & CHANNEL1_THERMAL_IRQ)
+		servo_thermal(1, seen);
+
+	if (cause & (CHANNEL0_LM629_IRQ | CHANNEL1_LM629_IRQ))
+		schedule_task(&servo_irq_task);
+}
+
+/*---------------------------------------------------------------------+
+ |    static void servo_irq_bh(void *data)                             |
+ +--------------------------------------------------------------------*/
+static void servo_irq_bh(void *data)
+{
+	struct timeval stamp;
+	int channel, status;
+
+	servo_lock_wait(3);
+
+	for (channel = 0; channel < 2; channel++)
+		if (test_and_clear_bit(channel, &servo_irq_pending))
+		{
+			stamp = servo_irq_stamp[channel];
+			clear_bit(channel, &servo_irq_stamped);
+
+			if (get_status(&servo, channel, &status) == 0)
+				servo_handle_status(channel, status, &stamp);
+		}
+
+	servo_fault_stop();
+
+	servo_unlock(3);
+}
+
+/*---------------------------------------------------------------------+
+ |    Homing                                                           |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |    static int servo_define_home(int channel, long offset)           |
+ |                                                                     |
+ |    DFH, and restarts the 64 bit count at offset. The dead reckoning |
+ |    is told that the counters moved under it.                        |
+ +--------------------------------------------------------------------*/
+static int servo_define_home(int channel, long offset)
+{
+	struct LM629 *lm629;
+	int retval;
+
+	LG(TRACE, "static int servo_define_home(int channel, long offset)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	retval = define_home(&servo, channel);
+	if (retval < 0)
+		return retval;
+
+	model_write_begin(lm629);
+	lm629->position64 = offset;
+	lm629->position_raw = 0;
+	lm629->position_primed = TRUE;
+	model_write_end(lm629);
+
+	spin_lock_bh(&odometry_lock);
+	odometry_restart(&odometry);
+	spin_unlock_bh(&odometry_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_home_start(int channel, struct ANDI_Home *home) |
+ |                                                                     |
+ |    Starts the search move and arms index capture with SIP.          |
+ +--------------------------------------------------------------------*/
+static int servo_home_start(int channel, struct ANDI_Home *home)
+{
+	struct LM629 *lm629;
+	struct LM629_Trajectory *trajectory;
+	int retval, irq_mask;
+
+	LG(TRACE,
+	   "static int servo_home_start(int channel, struct ANDI_Home *home)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+	trajectory = &home_trajectory[channel];
+
+	memset(trajectory, 0, sizeof (*trajectory));
+	trajectory->velocity_mode = TRUE;
+	trajectory->forward_dir = home->velocity > 0;
+	trajectory->load_acc = TRUE;
+	trajectory->load_vel = TRUE;
+	trajectory->acc = home->acc;
+	trajectory->velocity =
+		home->velocity > 0 ? home->velocity : -home->velocity;
+
+	lm629->index_seen = FALSE;
+
+	retval = reset_interrupts(&servo, channel, INDEX_PULSE_INTERRUPT);
+	if (retval < 0)
+		return retval;
+
+	if (irq > 0)
+	{
+		irq_mask = lm629->irq_mask | I_ENA_INDEX;
+		retval = set_irq_mask(&servo, channel, &irq_mask);
+		if (retval < 0)
+			return retval;
+	}
+
+	lm629->NewTrajectory = trajectory;
+
+	retval = load_trajectory(&servo, channel);
+	if (retval < 0)
+		return retval;
+
+	retval = start_trajectory(&servo, channel);
+	if (retval < 0)
+		return retval;
+
+	return set_index_position(&servo, channel);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_home_stop(int channel)                          |
+ +--------------------------------------------------------------------*/
+static int servo_home_stop(int channel)
+{
+	struct LM629 *lm629;
+	int retval, irq_mask;
+
+	LG(TRACE, "static int servo_home_stop(int channel)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	lm629->NewTrajectory = &stop_trajectory[channel];
+
+	retval = load_trajectory(&servo, channel);
+	if (retval < 0)
+		return retval;
+
+	retval = start_trajectory(&servo, channel);
+	if (retval < 0)
+		return retval;
+
+	if (irq > 0)
+	{
+		irq_mask = lm629->irq_mask & ~I_ENA_INDEX;
+		retval = set_irq_mask(&servo, channel, &irq_mask);
+	}
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_home_return(int channel, struct ANDI_Home *home)    |
+ |                                                                     |
+ |  Stops the search, reads the index position SIP captured and starts |
+ |  a position mode move back to it at the search's speed.             |
+ +--------------------------------------------------------------------*/
+static int servo_home_return(int channel, struct ANDI_Home *home)
+{
+	struct LM629 *lm629;
+	struct LM629_Trajectory *trajectory;
+	long index;
+	int retval;
+
+	LG(TRACE,
+	   "static int servo_home_return(int channel, struct ANDI_Home *home)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+	trajectory = &home_trajectory[channel];
+
+	retval = servo_home_stop(channel);
+	if (retval < 0)
+		return retval;
+
+	retval = get_index_position(&servo, channel, &index);
+	if (retval < 0)
+		return retval;
+
+	home->index[channel] = (__s32) index;
+
+	memset(trajectory, 0, sizeof (*trajectory));
+	trajectory->load_acc = TRUE;
+	trajectory->load_vel = TRUE;
+	trajectory->load_pos = TRUE;
+	trajectory->acc = home->acc;
+	trajectory->velocity =
+		home->velocity > 0 ? home->velocity : -home->velocity;
+	trajectory->position = (__s32) index;
+
+	/* The complete bit is sticky, so clear what the search left */
+	retval = reset_interrupts(&servo, channel, TRAJECTORY_COMPLETE_INTERRUPT);
+	if (retval < 0)
+		return retval;
+
+	lm629->trajectory_complete = FALSE;
+	lm629->NewTrajectory = trajectory;
+
+	retval = load_trajectory(&servo, channel);
+	if (retval < 0)
+		return retval;
+
+	return start_trajectory(&servo, channel);
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_home_finish(int channel, struct ANDI_Home *home)    |
+ |                                                                     |
+ |  The axis is standing on the index: DFH there, and the 64 bit count |
+ |  starts from 0 with it, so that absolute trajectories, RDRP and the |
+ |  64 bit position all have the index as 0.                           |
+ +--------------------------------------------------------------------*/
+static int servo_home_finish(int channel, struct ANDI_Home *home)
+{
+	int retval;
+
+	LG(TRACE,
+	   "static int servo_home_finish(int channel, struct ANDI_Home *home)\n");
+
+	retval = servo_define_home(channel, 0);
+	if (retval < 0)
+		return retval;
+
+	home->homed |= 1 << channel;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_home(struct ANDI_Home *arg)                     |
+ |                                                                     |
+ |    Homes the requested channels together: search move, SIP, wait    |
+ |    for the index pulse, stop, RDIP, move back to the index, wait    |
+ |    for the move to complete and DFH. The index pulse is picked up   |
+ |    by the IRQ task, or by polling the status byte every jiffy when  |
+ |    the driver has no IRQ; the return move is always polled. The bus |
+ |    locks are dropped while waiting so that they can run. Any axis   |
+ |    still searching or returning at the timeout or on a signal is    |
+ |    stopped.                                                         |
+ +--------------------------------------------------------------------*/
+static int servo_home(struct ANDI_Home *arg)
+{
+	DECLARE_WAITQUEUE(wait, current);
+	struct ANDI_Home home;
+	struct timeval start, end;
+	unsigned long deadline;
+	struct LM629 *lm629;
+	long remaining;
+	int channel, pending, returning, status, retval;
+
+	LG(TRACE, "static int servo_home(struct ANDI_Home *arg)\n");
+
+	if (copy_from_user(&home, arg, sizeof (home)))
+		return -EFAULT;
+
+	if (!home.channels || (home.channels & ~3))
+		return -EINVAL;
+	if (!home.velocity || home.velocity > LM629_MAXRANGE ||
+		home.velocity < -LM629_MAXRANGE)
+		return -EINVAL;
+	if (home.acc > LM629_MAXRANGE)
+		return -EINVAL;
+	if (!home.timeout_ms || home.timeout_ms > 60000)
+		return -EINVAL;
+
+	home.homed = 0;
+	home.index[0] = home.index[1] = 0;
+	retval = servo_lock(3);
+	if (retval < 0)
+		return retval;
+
+	do_gettimeofday(&start);
+	deadline = jiffies + (home.timeout_ms * HZ + 999) / 1000;
+
+	pending = returning = 0;
+	for (channel = 0; channel < 2; channel++)
+		if (home.channels & (1 << channel))
+		{
+			retval = servo_home_start(channel, &home);
+			if (retval < 0)
+				break;
+			pending |= 1 << channel;
+		}
+
+	servo_unlock(3);
+
+	add_wait_queue(&servo_wait, &wait);
+
+	while (retval == 0)
+	{
+		servo_lock_wait(3);
+
+		for (channel = 0; channel < 2; channel++)
+		{
+			if (!((pending | returning) & (1 << channel)))
+				continue;
+
+			lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+			if ((irq <= 0 || (returning & (1 << channel))) &&
+				get_status(&servo, channel, &status) == 0)
+				servo_handle_status(channel, status, NULL);
+
+			if ((pending & (1 << channel)) && lm629->index_seen)
+			{
+				pending &= ~(1 << channel);
+				returning |= 1 << channel;
+				retval = servo_home_return(channel, &home);
+				if (retval < 0)
+					break;
+			}
+			else if ((returning & (1 << channel)) &&
+					 lm629->trajectory_complete)
+			{
+				returning &= ~(1 << channel);
+				retval = servo_home_finish(channel, &home);
+				if (retval < 0)
+					break;
+			}
+		}
+
+		servo_fault_stop();
+
+		servo_unlock(3);
+
+		if (!(pending | returning) || retval < 0)
+			break;
+
+		if (signal_pending(current))
+		{
+			retval = -EINTR;
+			break;
+		}
+
+		remaining = (long) (deadline - jiffies);
+		if (remaining <= 0)
+		{
+			retval = -ETIMEDOUT;
+			break;
+		}
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!((pending & 1) && servo.Channel0->index_seen) &&
+			!((pending & 2) && servo.Channel1->index_seen))
+			schedule_timeout(irq > 0 && !returning ? remaining : 1);
+		set_current_state(TASK_RUNNING);
+	}
+
+	remove_wait_queue(&servo_wait, &wait);
+
+	servo_lock_wait(3);
+
+	for (channel = 0; channel < 2; channel++)
+		if ((pending | returning) & (1 << channel))
+			servo_home_stop(channel);
+
+	do_gettimeofday(&end);
+
+	servo_unlock(3);
+
+	home.elapsed_us = (end.tv_sec - start.tv_sec) * 1000000 +
+		(end.tv_usec - start.tv_usec);
+
+	if (copy_to_user(arg, &home, sizeof (home)))
+		return -EFAULT;
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------+
+ |    Trajectory completion                                            |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |static void servo_trajectory_done(int channel, struct timeval *seen) |
+ |                                                                     |
+ |    The LM629 says the move started by SERVO_START_TRAJECTORY is     |
+ |    over. Times it and wakes SERVO_WAIT_TRAJECTORY.                  |
+ +--------------------------------------------------------------------*/
+static void servo_trajectory_done(int channel, struct timeval *seen)
+{
+	struct LM629 *lm629;
+	struct timeval now;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	if (lm629->trajectory_complete)
+		return;
+
+	if (!seen)
+	{
+		do_gettimeofday(&now);
+		seen = &now;
+	}
+
+	lm629->Move.done_sec = seen->tv_sec;
+	lm629->Move.done_usec = seen->tv_usec;
+	lm629->Move.duration_us =
+		(seen->tv_sec - lm629->Move.start_sec) * 1000000 +
+		(seen->tv_usec - lm629->Move.start_usec);
+	lm629->trajectory_complete = TRUE;
+
+	servo_notify();
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_trajectory_mask(void)                           |
+ +--------------------------------------------------------------------*/
+static int servo_trajectory_mask(void)
+{
+	return (servo.Channel0->trajectory_complete ? 1 : 0) |
+		(servo.Channel1->trajectory_complete ? 2 : 0);
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_wait_trajectory(int channels, struct ANDI_Wait *arg)|
+ |                                                                     |
+ |    Sleeps until one or all of the channels have completed their     |
+ |    trajectory. channels is 0 on the board minor, where the caller   |
+ |    picks them, and the one channel of a trajectory minor. Like      |
+ |    homing it must not sleep holding the bus locks; with neither IRQ |
+ |    nor sampler it polls the status once a jiffy.                    |
+ +--------------------------------------------------------------------*/
+static int servo_wait_trajectory(int channels, struct ANDI_Wait *arg)
+{
+	DECLARE_WAITQUEUE(wait, current);
+	struct ANDI_Wait request;
+	unsigned long deadline;
+	long remaining;
+	int channel, complete, status, polled, retval;
+
+	LG(TRACE,
+	   "static int servo_wait_trajectory(int channels, struct ANDI_Wait *arg)\n");
+
+	if (copy_from_user(&request, arg, sizeof (request)))
+		return -EFAULT;
+
+	if (channels)
+		request.channels = channels;
+
+	if (!request.channels || (request.channels & ~3))
+		return -EINVAL;
+	if (request.mode != ANDI_WAIT_ANY && request.mode != ANDI_WAIT_ALL)
+		return -EINVAL;
+	if (request.timeout_ms > 3600000)
+		return -EINVAL;
+
+	deadline = jiffies + (request.timeout_ms * HZ + 999) / 1000;
+	polled = irq <= 0 && sample_ticks <= 0;
+	retval = 0;
+
+	add_wait_queue(&servo_wait, &wait);
+
+	for (;;)
+	{
+		if (polled)
+		{
+			servo_lock_wait(3);
+			for (channel = 0; channel < 2; channel++)
+				if (request.channels & (1 << channel))
+					if (get_status(&servo, channel, &status) == 0)
+						servo_handle_status(channel, status, NULL);
+			servo_fault_stop();
+			servo_unlock(3);
+		}
+
+		set_current_state(TASK_INTERRUPTIBLE);
+
+		complete = servo_trajectory_mask() & request.channels;
+		if (request.mode == ANDI_WAIT_ALL ? complete == request.channels :
+			complete != 0)
+			break;
+
+		if (signal_pending(current))
+		{
+			retval = -EINTR;
+			break;
+		}
+
+		if (request.timeout_ms)
+		{
+			remaining = (long) (deadline - jiffies);
+			if (remaining <= 0)
+			{
+				retval = -ETIMEDOUT;
+				break;
+			}
+		}
+		else
+			remaining = MAX_SCHEDULE_TIMEOUT;
+
+		schedule_timeout(polled ? 1 : remaining);
+	}
+
+	set_current_state(TASK_RUNNING);
+	remove_wait_queue(&servo_wait, &wait);
+
+	servo_lock_wait(3);
+
+	request.complete = servo_trajectory_mask() & request.channels;
+	request.move[0] = servo.Channel0->Move;
+	request.move[1] = servo.Channel1->Move;
+
+	servo_unlock(3);
+
+	if (copy_to_user(arg, &request, sizeof (request)))
+		return -EFAULT;
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------+
+ |    Event log                                                        |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |static void servo_log_event(int channel, int status,                 |
+ |                            struct timeval *seen)                    |
+ |                                                                     |
+ |    Appends to the channel's event ring, overwriting the oldest      |
+ |    record when it is full, and wakes the clients subscribed to it.  |
+ +--------------------------------------------------------------------*/
+static void servo_log_event(int channel, int status, struct timeval *seen)
+{
+	struct LM629 *lm629;
+	struct LM629_Event *event;
+	struct timeval now;
+	unsigned int seq;
+	int woken;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	if (!seen)
+		do_gettimeofday(&now);
+
+	spin_lock_bh(&event_lock);
+
+	event = &lm629->Events[lm629->event_head % SERVO_EVENTS];
+	event->seq = lm629->event_head;
+	event->channel = channel;
+	event->status = status;
+	event->source = seen ? ANDI_FAULT_IRQ : ANDI_FAULT_POLLED;
+	event->reserved = 0;
+	event->tv_sec = seen ? seen->tv_sec : now.tv_sec;
+	event->tv_usec = seen ? seen->tv_usec : now.tv_usec;
+	event->position = lm629->position64;
+	seq = lm629->event_head++;
+
+	spin_unlock_bh(&event_lock);
+
+	woken = servo_wake_clients(channel, status);
+
+	TRACE_POINT(TP_EVENT, channel, status, seq, woken, 0);
+}
+
+/*---------------------------------------------------------------------+
+ |static void servo_log_sample(int channel, int status,                |
+ |                             struct timeval *now)                    |
+ |                                                                     |
+ |    Called by the sampler. Keeps the latest sample as a telemetry    |
+ |    record and wakes the clients it is due for.                      |
+ +--------------------------------------------------------------------*/
+static void servo_log_sample(int channel, int status, struct timeval *now)
+{
+	struct LM629 *lm629;
+	struct LM629_Event *sample;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	spin_lock_bh(&event_lock);
+
+	sample = &lm629->Telemetry;
+	sample->seq++;
+	sample->channel = channel;
+	sample->status = status;
+	sample->source = ANDI_EVENT_SAMPLE;
+	sample->reserved = 0;
+	sample->tv_sec = now->tv_sec;
+	sample->tv_usec = now->tv_usec;
+	sample->position = lm629->position64;
+
+	spin_unlock_bh(&event_lock);
+
+	servo_wake_clients(channel, 0);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_wake_clients(int channel, int status)           |
+ |                                                                     |
+ |    Wakes the clients of a channel file that subscribed to one of    |
+ |    the status bits, or when status is 0, that a telemetry record    |
+ |    is due for. Returns how many were woken.                         |
+ +--------------------------------------------------------------------*/
+static int servo_wake_clients(int channel, int status)
+{
+	struct list_head *entry;
+	struct servo_client *client;
+	unsigned int seq;
+	int woken = 0;
+
+	seq = (channel ? servo.Channel1 : servo.Channel0)->Telemetry.seq;
+
+	spin_lock_bh(&client_lock);
+
+	list_for_each(entry, &servo_clients)
+	{
+		client = list_entry(entry, struct servo_client, list);
+
+		if (client->channel != channel)
+			continue;
+
+		if (status ? (client->events & status) :
+			(client->decimation &&
+			 seq - client->sample_seen >= client->decimation))
+		{
+			wake_up_interruptible(&client->wait);
+			woken++;
+		}
+	}
+
+	spin_unlock_bh(&client_lock);
+
+	return woken;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_client_next(struct servo_client *client,            |
+ |                             struct LM629_Event *event)              |
+ |                                                                     |
+ |    Takes the next record for a client: the oldest subscribed event  |
+ |    not yet read, else a telemetry record if one is due. Returns 0   |
+ |    when there is nothing, and only looks when event is NULL.        |
+ |    client->cursor is the seq of the next event to read; a client    |
+ |    that has been overtaken is moved on to the oldest event left.    |
+ +--------------------------------------------------------------------*/
+static int servo_client_next(struct servo_client *client,
+							 struct LM629_Event *event)
+{
+	struct LM629 *lm629;
+	struct LM629_Event *next;
+	int found;
+
+	if (client->channel < 0)
+		return 0;
+
+	lm629 = client->channel ? servo.Channel1 : servo.Channel0;
+	found = 0;
+
+	spin_lock_bh(&event_lock);
+
+	if (lm629->event_head - client->cursor > SERVO_EVENTS)
+		client->cursor = lm629->event_head - SERVO_EVENTS;
+
+	while (client->cursor != lm629->event_head)
+	{
+		next = &lm629->Events[client->cursor % SERVO_EVENTS];
+		if (next->status & client->events)
+		{
+			found = 1;
+			if (event)
+			{
+				*event = *next;
+				client->cursor++;
+			}
+			break;
+		}
+		client->cursor++;
+	}
+
+	if (!found && client->decimation &&
+		lm629->Telemetry.seq - client->sample_seen >= client->decimation)
+	{
+		found = 1;
+		if (event)
+		{
+			*event = lm629->Telemetry;
+			client->sample_seen = lm629->Telemetry.seq;
+		}
+	}
+
+	spin_unlock_bh(&event_lock);
+
+	return found;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_client_ready(struct servo_client *client)       |
+ +--------------------------------------------------------------------*/
+static int servo_client_ready(struct servo_client *client)
+{
+	return servo_client_next(client, NULL);
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_read_events(struct servo_client *client,            |
+ |                             struct file *file, char *buffer,        |
+ |                             size_t length)                          |
+ |                                                                     |
+ |    Copies out as many whole struct LM629_Event as fit in length.    |
+ |    Sleeps for the first one unless the file is O_NONBLOCK. Each     |
+ |    open file has its own cursor and subscription, so any number of  |
+ |    readers can follow the log.                                      |
+ +--------------------------------------------------------------------*/
+static int servo_read_events(struct servo_client *client, struct file *file,
+							 char *buffer, size_t length)
+{
+	DECLARE_WAITQUEUE(wait, current);
+	struct LM629_Event event;
+	int count, retval;
+
+	LG(TRACE,
+	   "static int servo_read_events(struct servo_client *client, struct file *file, char *buffer, size_t length)\n");
+
+	if (length < sizeof (struct LM629_Event))
+		return -EINVAL;
+
+	retval = 0;
+
+	add_wait_queue(&client->wait, &wait);
+
+	for (;;)
+	{
+		set_current_state(TASK_INTERRUPTIBLE);
+
+		if (servo_client_ready(client))
+			break;
+
+		if (file->f_flags & O_NONBLOCK)
+		{
+			retval = -EAGAIN;
+			break;
+		}
+
+		if (signal_pending(current))
+		{
+			retval = -ERESTARTSYS;
+			break;
+		}
+
+		schedule();
+	}
+
+	set_current_state(TASK_RUNNING);
+	remove_wait_queue(&client->wait, &wait);
+
+	if (retval < 0)
+		return retval;
+
+	count = 0;
+	while (length >= sizeof (event) && servo_client_next(client, &event))
+	{
+		if (copy_to_user(buffer, &event, sizeof (event)))
+			return count ? count * sizeof (event) : -EFAULT;
+
+		buffer += sizeof (event);
+		length -= sizeof (event);
+		count++;
+	}
+
+	return count * sizeof (struct LM629_Event);
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_set_subscription(struct servo_client *client,       |
+ |                                  struct ANDI_Subscription *arg)     |
+ +--------------------------------------------------------------------*/
+static int servo_set_subscription(struct servo_client *client,
+								  struct ANDI_Subscription *arg)
+{
+	struct ANDI_Subscription subscription;
+
+	LG(TRACE,
+	   "static int servo_set_subscription(struct servo_client *client, struct ANDI_Subscription *arg)\n");
+
+	if (copy_from_user(&subscription, arg, sizeof (subscription)))
+		return -EFAULT;
+
+	if (subscription.events & ~SERVO_EVENT_BITS)
+		return -EINVAL;
+
+	spin_lock_bh(&event_lock);
+
+	client->events = subscription.events;
+	client->decimation = subscription.decimation;
+
+	spin_unlock_bh(&event_lock);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_get_subscription(struct servo_client *client,       |
+ |                                  struct ANDI_Subscription *arg)     |
+ +--------------------------------------------------------------------*/
+static int servo_get_subscription(struct servo_client *client,
+								  struct ANDI_Subscription *arg)
+{
+	struct ANDI_Subscription subscription;
+
+	LG(TRACE,
+	   "static int servo_get_subscription(struct servo_client *client, struct ANDI_Subscription *arg)\n");
+
+	subscription.events = client->events;
+	subscription.decimation = client->decimation;
+
+	if (copy_to_user(arg, &subscription, sizeof (subscription)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    Position error faults                                            |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |    static __u32 servo_cycles_to_ns(cycles_t cycles)                 |
+ +--------------------------------------------------------------------*/
+static __u32 servo_cycles_to_ns(cycles_t cycles)
+{
+	u64 ns;
+
+	if (!cpu_khz)
+		return 0;
+
+	ns = (u64) cycles * 1000000;
+	do_div(ns, cpu_khz);
+
+	return ns > 0xffffffff ? 0xffffffff : (__u32) ns;
+}
+
+/*---------------------------------------------------------------------+
+ |static void servo_fault_brake(int channel, int source, cycles_t seen)|
+ |                                                                     |
+ | First half of the fault reaction, safe in the interrupt handler:    |
+ | board registers only, so no LM629 command can be interrupted. Puts  |
+ | both PWM brakes and the fault LED on and records the fault.         |
+ +--------------------------------------------------------------------*/
+static void servo_fault_brake(int channel, int source, cycles_t seen)
+{
+	struct timeval now;
+	unsigned long flags;
+
+	spin_lock_irqsave(&brake_lock, flags);
+
+	fault.channels |= 1 << channel;
+
+	if (fault.active)
+	{
+		spin_unlock_irqrestore(&brake_lock, flags);
+		return;
+	}
+
+	servo.BrakesForced |= 0x03;
+	bus_outb(servo_brake_image(), servo.base_address + PWM_BRAKES);
+	servo.control |= LED_MASK;
+	bus_outb(servo.control, servo.base_address + LED);
+	BUS_BOARD.board_writes += 2;
+
+	fault.brake_ns = servo_cycles_to_ns(get_cycles() - seen);
+
+	servo.FaultLED = TRUE;
+	fault_seen = seen;
+	fault_stopped = FALSE;
+
+	do_gettimeofday(&now);
+
+	fault.active = TRUE;
+	fault.channels = 1 << channel;
+	fault.source = source;
+	fault.count++;
+	fault.tv_sec = now.tv_sec;
+	fault.tv_usec = now.tv_usec;
+	fault.stop_ns = 0;
+
+	spin_unlock_irqrestore(&brake_lock, flags);
+
+	servo_notify();
+}
+
+/*---------------------------------------------------------------------+
+ |    static void servo_fault_stop(void)                               |
+ |                                                                     |
+ |    Second half, with both bus locks held: stops both LM629s. A      |
+ |    channel in stop-on-error mode has had its motor turned off by    |
+ |    the LM629, so it is left off; the other is stopped abruptly and  |
+ |    holds.                                                           |
+ +--------------------------------------------------------------------*/
+static void servo_fault_stop(void)
+{
+	struct LM629 *lm629;
+	unsigned long flags;
+	int channel;
+
+	if (!fault.active || fault_stopped)
+		return;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+		if (lm629->stop_on_error)
+			lm629->NewTrajectory = &off_trajectory[channel];
+		else
+			lm629->NewTrajectory = &stop_trajectory[channel];
+
+		if (load_trajectory(&servo, channel) == 0)
+			start_trajectory(&servo, channel);
+	}
+
+	spin_lock_irqsave(&brake_lock, flags);
+	fault.stop_ns = servo_cycles_to_ns(get_cycles() - fault_seen);
+	spin_unlock_irqrestore(&brake_lock, flags);
+
+	fault_stopped = TRUE;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_get_fault(struct ANDI_Fault *arg)               |
+ |                                                                     |
+ |    The IRQ handler writes the record under brake_lock, so it is     |
+ |    copied out under the lock and handed to copy_to_user() after.    |
+ +--------------------------------------------------------------------*/
+static int servo_get_fault(struct ANDI_Fault *arg)
+{
+	struct ANDI_Fault copy;
+	unsigned long flags;
+
+	LG(TRACE, "static int servo_get_fault(struct ANDI_Fault *arg)\n");
+
+	spin_lock_irqsave(&brake_lock, flags);
+	copy = fault;
+	spin_unlock_irqrestore(&brake_lock, flags);
+
+	if (copy_to_user(arg, &copy, sizeof (struct ANDI_Fault)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_clear_fault(void)                               |
+ |                                                                     |
+ |    Releases the brakes to what was asked for before the fault (or   |
+ |    that a thermal fault still holds) and puts the LED out. The axes |
+ |    stay stopped.                                                    |
+ +--------------------------------------------------------------------*/
+static int servo_clear_fault(void)
+{
+	unsigned long flags;
+	int retval, channel;
+
+	LG(TRACE, "static int servo_clear_fault(void)\n");
+
+	if (!fault.active)
+		return 0;
+
+	servo_fault_stop();
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		retval = reset_interrupts(&servo, channel, POSITION_ERROR_INTERRUPT);
+		if (retval < 0)
+			return retval;
+	}
+
+	spin_lock_irqsave(&brake_lock, flags);
+
+	servo.BrakesForced = servo_thermal_brakes();
+
+	retval = set_PWM_brakes(&servo, servo.brakes);
+	if (retval == 0)
+		retval = set_fault_LED(&servo, FALSE);
+	if (retval == 0)
+		fault.active = FALSE;
+
+	spin_unlock_irqrestore(&brake_lock, flags);
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------+
+ |    Thermal faults and notification                                  |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |    static int servo_brake_image(void)                               |
+ |                                                                     |
+ |    What PWM_BRAKES should hold: the brakes asked for through the    |
+ |    driver plus any forced on by a fault.                            |
+ +--------------------------------------------------------------------*/
+static int servo_brake_image(void)
+{
+	return servo.brakes | servo.BrakesForced;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_thermal_brakes(void)                            |
+ +--------------------------------------------------------------------*/
+static int servo_thermal_brakes(void)
+{
+	return (servo.Channel0->Thermal.active ? 0x01 : 0) |
+		(servo.Channel1->Thermal.active ? 0x02 : 0);
+}
+
+/*---------------------------------------------------------------------+
+ |    static void servo_notify(void)                                   |
+ |                                                                     |
+ |    Tells subscribers something happened: SIGIO to those that asked  |
+ |    for it, and a wake up for anyone sleeping in the driver.         |
+ +--------------------------------------------------------------------*/
+static void servo_notify(void)
+{
+	kill_fasync(&servo_async_queue, SIGIO, POLL_IN);
+	wake_up_interruptible(&servo_wait);
+}
+
+/*---------------------------------------------------------------------+
+ |    static void servo_thermal(int channel, cycles_t seen)            |
+ |                                                                     |
+ |    The H-bridge of a channel is overheating. Called from the        |
+ |    interrupt handler, or the sampler when polled; board registers   |
+ |    only. Brakes that channel at once and holds the brake until      |
+ |    SERVO_CLEAR_THERMAL; until then further causes are not counted.  |
+ +--------------------------------------------------------------------*/
+static void servo_thermal(int channel, cycles_t seen)
+{
+	struct LM629 *lm629;
+	struct timeval now;
+	unsigned long flags;
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	spin_lock_irqsave(&brake_lock, flags);
+
+	/* Still braked from the last one; a line held asserted is one event */
+	if (lm629->Thermal.active)
+	{
+		spin_unlock_irqrestore(&brake_lock, flags);
+		return;
+	}
+
+	servo.BrakesForced |= 1 << channel;
+	bus_outb(servo_brake_image(), servo.base_address + PWM_BRAKES);
+	BUS_BOARD.board_writes++;
+
+	lm629->Thermal.brake_ns = servo_cycles_to_ns(get_cycles() - seen);
+
+	do_gettimeofday(&now);
+
+	lm629->Thermal.active = TRUE;
+	lm629->Thermal.count++;
+	lm629->Thermal.tv_sec = now.tv_sec;
+	lm629->Thermal.tv_usec = now.tv_usec;
+
+	spin_unlock_irqrestore(&brake_lock, flags);
+
+	servo_notify();
+}
+
+/*---------------------------------------------------------------------+
+ |    static void servo_poll_thermal(void)                             |
+ |                                                                     |
+ |    Without an IRQ, the sampler looks at the thermal bits itself.    |
+ |    Only a new thermal condition counts as an event.                 |
+ +--------------------------------------------------------------------*/
+static void servo_poll_thermal(void)
+{
+	static int previous;
+	cycles_t seen;
+	int cause;
+
+	seen = get_cycles();
+	cause = bus_inb(servo.base_address + IRQCAUSE);
+	BUS_BOARD.board_reads++;
+
+	if ((cause & ~previous) & CHANNEL0_THERMAL_IRQ)
+		servo_thermal(0, seen);
+	if ((cause & ~previous) & CHANNEL1_THERMAL_IRQ)
+		servo_thermal(1, seen);
+
+	previous = cause;
+}
+
+/*---------------------------------------------------------------------+
+ |static int servo_get_thermal(int channel, struct LM629_Thermal *arg) |
+ |                                                                     |
+ |    As servo_get_fault(): a copy taken under brake_lock.             |
+ +--------------------------------------------------------------------*/
+static int servo_get_thermal(int channel, struct LM629_Thermal *arg)
+{
+	struct LM629 *lm629;
+	struct LM629_Thermal copy;
+	unsigned long flags;
+
+	LG(TRACE,
+	   "static int servo_get_thermal(int channel, struct LM629_Thermal *arg)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	spin_lock_irqsave(&brake_lock, flags);
+	copy = lm629->Thermal;
+	spin_unlock_irqrestore(&brake_lock, flags);
+
+	if (copy_to_user(arg, &copy, sizeof (struct LM629_Thermal)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_clear_thermal(int channel)                      |
+ +--------------------------------------------------------------------*/
+static int servo_clear_thermal(int channel)
+{
+	struct LM629 *lm629;
+	unsigned long flags;
+	int retval;
+
+	LG(TRACE, "static int servo_clear_thermal(int channel)\n");
+
+	lm629 = channel ? servo.Channel1 : servo.Channel0;
+
+	spin_lock_irqsave(&brake_lock, flags);
+
+	lm629->Thermal.active = FALSE;
+	servo.BrakesForced = servo_thermal_brakes() | (fault.active ? 0x03 : 0);
+
+	retval = set_PWM_brakes(&servo, servo.brakes);
+
+	spin_unlock_irqrestore(&brake_lock, flags);
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------+
+ |    Board registers                                                  |
+ +--------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------+
+ |static int servo_set_board(int (*set) (int value), int value)        |
+ |                                                                     |
+ |  Board register writes go through the cached images; brake_lock     |
+ |  keeps them consistent with the fault paths in the IRQ handler.     |
+ +--------------------------------------------------------------------*/
+static int servo_set_board(int (*set) (int value), int value)
+{
+	unsigned long flags;
+	int retval;
+
+	spin_lock_irqsave(&brake_lock, flags);
+	retval = set(value);
+	spin_unlock_irqrestore(&brake_lock, flags);
+
+	return retval;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_set_brakes(int brakes)                          |
+ +--------------------------------------------------------------------*/
+static int servo_set_brakes(int brakes)
+{
+	return set_PWM_brakes(&servo, brakes);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_set_brake0(int brake)                           |
+ +--------------------------------------------------------------------*/
+static int servo_set_brake0(int brake)
+{
+	return set_PWM_brake(&servo, 0, brake != 0);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_set_brake1(int brake)                           |
+ +--------------------------------------------------------------------*/
+static int servo_set_brake1(int brake)
+{
+	return set_PWM_brake(&servo, 1, brake != 0);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_set_led(int on)                                 |
+ +--------------------------------------------------------------------*/
+static int servo_set_led(int on)
+{
+	return set_fault_LED(&servo, on != 0);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_set_irq_enable(int enable)                      |
+ +--------------------------------------------------------------------*/
+static int servo_set_irq_enable(int enable)
+{
+	return set_board_irq(&servo, enable != 0);
+}
+
+/*---------------------------------------------------------------------+
+ |    static int servo_hard_reset(void)                                |
+ |                                                                     |
+ |    Hardware resets both LM629s, then puts back what the driver      |
+ |    keeps in its images: brakes, fault LED, IRQ enable and masks.    |
+ |    The position counters restart from 0.                            |
+ +--------------------------------------------------------------------*/
+static int servo_hard_reset(void)
+{
+	struct LM629 *lm629;
+	int retval, channel;
+
+	LG(TRACE, "static int servo_hard_reset(void)\n");
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		retval = hard_reset(&servo, channel);
+		if (retval < 0)
+			return retval;
+
+		lm629 = channel ? servo.Channel1 : servo.Channel0;
+		lm629->position_primed = FALSE;
+
+		/* Whatever was moving has stopped */
+		servo_trajectory_done(channel, NULL);
+
+		if (irq > 0)
+		{
+			retval = set_irq_mask(&servo, channel, &lm629->irq_mask);
+			if (retval < 0)
+				return retval;
+		}
+	}
+
+	spin_lock_bh(&odometry_lock);
+	odometry_restart(&odometry);
+	spin_unlock_bh(&odometry_lock);
+
+	retval = servo_set_board(servo_set_brakes, servo.brakes);
+	if (retval < 0)
+		return retval;
+
+	retval = servo_set_board(servo_set_led, fault.active);
+	if (retval < 0)
+		return retval;
 
-	return sizeof (struct LM629_Trajectory);
+	return servo_set_board(servo_set_irq_enable, irq > 0);
 }
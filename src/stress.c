@@ -0,0 +1,798 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver Stress test                        |
+ |                                                                                |
+ |   Copyright (c) 1999, Mark Dennehy                                             |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+/*
+ * stress [-w workers] [-n ops] [-d]
+ *
+ * Several clients at once, as a controller, a logger and a UI are in
+ * use: each worker mixes filter reloads (filter minors), trajectory
+ * starts (trajectory minors), status and position reads (channel
+ * minors), the board level filter commit (board minor) and model
+ * reads, as the /proc files make them, on both channels. Every worker
+ * times each of its operations, and the latencies are reported per
+ * kind of operation.
+ *
+ * Without -d the workers are threads driving the chip functions, built
+ * for user space, on the emulated board, and take the channel locks as
+ * servo.c does (both, channel 0 first, for board operations). After
+ * each filter commit and trajectory start the emulated LM629 is checked
+ * against what the driver believes it loaded, and the emulator's own
+ * protocol violations are counted too. With -d the workers are
+ * processes using /dev/andi_servo and /proc/andi_servo, and what is
+ * read back must be exactly one of the records some worker wrote.
+ *
+ * All filters and trajectories come from fixed tables that nothing
+ * writes to once the workers are going, so a record that is in neither
+ * is torn, and is an integrity violation.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <andi_servo.h>
+#include <andi_client.h>
+#include <tools.h>
+
+#define BASE_ADDRESS	0x300
+#define DEFAULT_WORKERS	4
+#define DEFAULT_OPS		5000
+#define TABLE			64
+
+/* A table entry picked from the worker's own sequence */
+#define ENTRY(worker)	(next_random(&(worker)->seed) % TABLE)
+
+#define PROC_DIR		"/proc/andi_servo/"
+
+/* Kinds of operation */
+#define OP_FILTER		0			/* Load and commit a filter             */
+#define OP_TRAJECTORY	1			/* Load and start a trajectory          */
+#define OP_STATUS		2			/* Status byte and real position        */
+#define OP_BOARD		3			/* Both filters, committed together     */
+#define OP_PROC			4			/* Filter and trajectory model reads    */
+#define OP_KINDS		5
+
+static char *op_kinds[OP_KINDS] = {
+	"filter", "trajectory", "status", "board", "proc"
+};
+
+struct worker
+{
+	int id;
+	unsigned long seed;
+	unsigned long ops[OP_KINDS];
+	unsigned long errors[OP_KINDS];
+	unsigned long violations;
+	unsigned long long *latency[OP_KINDS];	/* ns, one per op               */
+
+	struct andi_client client;	/* Device mode                          */
+};
+
+static struct LM629_Filter filter_table[TABLE];
+static struct LM629_Trajectory trajectory_table[TABLE];
+
+static struct andi_servo board;
+static struct LM629 channel0, channel1;
+static pthread_mutex_t channel_locks[2] = {
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER
+};
+
+static int device_mode;
+static unsigned long worker_ops;
+
+/*---------------------------------------------------------------------+
+ |    static void make_tables(void)                                    |
+ |                                                                     |
+ |    Every entry differs from every other in each field, so a record  |
+ |    put together from two of them matches none.                      |
+ +--------------------------------------------------------------------*/
+static void make_tables(void)
+{
+	struct LM629_Trajectory *trajectory;
+	int i;
+
+	for (i = 0; i < TABLE; i++)
+	{
+		filter_table[i].dterm = 1 + i;
+		filter_table[i].kp = 0x100 + i;
+		filter_table[i].ki = 0x10 + i;
+		filter_table[i].kd = 0x400 + 3 * i;
+		filter_table[i].il = 0x80 + i;
+
+		trajectory = &trajectory_table[i];
+		memset(trajectory, 0, sizeof (struct LM629_Trajectory));
+		trajectory->load_vel = TRUE;
+		trajectory->velocity = 0x10000 + i * 0x100;
+		if (i & 1)
+		{
+			trajectory->velocity_mode = TRUE;
+			trajectory->forward_dir = (i >> 1) & 1;
+		}
+		else
+		{
+			trajectory->load_acc = TRUE;
+			trajectory->load_pos = TRUE;
+			trajectory->acc = 0x100 + i;
+			trajectory->position = (i - TABLE / 2) * 0x1000;
+		}
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |    static int filter_entry(struct LM629_Filter *filter)             |
+ |                                                                     |
+ |    The table entry the filter is, or -1.                            |
+ +--------------------------------------------------------------------*/
+static int filter_entry(struct LM629_Filter *filter)
+{
+	int i;
+
+	i = filter->dterm - 1;
+	if (i < 0 || i >= TABLE)
+		return -1;
+
+	if (filter->kp != filter_table[i].kp || filter->ki != filter_table[i].ki ||
+		filter->kd != filter_table[i].kd || filter->il != filter_table[i].il)
+		return -1;
+
+	return i;
+}
+
+/*---------------------------------------------------------------------+
+ | static int trajectory_entry(struct LM629_Trajectory *trajectory)    |
+ +--------------------------------------------------------------------*/
+static int trajectory_entry(struct LM629_Trajectory *trajectory)
+{
+	struct LM629_Trajectory *entry;
+	int i;
+
+	i = (trajectory->velocity - 0x10000) / 0x100;
+	if (i < 0 || i >= TABLE)
+		return -1;
+
+	entry = &trajectory_table[i];
+	if (trajectory->forward_dir != entry->forward_dir ||
+		trajectory->velocity_mode != entry->velocity_mode ||
+		trajectory->stop_smooth != entry->stop_smooth ||
+		trajectory->stop_abrupt != entry->stop_abrupt ||
+		trajectory->motor_off != entry->motor_off ||
+		trajectory->load_acc != entry->load_acc ||
+		trajectory->load_vel != entry->load_vel ||
+		trajectory->load_pos != entry->load_pos ||
+		trajectory->acc_relative != entry->acc_relative ||
+		trajectory->vel_relative != entry->vel_relative ||
+		trajectory->pos_relative != entry->pos_relative ||
+		trajectory->acc != entry->acc ||
+		trajectory->velocity != entry->velocity ||
+		trajectory->position != entry->position)
+		return -1;
+
+	return i;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int emu_filter_matches(int channel)                       |
+ |                                                                     |
+ |    Whether the emulated LM629 runs the filter the driver committed. |
+ +--------------------------------------------------------------------*/
+static int emu_filter_matches(int channel)
+{
+	struct LM629_Filter *loaded, *filter;
+
+	loaded = &userspace_emu.chip[channel].filter;
+	filter = userspace_channel(&board, channel)->Filter;
+
+	return loaded->dterm == filter->dterm && loaded->kp == filter->kp &&
+		loaded->ki == filter->ki && loaded->kd == filter->kd &&
+		loaded->il == filter->il;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int emu_trajectory_matches(int channel)                   |
+ +--------------------------------------------------------------------*/
+static int emu_trajectory_matches(int channel)
+{
+	struct lm629_emu_chip *chip;
+	struct LM629_Trajectory *trajectory;
+
+	chip = &userspace_emu.chip[channel];
+	trajectory = userspace_channel(&board, channel)->Trajectory;
+
+	if (chip->velocity_mode != trajectory->velocity_mode ||
+		chip->max_velocity != trajectory->velocity)
+		return FALSE;
+
+	if (trajectory->velocity_mode)
+		return chip->forward == trajectory->forward_dir;
+
+	return chip->acc == trajectory->acc &&
+		chip->target == trajectory->position;
+}
+
+/*---------------------------------------------------------------------+
+ |    The operations on the emulated board, locked as servo.c locks    |
+ |    them. Each returns 0 or a negative errno.                        |
+ +--------------------------------------------------------------------*/
+static int emu_filter(struct worker *worker, int channel)
+{
+	int retval;
+
+	pthread_mutex_lock(&channel_locks[channel]);
+
+	userspace_channel(&board, channel)->NewFilter =
+		&filter_table[ENTRY(worker)];
+	retval = load_filter(&board, channel);
+	if (retval >= 0)
+		retval = update_filter(&board, channel);
+	if (retval >= 0 && !emu_filter_matches(channel))
+		worker->violations++;
+
+	pthread_mutex_unlock(&channel_locks[channel]);
+
+	return retval;
+}
+
+static int emu_trajectory(struct worker *worker, int channel)
+{
+	int retval;
+
+	pthread_mutex_lock(&channel_locks[channel]);
+
+	userspace_channel(&board, channel)->NewTrajectory =
+		&trajectory_table[ENTRY(worker)];
+	retval = load_trajectory(&board, channel);
+	if (retval >= 0)
+		retval = start_trajectory(&board, channel);
+	if (retval >= 0 && !emu_trajectory_matches(channel))
+		worker->violations++;
+
+	pthread_mutex_unlock(&channel_locks[channel]);
+
+	return retval;
+}
+
+static int emu_status(struct worker *worker, int channel)
+{
+	long position;
+	int status, retval;
+
+	pthread_mutex_lock(&channel_locks[channel]);
+
+	retval = get_status(&board, channel, &status);
+	if (retval >= 0)
+		retval = get_real_position(&board, channel, &position);
+
+	pthread_mutex_unlock(&channel_locks[channel]);
+
+	return retval;
+}
+
+static int emu_board(struct worker *worker, int channel)
+{
+	int retval;
+
+	pthread_mutex_lock(&channel_locks[0]);
+	pthread_mutex_lock(&channel_locks[1]);
+
+	channel0.NewFilter = &filter_table[ENTRY(worker)];
+	channel1.NewFilter = &filter_table[ENTRY(worker)];
+	retval = load_filter(&board, 0);
+	if (retval >= 0)
+		retval = load_filter(&board, 1);
+	if (retval >= 0)
+		retval = update_filters(&board);
+	if (retval >= 0 && (!emu_filter_matches(0) || !emu_filter_matches(1)))
+		worker->violations++;
+
+	pthread_mutex_unlock(&channel_locks[1]);
+	pthread_mutex_unlock(&channel_locks[0]);
+
+	return retval;
+}
+
+/* No lock: the /proc files copy the model under model_seq */
+static int emu_proc(struct worker *worker, int channel)
+{
+	struct LM629_Filter filter;
+	struct LM629_Trajectory trajectory;
+	char buffer[512];
+	unsigned int seq;
+
+	do
+	{
+		seq = model_read_begin(userspace_channel(&board, channel));
+		filter = *userspace_channel(&board, channel)->Filter;
+		trajectory = *userspace_channel(&board, channel)->Trajectory;
+	}
+	while (model_read_retry(userspace_channel(&board, channel), seq));
+
+	if (filter_entry(&filter) < 0 || trajectory_entry(&trajectory) < 0)
+		worker->violations++;
+
+	print_filter(&filter, buffer);
+	print_trajectory(&trajectory, buffer);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    The same operations through the device. A commit that finds     |
+ |    nothing pending has lost a race to another worker's commit,     |
+ |    which the driver reports with ENODATA; it is not an error.       |
+ +--------------------------------------------------------------------*/
+static int dev_commit(int retval)
+{
+	return retval == -ENODATA ? 0 : retval;
+}
+
+static int dev_filter(struct worker *worker, int channel)
+{
+	struct LM629_Filter filter;
+	int retval;
+
+	retval = andi_load_filter(&worker->client, channel,
+							  &filter_table[ENTRY(worker)]);
+	if (retval < 0)
+		return retval;
+
+	retval = dev_commit(andi_update_filter(&worker->client, channel));
+	if (retval < 0)
+		return retval;
+
+	/* -EINVAL is a record the driver tore beyond unpacking */
+	retval = andi_get_filter(&worker->client, channel, &filter);
+	if (retval == -EINVAL || (retval >= 0 && filter_entry(&filter) < 0))
+		worker->violations++;
+
+	return retval == -EINVAL ? 0 : retval;
+}
+
+static int dev_trajectory(struct worker *worker, int channel)
+{
+	struct LM629_Trajectory trajectory;
+	int retval;
+
+	retval = andi_load_trajectory(&worker->client, channel,
+								  &trajectory_table[ENTRY(worker)]);
+	if (retval < 0)
+		return retval;
+
+	retval = dev_commit(andi_start_trajectory(&worker->client, channel));
+	if (retval < 0)
+		return retval;
+
+	retval = andi_get_trajectory(&worker->client, channel, &trajectory);
+	if (retval == -EINVAL ||
+		(retval >= 0 && trajectory_entry(&trajectory) < 0))
+		worker->violations++;
+
+	return retval == -EINVAL ? 0 : retval;
+}
+
+static int dev_status(struct worker *worker, int channel)
+{
+	struct LM629_Position position;
+	int status, retval;
+
+	retval = andi_get_status(&worker->client, channel, &status);
+	if (retval < 0)
+		return retval;
+
+	return andi_get_position(&worker->client, channel, &position);
+}
+
+static int dev_board(struct worker *worker, int channel)
+{
+	int retval;
+
+	retval = andi_load_filter(&worker->client, 0,
+							  &filter_table[ENTRY(worker)]);
+	if (retval < 0)
+		return retval;
+
+	retval = andi_load_filter(&worker->client, 1,
+							  &filter_table[ENTRY(worker)]);
+	if (retval < 0)
+		return retval;
+
+	return dev_commit(andi_update_filters(&worker->client));
+}
+
+/* As a logger would: open, read and close each time */
+static int dev_read_proc(char *name)
+{
+	char buffer[4096];
+	int fd, length;
+
+	fd = open(name, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+
+	length = read(fd, buffer, sizeof (buffer));
+	if (length < 0)
+		length = -errno;
+
+	close(fd);
+
+	return length < 0 ? length : 0;
+}
+
+static int dev_proc(struct worker *worker, int channel)
+{
+	int retval;
+
+	retval = dev_read_proc(channel ? PROC_DIR "filter1" : PROC_DIR "filter0");
+	if (retval < 0)
+		return retval;
+
+	return dev_read_proc(channel ? PROC_DIR "trajectory1" :
+						 PROC_DIR "trajectory0");
+}
+
+static int (*emu_ops[OP_KINDS]) (struct worker *, int) = {
+	emu_filter, emu_trajectory, emu_status, emu_board, emu_proc
+};
+
+static int (*dev_ops[OP_KINDS]) (struct worker *, int) = {
+	dev_filter, dev_trajectory, dev_status, dev_board, dev_proc
+};
+
+/*---------------------------------------------------------------------+
+ |    static int pick_op(struct worker *worker)                        |
+ |                                                                     |
+ |    Mostly status and proc reads, as the logger and UI make them.    |
+ +--------------------------------------------------------------------*/
+static int pick_op(struct worker *worker)
+{
+	switch (next_random(&worker->seed) % 16)
+	{
+	case 0:
+	case 1:
+		return OP_FILTER;
+
+	case 2:
+	case 3:
+	case 4:
+	case 5:
+		return OP_TRAJECTORY;
+
+	case 6:
+		return OP_BOARD;
+
+	case 7:
+	case 8:
+	case 9:
+	case 10:
+		return OP_PROC;
+
+	default:
+		return OP_STATUS;
+	}
+}
+
+/*---------------------------------------------------------------------+
+ |    static void *run_worker(void *arg)                               |
+ +--------------------------------------------------------------------*/
+static void *run_worker(void *arg)
+{
+	struct worker *worker;
+	unsigned long long start;
+	unsigned long i;
+	int kind, channel, retval;
+
+	worker = arg;
+
+	if (device_mode && andi_open(&worker->client, 0) < 0)
+	{
+		worker->errors[OP_STATUS] = worker_ops;
+		return NULL;
+	}
+
+	for (i = 0; i < worker_ops; i++)
+	{
+		kind = pick_op(worker);
+		channel = next_random(&worker->seed) & 1;
+
+		start = clock_ns();
+		if (device_mode)
+			retval = dev_ops[kind] (worker, channel);
+		else
+			retval = emu_ops[kind] (worker, channel);
+		worker->latency[kind][worker->ops[kind]++] = clock_ns() - start;
+
+		if (retval < 0)
+			worker->errors[kind]++;
+	}
+
+	if (device_mode)
+		andi_close(&worker->client);
+
+	return NULL;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int setup_board(void)                                     |
+ |                                                                     |
+ |    A filter and a trajectory from the tables on each channel, so    |
+ |    that the model reads have something to copy from the start.     |
+ +--------------------------------------------------------------------*/
+static int setup_board(void)
+{
+	int channel, retval;
+
+	for (channel = 0; channel < 2; channel++)
+	{
+		retval = hard_reset(&board, channel);
+		if (retval < 0)
+			return retval;
+
+		userspace_channel(&board, channel)->NewFilter = &filter_table[0];
+		retval = load_filter(&board, channel);
+		if (retval >= 0)
+			retval = update_filter(&board, channel);
+		if (retval < 0)
+			return retval;
+
+		userspace_channel(&board, channel)->NewTrajectory =
+			&trajectory_table[0];
+		retval = load_trajectory(&board, channel);
+		if (retval >= 0)
+			retval = start_trajectory(&board, channel);
+		if (retval < 0)
+			return retval;
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int run_workers(struct worker *workers, int count)        |
+ +--------------------------------------------------------------------*/
+static int run_workers(struct worker *workers, int count)
+{
+	pthread_t *threads;
+	pid_t pid;
+	int i;
+
+	if (device_mode)
+	{
+		for (i = 0; i < count; i++)
+		{
+			pid = fork();
+			if (pid < 0)
+				return -errno;
+			if (!pid)
+			{
+				run_worker(&workers[i]);
+				_exit(0);
+			}
+		}
+
+		while (wait(NULL) > 0)
+			;
+
+		return 0;
+	}
+
+	threads = malloc(count * sizeof (pthread_t));
+	if (!threads)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++)
+		if (pthread_create(&threads[i], NULL, run_worker, &workers[i]))
+			return -EAGAIN;
+
+	for (i = 0; i < count; i++)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ | static unsigned long print_results(struct worker *workers,          |
+ |                                    int count, unsigned long long ns)|
+ |                                                                     |
+ | Merges the workers' latencies for each kind of operation and prints |
+ | them. Returns the errors.                                           |
+ +--------------------------------------------------------------------*/
+static unsigned long print_results(struct worker *workers, int count,
+								   unsigned long long ns)
+{
+	unsigned long long *latency;
+	unsigned long n, errors, total_ops, total_errors;
+	int kind, i;
+
+	latency = malloc(count * worker_ops * sizeof (unsigned long long));
+	if (!latency)
+		return 1;
+
+	printf("%-11s %7s %9s %8s %8s %8s %8s %6s\n", "operation", "ops",
+		   "ops/s", "p50", "p99", "p999", "max", "errors");
+
+	total_ops = 0;
+	total_errors = 0;
+	for (kind = 0; kind < OP_KINDS; kind++)
+	{
+		n = 0;
+		errors = 0;
+		for (i = 0; i < count; i++)
+		{
+			memcpy(latency + n, workers[i].latency[kind],
+				   workers[i].ops[kind] * sizeof (unsigned long long));
+			n += workers[i].ops[kind];
+			errors += workers[i].errors[kind];
+		}
+
+		total_ops += n;
+		total_errors += errors;
+
+		if (!n)
+			continue;
+
+		sort_latency(latency, n);
+
+		printf("%-11s %7lu %9.0f %8.1f %8.1f %8.1f %8.1f %6lu\n",
+			   op_kinds[kind], n, n * 1e9 / ns,
+			   percentile(latency, n, 500), percentile(latency, n, 990),
+			   percentile(latency, n, 999), latency[n - 1] / 1000.0, errors);
+	}
+
+	printf("%-11s %7lu %9.0f %44lu\n", "all", total_ops,
+		   total_ops * 1e9 / ns, total_errors);
+
+	free(latency);
+
+	return total_errors;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int usage(char *name)                                     |
+ +--------------------------------------------------------------------*/
+static int usage(char *name)
+{
+	fprintf(stderr, "usage: %s [-w workers] [-n ops] [-d]\n", name);
+
+	return 2;
+}
+
+/*---------------------------------------------------------------------+
+ |    int main(int argc, char **argv)                                  |
+ +--------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+	struct worker *workers;
+	unsigned long long *latency, start, ns;
+	unsigned long violations;
+	size_t size;
+	int count, retval, kind, i, c;
+
+	count = DEFAULT_WORKERS;
+	worker_ops = DEFAULT_OPS;
+
+	while ((c = getopt(argc, argv, "w:n:d")) != -1)
+	{
+		switch (c)
+		{
+		case 'w':
+			count = atoi(optarg);
+			break;
+
+		case 'n':
+			worker_ops = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'd':
+			device_mode = TRUE;
+			break;
+
+		default:
+			return usage(argv[0]);
+		}
+	}
+
+	if (count < 1 || !worker_ops || optind != argc)
+		return usage(argv[0]);
+
+	make_tables();
+
+	if (!device_mode)
+	{
+		retval = userspace_open(USERSPACE_EMULATOR, BASE_ADDRESS);
+		if (retval >= 0)
+		{
+			userspace_board(&board, &channel0, &channel1);
+			retval = setup_board();
+		}
+		if (retval < 0)
+		{
+			fprintf(stderr, "%s: cannot set up the emulated board: %s\n",
+					argv[0], strerror(-retval));
+			return 1;
+		}
+	}
+
+	/* Shared, so that worker processes can hand back their results */
+	size = count * (sizeof (struct worker) +
+					OP_KINDS * worker_ops * sizeof (unsigned long long));
+	workers = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (workers == MAP_FAILED)
+	{
+		perror(argv[0]);
+		return 1;
+	}
+
+	latency = (unsigned long long *) (workers + count);
+	for (i = 0; i < count; i++)
+	{
+		workers[i].id = i;
+		workers[i].seed = i + 1;
+		for (kind = 0; kind < OP_KINDS; kind++)
+		{
+			workers[i].latency[kind] = latency;
+			latency += worker_ops;
+		}
+	}
+
+	printf("%s, %d %s of %lu ops; latencies in us\n",
+		   device_mode ? "/dev/andi_servo" : "emulated LM629", count,
+		   device_mode ? "processes" : "threads", worker_ops);
+
+	start = clock_ns();
+	retval = run_workers(workers, count);
+	ns = clock_ns() - start;
+	if (retval < 0)
+	{
+		fprintf(stderr, "%s: cannot start the workers: %s\n", argv[0],
+				strerror(-retval));
+		return 1;
+	}
+
+	retval = print_results(workers, count, ns) ? 1 : 0;
+
+	violations = 0;
+	for (i = 0; i < count; i++)
+		violations += workers[i].violations;
+	printf("integrity violations: %lu\n", violations);
+	if (violations)
+		retval = 1;
+
+	if (!device_mode)
+	{
+		printf("emulator: %lu protocol violations\n",
+			   userspace_emu.violations);
+		if (userspace_emu.violations)
+			retval = 1;
+		userspace_close();
+	}
+
+	munmap(workers, size);
+
+	return retval;
+}
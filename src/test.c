@@ -23,26 +23,36 @@
  +-------------------------------------------------------------------------------*/
 
 #include <stdio.h>
-#include <stddef.h>
-#include <sys/ioctl.h>
-#include <andi.h>
+#include <stdlib.h>
+#include <string.h>
+#include <andi_client.h>
 
-#define FILENAME "/dev/andi_servo/filter0"
-
-/*#define FILENAME "testfile" */
-
-int atoi(char *buf);
+/*
+ * test dterm kp ki kd il
+ *
+ * Loads the filter on channel 0 and puts it in use.
+ */
 
 int main(int argc, char **argv)
 {
-	FILE *servo;
-	struct LM629_Filter filter = { 0, 0, 0, 0, 0 };
+	struct andi_client servo;
+	struct LM629_Filter filter;
+	int retval;
 
-	int i = -1;
+	if (argc != 6)
+	{
+		fprintf(stderr, "usage: %s dterm kp ki kd il\n", argv[0]);
+		return 2;
+	}
 
-	servo = fopen(FILENAME, "r+b");
-	printf("Opened file\n");
-	fflush(stdout);
+	retval = andi_open(&servo, 0);
+	if (retval < 0)
+	{
+		fprintf(stderr, "Error : cannot open the driver: %s\n",
+				strerror(-retval));
+		return 1;
+	}
+	printf("Opened driver\n");
 
 	filter.dterm = atoi(argv[1]);
 	filter.kp = atoi(argv[2]);
@@ -52,22 +62,20 @@ int main(int argc, char **argv)
 
 	printf("test %d,%d,%d,%d,%d\n", filter.dterm, filter.kp, filter.ki,
 		   filter.kd, filter.il);
-	fflush(stdout);
-
-	i = fwrite((void *) &filter, sizeof (struct LM629_Filter), 1, servo);
 
-	printf("Wrote %d bytes.\n", i);
-	if (!i)
-		perror("Error : ");
-	fflush(stdout);
+	retval = andi_load_filter(&servo, 0, &filter);
+	if (retval < 0)
+		fprintf(stderr, "Error : loading filter: %s\n", strerror(-retval));
+	else
+	{
+		printf("Updating filter.\n");
+		retval = andi_update_filter(&servo, 0);
+		if (retval < 0)
+			fprintf(stderr, "Error : updating filter: %s\n",
+					strerror(-retval));
+	}
 
-	printf("Updating filter.\n");
-	fflush(stdout);
-	i = ioctl(servo->_fileno, SERVO_UPDATE_FILTER);
-	if (!i)
-		perror("Error : ");
-	fflush(stdout);
+	andi_close(&servo);
 
-	fclose(servo);
-	return 0;
+	return retval < 0 ? 1 : 0;
 }
@@ -0,0 +1,86 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <time.h>
+#include <tools.h>
+
+/*---------------------------------------------------------------------+
+ |    unsigned long long clock_ns(void)                                |
+ +--------------------------------------------------------------------*/
+unsigned long long clock_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (unsigned long long) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*---------------------------------------------------------------------+
+ |    unsigned long next_random(unsigned long *seed)                   |
+ +--------------------------------------------------------------------*/
+unsigned long next_random(unsigned long *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+
+	return (*seed >> 16) & 0x7fff;
+}
+
+/*---------------------------------------------------------------------+
+ |    static int compare_latency(const void *a, const void *b)         |
+ +--------------------------------------------------------------------*/
+static int compare_latency(const void *a, const void *b)
+{
+	unsigned long long x, y;
+
+	x = *(const unsigned long long *) a;
+	y = *(const unsigned long long *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*---------------------------------------------------------------------+
+ | void sort_latency(unsigned long long *latency, unsigned long n)     |
+ +--------------------------------------------------------------------*/
+void sort_latency(unsigned long long *latency, unsigned long n)
+{
+	qsort(latency, n, sizeof (unsigned long long), compare_latency);
+}
+
+/*---------------------------------------------------------------------+
+ |    double percentile(unsigned long long *latency, unsigned long n,  |
+ |                      int per_mille)                                 |
+ +--------------------------------------------------------------------*/
+double percentile(unsigned long long *latency, unsigned long n,
+				  int per_mille)
+{
+	unsigned long i;
+
+	i = n * per_mille / 1000;
+	if (i >= n)
+		i = n - 1;
+
+	return latency[i] / 1000.0;
+}
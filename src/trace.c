@@ -0,0 +1,386 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#include <trace.h>
+#include <andi_servo.h>
+
+#define TRACE TRUE
+
+#ifndef __KERNEL__
+#	define __KERNEL__
+#endif
+
+#ifndef MODULE
+#	define EXPORT_NO_SYMBOLS
+#	define MODULE
+#endif
+
+#define __NO_VERSION__
+
+int trace_enabled = FALSE;
+
+static struct trace_record trace_ring[TRACE_RECORDS];
+static unsigned int trace_head;	/* Records since the trace was started */
+static spinlock_t trace_lock = SPIN_LOCK_UNLOCKED;
+
+/* Cycle count and time of day when the trace was started */
+static cycles_t trace_start_cycles;
+static struct timeval trace_start_time;
+
+int capture_enabled = FALSE;
+
+static struct ANDI_Capture capture_ring[CAPTURE_RECORDS];
+static unsigned int capture_head;	/* Records since the capture was started */
+static spinlock_t capture_lock = SPIN_LOCK_UNLOCKED;
+static cycles_t capture_last;	/* Cycle count of the last record */
+static int capture_base;
+
+/*---------------------------------------------------------------------+
+ | void trace_point(int type, int channel, int a, int b, int c, int d) |
+ |                                                                     |
+ | Called through TRACE_POINT(), from any context.                     |
+ +--------------------------------------------------------------------*/
+void trace_point(int type, int channel, int a, int b, int c, int d)
+{
+	struct trace_record *record;
+	unsigned long flags;
+	cycles_t now;
+
+	now = get_cycles();
+
+	spin_lock_irqsave(&trace_lock, flags);
+
+	record = &trace_ring[trace_head & (TRACE_RECORDS - 1)];
+	record->when = now;
+	record->type = type;
+	record->channel = channel;
+	record->cpu = smp_processor_id();
+	record->irq = in_interrupt() != 0;
+	record->pid = record->irq ? 0 : current->pid;
+	record->a = a;
+	record->b = b;
+	record->c = c;
+	record->d = d;
+	trace_head++;
+
+	spin_unlock_irqrestore(&trace_lock, flags);
+}
+
+/*---------------------------------------------------------------------+
+ |    void trace_start(void)                                           |
+ |                                                                     |
+ |    Empties the ring and starts recording.                           |
+ +--------------------------------------------------------------------*/
+void trace_start(void)
+{
+	unsigned long flags;
+
+	LG(TRACE, "void trace_start(void)\n");
+
+	spin_lock_irqsave(&trace_lock, flags);
+
+	trace_head = 0;
+	trace_start_cycles = get_cycles();
+	do_gettimeofday(&trace_start_time);
+	trace_enabled = TRUE;
+
+	spin_unlock_irqrestore(&trace_lock, flags);
+}
+
+/*---------------------------------------------------------------------+
+ |    void trace_stop(void)                                            |
+ |                                                                     |
+ |    Stops recording. What was recorded can still be read.            |
+ +--------------------------------------------------------------------*/
+void trace_stop(void)
+{
+	LG(TRACE, "void trace_stop(void)\n");
+
+	trace_enabled = FALSE;
+}
+
+/*---------------------------------------------------------------------+
+ | int trace_read(char *buffer, char **buffer_location, off_t offset,  |
+ |                int buffer_length)                                   |
+ |                                                                     |
+ | The read_proc of /proc/andi_servo/trace. The file position counts   |
+ | records, not bytes: *buffer_location is set to the number of        |
+ | records used up, so that cat can follow a trace as it is recorded.  |
+ | Records overwritten before they were read are skipped, and a line   |
+ | says how many.                                                      |
+ +--------------------------------------------------------------------*/
+int trace_read(char *buffer, char **buffer_location, off_t offset,
+			   int buffer_length)
+{
+	struct trace_record record;
+	unsigned long flags;
+	unsigned int seq, head;
+	char line[128];
+	int len, n;
+
+	LG(TRACE,
+	   "int trace_read(char *buffer, char **buffer_location, off_t offset, int buffer_length)\n");
+
+	seq = offset;
+	len = 0;
+
+	spin_lock_irqsave(&trace_lock, flags);
+	head = trace_head;
+	spin_unlock_irqrestore(&trace_lock, flags);
+
+	/* Restarted since this reader began */
+	if ((int) (head - seq) < 0)
+		return 0;
+
+	if (head - seq > TRACE_RECORDS)
+	{
+		len = sprintf(buffer, "... %u records lost\n",
+					  head - TRACE_RECORDS - seq);
+		seq = head - TRACE_RECORDS;
+	}
+
+	while (seq != head)
+	{
+		spin_lock_irqsave(&trace_lock, flags);
+		if (trace_head - seq > TRACE_RECORDS)
+		{
+			/* Overwritten while we were at it; try again next time */
+			spin_unlock_irqrestore(&trace_lock, flags);
+			break;
+		}
+		record = trace_ring[seq & (TRACE_RECORDS - 1)];
+		spin_unlock_irqrestore(&trace_lock, flags);
+
+		n = print_trace_record(&record, line);
+		if (len + n > buffer_length)
+			break;
+
+		memcpy(buffer + len, line, n);
+		len += n;
+		seq++;
+	}
+
+	*buffer_location = (char *) (unsigned long) (seq - (unsigned int) offset);
+
+	return len;
+}
+
+/*---------------------------------------------------------------------+
+ | int print_trace_record(struct trace_record *record, char *buffer)   |
+ |                                                                     |
+ | One line: time of day, CPU, pid (or irq), channel, what happened.   |
+ +--------------------------------------------------------------------*/
+int print_trace_record(struct trace_record *record, char *buffer)
+{
+	unsigned long sec, usec;
+	u64 us;
+	int len;
+
+	us = (u64) (record->when - trace_start_cycles) * 1000;
+	if (cpu_khz)
+		do_div(us, cpu_khz);
+	else
+		us = 0;
+
+	us += trace_start_time.tv_usec;
+	usec = do_div(us, 1000000);
+	sec = trace_start_time.tv_sec + (unsigned long) us;
+
+	len = sprintf(buffer, "%lu.%06lu %2d ", sec, usec, record->cpu);
+	if (record->irq)
+		len += sprintf(buffer + len, "  irq ");
+	else
+		len += sprintf(buffer + len, "%5d ", record->pid);
+
+	if (record->channel == TP_BOARD)
+		len += sprintf(buffer + len, "- ");
+	else
+		len += sprintf(buffer + len, "%d ", record->channel);
+
+	switch (record->type)
+	{
+	case TP_COMMAND:
+		len += sprintf(buffer + len, "command %s\n", op_name(record->a));
+		break;
+
+	case TP_DONE:
+		len += sprintf(buffer + len, "done    %s = %d, %d out %d in\n",
+					   op_name(record->a), record->b, record->c, record->d);
+		break;
+
+	case TP_BUSY:
+		len += sprintf(buffer + len, "busy    %d polls%s\n", record->a,
+					   record->b < 0 ? ", gave up" : "");
+		break;
+
+	case TP_IRQ:
+		len += sprintf(buffer + len, "irq     cause %02x\n", record->a);
+		break;
+
+	case TP_EVENT:
+		len += sprintf(buffer + len,
+					   "event   status %02x seq %u, %d clients woken\n",
+					   record->a, record->b, record->c);
+		break;
+
+	default:
+		len += sprintf(buffer + len, "? %d\n", record->type);
+		break;
+	}
+
+	return len;
+}
+
+/*---------------------------------------------------------------------+
+ |    void capture_point(int type, int port, int value)                |
+ |                                                                     |
+ |    Called through CAPTURE(), from any context, with the port (or    |
+ |    the channel, for ANDI_CAPTURE_OP) and the byte.                  |
+ +--------------------------------------------------------------------*/
+void capture_point(int type, int port, int value)
+{
+	struct ANDI_Capture *record;
+	unsigned long flags;
+	cycles_t now, delta;
+
+	now = get_cycles();
+
+	spin_lock_irqsave(&capture_lock, flags);
+
+	delta = now - capture_last;
+	capture_last = now;
+
+	record = &capture_ring[capture_head & (CAPTURE_RECORDS - 1)];
+	record->cycles = delta > 0xffffffff ? 0xffffffff : (__u32) delta;
+	record->type = type;
+	record->port = type == ANDI_CAPTURE_OP ? port : port - capture_base;
+	record->value = value;
+	record->pad = 0;
+	capture_head++;
+
+	spin_unlock_irqrestore(&capture_lock, flags);
+}
+
+/*---------------------------------------------------------------------+
+ |    void capture_start(int base_address)                             |
+ |                                                                     |
+ |    Empties the ring and starts capturing. The first record gives    |
+ |    cpu_khz, so that the cycle counts can be turned into time.       |
+ +--------------------------------------------------------------------*/
+void capture_start(int base_address)
+{
+	unsigned long flags;
+
+	LG(TRACE, "void capture_start(int base_address)\n");
+
+	spin_lock_irqsave(&capture_lock, flags);
+
+	capture_base = base_address;
+	capture_last = get_cycles();
+	capture_ring[0].cycles = cpu_khz;
+	capture_ring[0].type = ANDI_CAPTURE_START;
+	capture_ring[0].port = 0;
+	capture_ring[0].value = 0;
+	capture_ring[0].pad = 0;
+	capture_head = 1;
+	capture_enabled = TRUE;
+
+	spin_unlock_irqrestore(&capture_lock, flags);
+}
+
+/*---------------------------------------------------------------------+
+ |    void capture_stop(void)                                          |
+ +--------------------------------------------------------------------*/
+void capture_stop(void)
+{
+	LG(TRACE, "void capture_stop(void)\n");
+
+	capture_enabled = FALSE;
+}
+
+/*---------------------------------------------------------------------+
+ | int capture_read(char *buffer, char **buffer_location, off_t offset,|
+ |                  int buffer_length)                                 |
+ |                                                                     |
+ | The read_proc of /proc/andi_servo/capture. As with the trace, the   |
+ | file position counts records, so that a capture can be followed    |
+ | with cat as it is made. Records overwritten before they were read   |
+ | are skipped, and an ANDI_CAPTURE_LOST record says how many.         |
+ +--------------------------------------------------------------------*/
+int capture_read(char *buffer, char **buffer_location, off_t offset,
+				 int buffer_length)
+{
+	struct ANDI_Capture *record;
+	unsigned long flags;
+	unsigned int seq, head;
+	int len;
+
+	LG(TRACE,
+	   "int capture_read(char *buffer, char **buffer_location, off_t offset, int buffer_length)\n");
+
+	seq = offset;
+	len = 0;
+	record = (struct ANDI_Capture *) buffer;
+
+	spin_lock_irqsave(&capture_lock, flags);
+	head = capture_head;
+	spin_unlock_irqrestore(&capture_lock, flags);
+
+	/* Restarted since this reader began */
+	if ((int) (head - seq) < 0)
+		return 0;
+
+	if (head - seq > CAPTURE_RECORDS)
+	{
+		record->cycles = head - CAPTURE_RECORDS - seq;
+		record->type = ANDI_CAPTURE_LOST;
+		record->port = 0;
+		record->value = 0;
+		record->pad = 0;
+		record++;
+		len += sizeof (struct ANDI_Capture);
+		seq = head - CAPTURE_RECORDS;
+	}
+
+	while (seq != head && len + sizeof (struct ANDI_Capture) <= buffer_length)
+	{
+		spin_lock_irqsave(&capture_lock, flags);
+		if (capture_head - seq > CAPTURE_RECORDS)
+		{
+			/* Overwritten while we were at it; try again next time */
+			spin_unlock_irqrestore(&capture_lock, flags);
+			break;
+		}
+		*record = capture_ring[seq & (CAPTURE_RECORDS - 1)];
+		spin_unlock_irqrestore(&capture_lock, flags);
+
+		record++;
+		len += sizeof (struct ANDI_Capture);
+		seq++;
+	}
+
+	*buffer_location = (char *) (unsigned long) (seq - (unsigned int) offset);
+
+	return len;
+}
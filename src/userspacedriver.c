@@ -0,0 +1,204 @@
+/*--------------------------------------------------------------------------------+
+ |   Ajeco ANDI-SERVO Motion controller driver                                    |
+ |                                                                                |
+ |   Copyright (c) 1999 Mark Dennehy                                              |
+ |                                                                                |
+ |   Permission is hereby granted, free of charge, to any person obtaining a copy |
+ |   of this software and associated documentation files (the "Software"), to deal|
+ |   in the Software without restriction, including without limitation the rights |
+ |   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell    |
+ |   copies of the Software, and to permit persons to whom the Software is        |
+ |   furnished to do so, subject to the following conditions:                     |
+ |                                                                                |
+ |   The above copyright notice and this permission notice shall be included in   |
+ |   all copies or substantial portions of the Software.                          |
+ |                                                                                |
+ |   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR   |
+ |   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,     |
+ |   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE  |
+ |   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER       |
+ |   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,|
+ |   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN    |
+ |   THE SOFTWARE.                                                                |
+ +-------------------------------------------------------------------------------*/
+
+#include <time.h>
+#include <pthread.h>
+#include <sys/io.h>
+#include <andi_servo.h>
+
+#define TRACE TRUE
+
+/*
+ * What the user space build of andi_servo.c runs on: the board itself,
+ * through ioperm() and the real clock, or the LM629 emulator and a
+ * clock that each port access moves on by EMU_PORT_NS. The emulated
+ * bus, like the ISA bus, takes one access at a time: threads driving
+ * both channels at once (see stress.c) queue on userspace_bus_lock.
+ */
+
+unsigned long cpu_khz = 1000000;	/* A cycle is a nanosecond */
+
+struct lm629_emu userspace_emu;
+
+static int userspace_backend;
+static int userspace_base;
+static unsigned long long userspace_now;
+static pthread_mutex_t userspace_bus_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*---------------------------------------------------------------------+
+ |    int userspace_open(int backend, int base_address)                |
+ |                                                                     |
+ |    USERSPACE_PORTS needs root, for ioperm().                        |
+ +--------------------------------------------------------------------*/
+int userspace_open(int backend, int base_address)
+{
+	LG(TRACE, "int userspace_open(int backend, int base_address)\n");
+
+	userspace_base = base_address;
+	userspace_now = 0;
+
+	switch (backend)
+	{
+	case USERSPACE_PORTS:
+		if (ioperm(base_address, 8, 1) < 0)
+			return -errno;
+		break;
+
+	case USERSPACE_EMULATOR:
+		lm629_emu_init(&userspace_emu, userspace_now);
+		break;
+
+	default:
+		return -EINVAL;
+	}
+
+	userspace_backend = backend;
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------+
+ |    void userspace_close(void)                                       |
+ +--------------------------------------------------------------------*/
+void userspace_close(void)
+{
+	LG(TRACE, "void userspace_close(void)\n");
+
+	if (userspace_backend == USERSPACE_PORTS)
+		ioperm(userspace_base, 8, 0);
+
+	userspace_backend = 0;
+}
+
+/*---------------------------------------------------------------------+
+ | void userspace_board(struct andi_servo *board, struct LM629         |
+ |                      *channel0, struct LM629 *channel1)             |
+ |                                                                     |
+ | Sets up a board for the chip functions. The channels start empty:   |
+ | the caller gives them filters and trajectories as servo.c does.     |
+ +--------------------------------------------------------------------*/
+void userspace_board(struct andi_servo *board, struct LM629 *channel0,
+					 struct LM629 *channel1)
+{
+	LG(TRACE,
+	   "void userspace_board(struct andi_servo *board, struct LM629 *channel0, struct LM629 *channel1)\n");
+
+	memset(board, 0, sizeof (struct andi_servo));
+	memset(channel0, 0, sizeof (struct LM629));
+	memset(channel1, 0, sizeof (struct LM629));
+
+	board->Channel0 = channel0;
+	board->Channel1 = channel1;
+	board->base_address = userspace_base;
+}
+
+/*---------------------------------------------------------------------+
+ |struct LM629 *userspace_channel(struct andi_servo *board, int channel)|
+ +--------------------------------------------------------------------*/
+struct LM629 *userspace_channel(struct andi_servo *board, int channel)
+{
+	return channel ? board->Channel1 : board->Channel0;
+}
+
+/*---------------------------------------------------------------------+
+ |    unsigned char userspace_inb(int port)                            |
+ +--------------------------------------------------------------------*/
+unsigned char userspace_inb(int port)
+{
+	unsigned char value;
+
+	if (userspace_backend == USERSPACE_PORTS)
+		return inb_p(port);
+
+	pthread_mutex_lock(&userspace_bus_lock);
+	userspace_now += EMU_PORT_NS;
+	value = lm629_emu_inb(&userspace_emu, port - userspace_base,
+						  userspace_now);
+	pthread_mutex_unlock(&userspace_bus_lock);
+
+	return value;
+}
+
+/*---------------------------------------------------------------------+
+ |    void userspace_outb(unsigned char value, int port)               |
+ +--------------------------------------------------------------------*/
+void userspace_outb(unsigned char value, int port)
+{
+	if (userspace_backend == USERSPACE_PORTS)
+	{
+		outb_p(value, port);
+		return;
+	}
+
+	pthread_mutex_lock(&userspace_bus_lock);
+	userspace_now += EMU_PORT_NS;
+	lm629_emu_outb(&userspace_emu, port - userspace_base, value,
+				   userspace_now);
+	pthread_mutex_unlock(&userspace_bus_lock);
+}
+
+/*---------------------------------------------------------------------+
+ |    cycles_t userspace_clock(void)                                   |
+ +--------------------------------------------------------------------*/
+cycles_t userspace_clock(void)
+{
+	struct timespec now;
+	cycles_t cycles;
+
+	if (userspace_backend != USERSPACE_PORTS)
+	{
+		pthread_mutex_lock(&userspace_bus_lock);
+		cycles = userspace_now;
+		pthread_mutex_unlock(&userspace_bus_lock);
+		return cycles;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (cycles_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*---------------------------------------------------------------------+
+ |    void userspace_delay(unsigned long long ns)                      |
+ |                                                                     |
+ |    Spins, as mdelay() does, on the board; moves the clock on, with  |
+ |    the emulator.                                                    |
+ +--------------------------------------------------------------------*/
+void userspace_delay(unsigned long long ns)
+{
+	cycles_t until;
+
+	if (userspace_backend != USERSPACE_PORTS)
+	{
+		pthread_mutex_lock(&userspace_bus_lock);
+		userspace_now += ns;
+		lm629_emu_run(&userspace_emu, userspace_now);
+		pthread_mutex_unlock(&userspace_bus_lock);
+		return;
+	}
+
+	until = userspace_clock() + ns;
+	while (userspace_clock() < until)
+		barrier();
+}